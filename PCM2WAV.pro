@@ -4,47 +4,21 @@
 #
 #-------------------------------------------------
 
-QT       += core gui multimedia
-
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
-
-TARGET = PCM2WAV
-TEMPLATE = app
-
-# The following define makes your compiler emit warnings if you use
-# any feature of Qt which has been marked as deprecated (the exact warnings
-# depend on your compiler). Please consult the documentation of the
-# deprecated API in order to know how to port your code away from it.
-DEFINES += QT_DEPRECATED_WARNINGS
-
-# You can also make your code fail to compile if you use deprecated APIs.
-# In order to do so, uncomment the following line.
-# You can also select to disable deprecated APIs only up to a certain version of Qt.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
-
-CONFIG += c++11
-
-SOURCES += \
-        main.cpp \
-        mainwindow.cpp \
-        pcmaudio.cpp
-
-HEADERS += \
-        mainwindow.h \
-        pcmaudio.h
-
-FORMS += \
-        mainwindow.ui
-
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
-
-
-LIBS += -L$$PWD/lib/ -lavutil-56 \
-        -L$$PWD/lib/ -lswresample-3
-
-INCLUDEPATH += $$PWD/include
-DEPENDPATH += $$PWD/include
-
+# core:  不依赖Qt的转换引擎（静态库）
+# gui:   原来的界面程序，播放用QtMultimedia
+# cli:   命令行转换工具，只链接core
+# tests: 核对core的测试程序，make check运行
+# bench: core的基准测试
+TEMPLATE = subdirs
+
+SUBDIRS += \
+        core \
+        gui \
+        cli \
+        tests \
+        bench
+
+gui.depends = core
+cli.depends = core
+tests.depends = core
+bench.depends = core
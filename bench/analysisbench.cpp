@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "bench.h"
+#include "audiokernels.h"
+#include "audioanalyzer.h"
+#include "waveformoverview.h"
+#include "loudnessmeter.h"
+extern "C"{
+#include "libavutil/channel_layout.h"
+}
+
+/*
+ * 60秒48kHz立体声S16，按Converter的方式每1024帧一块：先转成按声道分开的float，
+ * 再交给各个分析模块，分别计时，结果为实时的倍数
+ */
+void Bench::analysis()
+{
+    const int rate = 48000, channels = 2, seconds = 60, block = 1024;
+    const int frames = rate * seconds;
+    std::vector<int16_t> pcm((size_t)frames * channels);
+    for(int i = 0; i < frames; ++i){
+        pcm[2 * i] = (int16_t)(10000 * sin(i * 0.01) + 100);
+        pcm[2 * i + 1] = i % 1000 == 0 ? 32767 : (int16_t)(3000 * sin(i * 0.003));
+    }
+    std::vector<float> planar((size_t)frames * channels);
+    auto convert = [&](){
+        for(int pos = 0; pos < frames; pos += block){
+            int n = std::min(block, frames - pos);
+            AudioKernels::deinterleaveToFloat((const uint8_t *)&pcm[(size_t)pos * channels], AV_SAMPLE_FMT_S16,
+                                              channels, n, &planar[(size_t)pos * channels]);
+        }
+    };
+    /*每块的float数据在planar里连续存放，第pos帧开始的一块在planar + pos * channels*/
+    auto feed = [&](const std::function<void(const float *, int)> &add){
+        for(int pos = 0; pos < frames; pos += block)
+            add(&planar[(size_t)pos * channels], std::min(block, frames - pos));
+    };
+    auto print = [&](const char *name, double s){
+        printf("  %-22s %8.2f ms  %7.0fx realtime\n", name, s * 1e3, seconds / s);
+    };
+
+    print("deinterleave to float", fastest(5, convert));
+    AudioAnalyzer analyzer;
+    print("peak/RMS/DC/clip/NaN", fastest(5, [&](){
+        analyzer.reset(channels, AV_SAMPLE_FMT_S16);
+        feed([&](const float *data, int n){ analyzer.addBlock(data, n);});
+    }));
+    WaveformOverview overview;
+    print("waveform overview", fastest(5, [&](){
+        overview.reset(channels, rate);
+        feed([&](const float *data, int n){ overview.addBlock(data, n);});
+        overview.finish();
+    }));
+    LoudnessMeter meter;
+    print("BS.1770 + true peak", fastest(3, [&](){
+        meter.reset(channels, rate, AV_CH_LAYOUT_STEREO);
+        feed([&](const float *data, int n){ meter.addBlock(data, n);});
+    }));
+    printf("%s", analyzer.report("source").c_str());
+    printf("loudness %.1f LUFS, true peak %.1f dBTP\n", meter.integrated(), meter.truePeak());
+}
@@ -0,0 +1,30 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <functional>
+
+/**
+ * @brief 转换引擎各部分的基准测试，只打印结果，不判断对错（核对在tests里）
+ * 每项测试是一个函数，由main按名字选择
+ */
+namespace Bench {
+
+double seconds(const std::chrono::steady_clock::time_point &start);
+/**
+ * @brief 运行repeat次，返回最快一次的秒数，减少其它进程的干扰
+ */
+double fastest(int repeat, const std::function<void()> &run);
+
+/*源和输出的分析：格式转换、逐声道统计、波形概览和BS.1770响度*/
+void analysis();
+/*各种抖动方法从S32和FLT降到S16的速度*/
+void dither();
+/*紧凑24位的解包和打包*/
+void packed24();
+/*swresample各档质量预设的速度和信噪比*/
+void presets();
+
+}
+
+#endif // BENCH_H
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# 转换引擎的基准测试，不带参数运行全部，或者按名字选择
+#
+#-------------------------------------------------
+
+TARGET = pcm2wav-bench
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+
+SOURCES += \
+        main.cpp \
+        analysisbench.cpp \
+        ditherbench.cpp \
+        packed24bench.cpp \
+        presetbench.cpp
+
+HEADERS += \
+        bench.h
+
+include(../core/core.pri)
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "bench.h"
+#include "streamconverter.h"
+extern "C"{
+#include "libavutil/channel_layout.h"
+}
+
+namespace {
+
+/*SwrDitherType在三角高通和噪声整形之间有空位，不能按数值遍历*/
+const ResamplerOptions::Dither methods[] = {
+    ResamplerOptions::NoDither, ResamplerOptions::Rectangular, ResamplerOptions::Triangular,
+    ResamplerOptions::TriangularHighpass, ResamplerOptions::Lipshitz, ResamplerOptions::FWeighted,
+    ResamplerOptions::ModifiedEWeighted, ResamplerOptions::ImprovedEWeighted, ResamplerOptions::Shibata,
+    ResamplerOptions::LowShibata, ResamplerOptions::HighShibata
+};
+
+/*
+ * 10秒44.1kHz立体声-6 dBFS的997 Hz正弦从format降到S16，采样率不变，每4096帧push一次；
+ * 44.1kHz下每种噪声整形都有滤波器，48kHz时lipshitz和high shibata会退回三角高通。
+ * 噪声为输出和输入之差的有效值（不加权），噪声整形会把它推高，只用来确认抖动确实加上了
+ */
+void runDither(AVSampleFormat format)
+{
+    const int rate = 44100, seconds = 10, channels = 2, block = 4096;
+    const int frames = rate * seconds;
+    std::vector<double> x((size_t)frames * channels);
+    for(int i = 0; i < frames; ++i)
+        x[(size_t)i * channels] = x[(size_t)i * channels + 1] = 0.5 * sin(2 * M_PI * 997 * i / rate);
+    std::vector<uint8_t> in((size_t)frames * channels * av_get_bytes_per_sample(format));
+    for(size_t i = 0; i < x.size(); ++i){
+        if(format == AV_SAMPLE_FMT_S32)
+            ((int32_t *)in.data())[i] = (int32_t)lrint(x[i] * 2147483647.0);
+        else
+            ((float *)in.data())[i] = (float)x[i];
+    }
+    std::vector<int16_t> out((size_t)frames * channels);
+    printf("  %s -> s16, stereo %d Hz, %d s\n", av_get_sample_fmt_name(format), rate, seconds);
+    for(auto dither : methods){
+        int64_t total = 0;
+        bool ok = true;
+        double s = Bench::fastest(3, [&](){
+            StreamConverter stream;
+            stream.setDither(dither, 1.0);
+            ok = stream.open({format, AV_CH_LAYOUT_STEREO, rate}, {AV_SAMPLE_FMT_S16, AV_CH_LAYOUT_STEREO, rate});
+            int frameBytes = stream.inputFormat().frameBytes();
+            uint8_t *dst = (uint8_t *)out.data();
+            total = 0;
+            auto drain = [&](){
+                int64_t bytes;
+                auto data = stream.peek(&bytes);
+                bytes = std::min(bytes, (int64_t)(out.size() * sizeof(int16_t)) - total);
+                memcpy(dst + total, data, bytes);
+                stream.consume(bytes);
+                total += bytes;
+            };
+            for(int pos = 0; ok && pos < frames; pos += block){
+                int n = std::min(block, frames - pos);
+                ok = stream.push(in.data() + (size_t)pos * frameBytes, (int64_t)n * frameBytes);
+                drain();
+            }
+            ok = ok && stream.finish();
+            if(ok)
+                drain();
+            stream.close();
+        });
+        if(!ok){
+            printf("  %-20s cannot convert\n", ResamplerOptions::ditherName(dither));
+            continue;
+        }
+        int64_t n = total / sizeof(int16_t);
+        double error = 0;
+        for(int64_t i = 0; i < n; ++i){
+            double e = out[i] / 32768.0 - x[i];
+            error += e * e;
+        }
+        printf("  %-20s %7.2f ms  %6.0fx realtime  noise %6.1f dBFS\n", ResamplerOptions::ditherName(dither),
+               s * 1e3, seconds / s, n > 0 ? 10 * log10(error / n) : 0.0);
+    }
+}
+
+}
+
+/*
+ * 各种抖动方法降到16位的速度，经过StreamConverter，和Converter走同一条swr路径
+ */
+void Bench::dither()
+{
+    runDither(AV_SAMPLE_FMT_S32);
+    runDither(AV_SAMPLE_FMT_FLT);
+}
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+
+namespace {
+
+struct Entry{
+    const char *name;
+    void (*run)();
+};
+
+const Entry entries[] = {
+    {"analysis", Bench::analysis},
+    {"dither", Bench::dither},
+    {"packed24", Bench::packed24},
+    {"presets", Bench::presets}
+};
+
+}
+
+double Bench::seconds(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double Bench::fastest(int repeat, const std::function<void()> &run)
+{
+    double best = 0;
+    for(int i = 0; i < repeat; ++i){
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double s = seconds(start);
+        if(i == 0 || s < best)
+            best = s;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    /*不带参数时运行全部*/
+    bool all = argc < 2;
+    for(int i = 1; i < argc; ++i){
+        bool found = false;
+        for(auto &entry : entries)
+            found = found || strcmp(argv[i], entry.name) == 0;
+        if(!found){
+            fprintf(stderr, "usage: %s [name...]\n  names:", argv[0]);
+            for(auto &entry : entries)
+                fprintf(stderr, " %s", entry.name);
+            fprintf(stderr, "\n");
+            return 1;
+        }
+    }
+    for(auto &entry : entries){
+        bool selected = all;
+        for(int i = 1; i < argc; ++i)
+            selected = selected || strcmp(argv[i], entry.name) == 0;
+        if(!selected)
+            continue;
+        printf("== %s\n", entry.name);
+        entry.run();
+    }
+    return 0;
+}
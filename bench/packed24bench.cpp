@@ -0,0 +1,31 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "bench.h"
+#include "samplecodec.h"
+
+/*
+ * 60秒48kHz 8声道的紧凑24位数据（46 MB），解包为S32、打包回24位（有无抖动），
+ * 和同样字节数的memcpy对比，结果为每秒处理的24位数据量
+ */
+void Bench::packed24()
+{
+    const int64_t count = 48000LL * 60 * 8;
+    std::vector<uint8_t> packed(count * 3), repacked(count * 3);
+    std::vector<int32_t> samples(count);
+    for(size_t i = 0; i < packed.size(); ++i)
+        packed[i] = (uint8_t)(i * 131 + 7);
+    uint32_t seed = 0;
+    auto print = [&](const char *name, double s){
+        printf("  %-16s %8.2f ms  %7.0f MB/s\n", name, s * 1e3, count * 3 / s / 1e6);
+    };
+    print("memcpy", fastest(5, [&](){ memcpy(repacked.data(), packed.data(), packed.size());}));
+    print("unpack24", fastest(5, [&](){ SampleCodec::unpack24(packed.data(), count, samples.data());}));
+    print("unpack24 BE", fastest(5, [&](){ SampleCodec::unpack24(packed.data(), count, samples.data(), true);}));
+    SampleCodec::unpack24(packed.data(), count, samples.data());
+    print("pack24", fastest(5, [&](){ SampleCodec::pack24(samples.data(), count, repacked.data(), false, &seed);}));
+    /*没有抖动时解包再打包应该得到原来的数据*/
+    if(memcmp(packed.data(), repacked.data(), packed.size()) != 0)
+        printf("  warning: pack24(unpack24(x)) != x\n");
+    print("pack24 dither", fastest(5, [&](){ SampleCodec::pack24(samples.data(), count, repacked.data(), true, &seed);}));
+}
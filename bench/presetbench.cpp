@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "bench.h"
+#include "resampleroptions.h"
+extern "C"{
+#include "libavutil/channel_layout.h"
+#include "libavutil/opt.h"
+}
+
+namespace {
+
+/*在频率f上最小二乘拟合正弦，剩下的都算噪声；两端各跳过skip帧，只用第一个声道*/
+double sineSnr(const std::vector<float> &y, int channels, int frames, int rate, double f, int skip)
+{
+    double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0;
+    for(int i = skip; i < frames - skip; ++i){
+        double s = sin(2 * M_PI * f * i / rate), c = cos(2 * M_PI * f * i / rate), v = y[(size_t)i * channels];
+        ss += s * s;
+        cc += c * c;
+        sc += s * c;
+        ys += v * s;
+        yc += v * c;
+    }
+    double det = ss * cc - sc * sc;
+    double a = (ys * cc - yc * sc) / det, b = (yc * ss - ys * sc) / det;
+    double signal = 0, error = 0;
+    for(int i = skip; i < frames - skip; ++i){
+        double m = a * sin(2 * M_PI * f * i / rate) + b * cos(2 * M_PI * f * i / rate);
+        double e = y[(size_t)i * channels] - m;
+        signal += m * m;
+        error += e * e;
+    }
+    return 10 * log10(signal / error);
+}
+
+void runPresets(int inRate, int outRate)
+{
+    const int seconds = 10, channels = 2, block = 1024;
+    const double f = 997;
+    const int frames = inRate * seconds;
+    std::vector<float> in((size_t)frames * channels);
+    for(int i = 0; i < frames; ++i)
+        in[(size_t)i * channels] = in[(size_t)i * channels + 1] = (float)(0.5 * sin(2 * M_PI * f * i / inRate));
+    std::vector<float> out(((size_t)frames * outRate / inRate + 8192) * channels);
+    printf("  %d -> %d, stereo float, %d s of %.0f Hz\n", inRate, outRate, seconds, f);
+    for(int q = ResamplerOptions::Fast; q <= ResamplerOptions::Best; ++q){
+        auto quality = (ResamplerOptions::Quality)q;
+        int total = 0;
+        double initMs = 0;
+        bool ok = true;
+        double s = Bench::fastest(3, [&](){
+            SwrContext *ctx = swr_alloc_set_opts(nullptr, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLT, outRate,
+                                                 AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLT, inRate, 0, nullptr);
+            auto start = std::chrono::steady_clock::now();
+            ok = ctx != nullptr && ResamplerOptions::apply(ctx, quality) && swr_init(ctx) >= 0;
+            initMs = Bench::seconds(start) * 1e3;
+            total = 0;
+            for(int pos = 0; ok && pos < frames; pos += block){
+                int n = std::min(block, frames - pos);
+                const uint8_t *src = (const uint8_t *)&in[(size_t)pos * channels];
+                uint8_t *dst = (uint8_t *)&out[(size_t)total * channels];
+                total += std::max(0, swr_convert(ctx, &dst, (int)(out.size() / channels) - total, &src, n));
+            }
+            swr_free(&ctx);
+        });
+        if(!ok){
+            printf("  %-7s cannot initialize\n", ResamplerOptions::name(quality));
+            continue;
+        }
+        printf("  %-7s init %6.2f ms  %7.0fx realtime  SNR %6.1f dB\n", ResamplerOptions::name(quality),
+               initMs, seconds / s, sineSnr(out, channels, total, outRate, f, outRate / 10));
+    }
+}
+
+}
+
+/*
+ * 各档质量预设的速度和正弦信噪比，每1024帧调用一次swr_convert，和Converter相同；
+ * 速度包括swr_init，init单独列出
+ */
+void Bench::presets()
+{
+    if(ResamplerOptions::soxrAvailable())
+        printf("  best uses soxr\n");
+    runPresets(48000, 44100);
+    runPresets(44100, 48000);
+}
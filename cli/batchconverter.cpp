@@ -0,0 +1,265 @@
+#include "batchconverter.h"
+#include <stdio.h>
+#include <errno.h>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#include "swrpool.h"
+
+namespace {
+
+int gcd(int a, int b)
+{
+    while(b != 0){
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+int64_t fileSize(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (int64_t)st.st_size : 0;
+}
+
+/*去掉目录和扩展名*/
+std::string baseName(const std::string &path)
+{
+    auto slash = path.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    auto dot = name.find_last_of('.');
+    return dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+}
+
+double seconds(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+/*拆开转换的文件：各段共用writer，最后一段完成时关闭*/
+struct BatchConverter::SplitFile
+{
+    std::string input;
+    ConversionJob job;
+    std::chrono::steady_clock::time_point start;
+    std::mutex mutex;
+    std::unique_ptr<AudioWriter> writer;
+    int count;
+    int remaining;
+    bool failed;
+};
+
+BatchConverter::BatchConverter() :
+    workers(0),
+    segmentDuration(30),
+    running(false),
+    files(0),
+    failed(0),
+    cached(0),
+    split(0),
+    segments(0)
+{
+}
+
+BatchConverter::~BatchConverter()
+{
+    stop();
+    if(scheduler)
+        scheduler->stop();
+}
+
+bool BatchConverter::run(const std::vector<std::string> &inputs)
+{
+    if(outputDir.empty())
+        outputDir = ".";
+#ifdef _WIN32
+    int ret = _mkdir(outputDir.c_str());
+#else
+    int ret = mkdir(outputDir.c_str(), 0755);
+#endif
+    if(ret != 0 && errno != EEXIST){
+        perror(outputDir.c_str());
+        return false;
+    }
+    scheduler.reset(new TaskScheduler(workers));
+    converters.clear();
+    for(int i = 0; i < scheduler->workers(); ++i)
+        converters.emplace_back(new Converter);
+    SwrPool::instance().setCapacity(std::max(8, scheduler->workers() * 2));
+    running = true;
+    auto start = std::chrono::steady_clock::now();
+
+    /*大文件先开始，最后剩下的只是小文件和段，各线程差不多同时结束*/
+    std::vector<std::pair<int64_t, std::string>> order;
+    for(auto &input : inputs)
+        order.emplace_back(fileSize(input), input);
+    std::stable_sort(order.begin(), order.end(),
+                     [](const std::pair<int64_t, std::string> &a, const std::pair<int64_t, std::string> &b){
+        return a.first > b.first;
+    });
+    for(auto &item : order){
+        std::string input = item.second;
+        scheduler->submit([this, input](int worker){ _convertFile(worker, input);});
+    }
+    scheduler->wait();
+    scheduler->stop();
+
+    auto result = stats();
+    fprintf(stderr, "%lld files (%lld split into %lld segments), %lld cached, %lld failed in %.2f s"
+            " on %d workers, %lld steals\n",
+            (long long)result.files, (long long)result.split, (long long)result.segments,
+            (long long)result.cached, (long long)result.failed, seconds(start),
+            scheduler->workers(), (long long)result.steals);
+    return result.failed == 0 && running;
+}
+
+void BatchConverter::stop()
+{
+    running = false;
+    for(auto &converter : converters)
+        converter->stop();
+}
+
+BatchConverter::Stats BatchConverter::stats() const
+{
+    return Stats{files, failed, cached, split, segments, scheduler ? scheduler->steals() : 0};
+}
+
+void BatchConverter::_convertFile(int worker, const std::string &input)
+{
+    if(worker < 0 || !running){
+        ++failed;
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    Converter &converter = *converters[worker];
+    Options fileOptions = options;
+    fileOptions.input = input;
+    fileOptions.output = outputDir + "/" + baseName(input);
+    ConversionJob job;
+    std::string error;
+    if(!job.prepare(fileOptions, converter, &error)){
+        ++failed;
+        fprintf(stderr, "worker %d: %s\n", worker, error.c_str());
+        return;
+    }
+    if(job.fetchCached(cache, input)){
+        ++files;
+        ++cached;
+        fprintf(stderr, "worker %d: %s -> %s (cached)\n", worker, input.c_str(), job.outputPath().c_str());
+        return;
+    }
+
+    /*拆成段，段的任务按倒序放进本线程的队列：本线程从末尾先取第一段，其它线程从开头窃取最后几段*/
+    int64_t total = converter.sourceFrames();
+    converter.setConfig(job.config);
+    int64_t length = _segmentFrames(converter);
+    if(length > 0 && total >= 2 * length){
+        auto file = std::make_shared<SplitFile>();
+        file->input = input;
+        file->job = job;
+        file->start = start;
+        file->count = file->remaining = (int)((total + length - 1) / length);
+        file->failed = false;
+        ++split;
+        segments += file->count;
+        for(int k = file->count - 1; k >= 0; --k){
+            int64_t begin = k * length;
+            int64_t end = k == file->count - 1 ? -1 : begin + length;
+            if(!scheduler->spawn(worker, [this, file, begin, end](int w){ _convertSegment(w, file, begin, end);}))
+                _segmentDone(worker, file, false);
+        }
+        return;
+    }
+
+    Converter::Callbacks callbacks;
+    if(options.verbose)
+        callbacks.message = [&input](const std::string &msg){ fprintf(stderr, "%s: %s\n", input.c_str(), msg.c_str());};
+    converter.setCallbacks(callbacks);
+    converter.setConfig(job.config);
+    auto status = running ? converter.run() : Converter::Cancelled;
+    converter.setCallbacks(Converter::Callbacks());
+    std::string result;
+    if(status == Converter::Finished && converter.save(job.output)){
+        job.storeCached(cache);
+        ++files;
+        fprintf(stderr, "worker %d: %s -> %s in %.2f s\n", worker, input.c_str(), job.outputPath().c_str(), seconds(start));
+        return;
+    }
+    ++failed;
+    result = status == Converter::Finished ? "cannot write " + job.outputPath()
+                                           : status == Converter::Cancelled ? "cancelled" : "conversion failed";
+    fprintf(stderr, "worker %d: %s: %s\n", worker, input.c_str(), result.c_str());
+}
+
+void BatchConverter::_convertSegment(int worker, const std::shared_ptr<SplitFile> &file, int64_t start, int64_t end)
+{
+    bool skip;
+    {
+        std::lock_guard<std::mutex> lock(file->mutex);
+        skip = file->failed;
+    }
+    if(worker < 0 || !running || skip){
+        _segmentDone(worker, file, false);
+        return;
+    }
+    Converter &converter = *converters[worker];
+    ConversionConfig config = file->job.config;
+    config.segmentStart = start;
+    config.segmentEnd = end;
+    config.checkpointPath.clear();
+    converter.setConfig(config);
+    /*setConfig撤销了之前的stop，在它之后再检查一次*/
+    bool ok = running && converter.open(file->input) && converter.run() == Converter::Finished;
+    if(ok){
+        std::lock_guard<std::mutex> lock(file->mutex);
+        if(!file->writer)
+            file->writer = AudioWriter::create(config.container);
+        ok = !file->failed && converter.writeSegment(*file->writer, file->job.outputPath());
+    }
+    _segmentDone(worker, file, ok);
+}
+
+void BatchConverter::_segmentDone(int worker, const std::shared_ptr<SplitFile> &file, bool ok)
+{
+    {
+        std::lock_guard<std::mutex> lock(file->mutex);
+        file->failed = file->failed || !ok;
+        if(--file->remaining > 0)
+            return;
+    }
+    /*最后一段：按全部长度重写文件头，有一段失败时删掉写了一半的输出*/
+    auto path = file->job.outputPath();
+    bool closed = file->writer && file->writer->isOpen() && file->writer->close();
+    if(file->failed || !closed){
+        remove(path.c_str());
+        ++failed;
+        fprintf(stderr, "worker %d: %s: %s\n", worker, file->input.c_str(), running ? "conversion failed" : "cancelled");
+        return;
+    }
+    file->job.storeCached(cache);
+    ++files;
+    fprintf(stderr, "worker %d: %s -> %s in %d segments, %.2f s\n",
+            worker, file->input.c_str(), path.c_str(), file->count, seconds(file->start));
+}
+
+int64_t BatchConverter::_segmentFrames(const Converter &converter) const
+{
+    /*这些处理依赖整个文件或者前面所有样本的状态，重采样的相位不精确时各段的相位也会偏开，分段后结果会不同*/
+    const ConversionConfig &config = converter.getConfig();
+    if(segmentDuration <= 0 || config.normalize || config.trimSilence || config.channelMap.size() > 1
+            || config.dither || config.ditherMethod != ResamplerOptions::NoDither || !converter.exactPhases())
+        return 0;
+    /*段的两端落在两个采样率的公共周期上*/
+    int64_t align = config.srcRate / gcd(config.srcRate, config.dstRate);
+    int64_t frames = (int64_t)(segmentDuration * config.srcRate) / align * align;
+    return std::max(frames, align);
+}
@@ -0,0 +1,90 @@
+#ifndef BATCHCONVERTER_H
+#define BATCHCONVERTER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "converter.h"
+#include "conversioncache.h"
+#include "taskscheduler.h"
+#include "options.h"
+
+/**
+ * @brief 批量转换，大小悬殊的文件一起转换时各线程差不多同时结束
+ * 每个文件先作为一个任务，从大到小提交；长度超过两段的文件在任务里拆成若干段，
+ * 段的子任务留在本线程的队列里，由空闲的线程窃取。各段前后多读一段重叠的源数据，
+ * 输出写在文件中各自的位置，拼起来和整个文件一次转换的结果相同。
+ * 响度归一化、静音裁剪和抖动依赖整个文件，重采样的相位表不精确（如fast预设）时各段的相位对不上，这样的文件不拆
+ */
+class BatchConverter
+{
+public:
+    struct Stats{
+        int64_t files;
+        int64_t failed;
+        int64_t cached;
+        /*拆开的文件数和段数*/
+        int64_t split;
+        int64_t segments;
+        int64_t steals;
+    };
+
+public:
+    BatchConverter();
+    ~BatchConverter();
+
+    /**
+     * @brief 以下设置在run之前调用；options为每个文件的转换参数，输出为输出目录下去掉扩展名的文件名
+     */
+    void setOptions(const Options &options);
+    void setOutputDir(const std::string &dir);
+    void setWorkers(const int &workers);
+    /**
+     * @brief 每段的源时长，至少有两段长的文件才拆开，0为不拆
+     */
+    void setSegmentDuration(const double &seconds);
+    bool setCache(const std::string &dir);
+
+    /**
+     * @brief 转换全部文件后返回，有文件失败或被停止时返回false
+     */
+    bool run(const std::vector<std::string> &inputs);
+    /**
+     * @brief 可以在信号处理函数中调用：正在转换的文件停止，还没开始的不再开始
+     */
+    void stop();
+    Stats stats() const;
+
+private:
+    struct SplitFile;
+
+    void _convertFile(int worker, const std::string &input);
+    void _convertSegment(int worker, const std::shared_ptr<SplitFile> &file, int64_t start, int64_t end);
+    void _segmentDone(int worker, const std::shared_ptr<SplitFile> &file, bool ok);
+    int64_t _segmentFrames(const Converter &converter) const;
+private:
+    Options options;
+    std::string outputDir;
+    int workers;
+    double segmentDuration;
+    ConversionCache cache;
+    std::unique_ptr<TaskScheduler> scheduler;
+    /*每个工作线程一个，只在对应的线程里使用*/
+    std::vector<std::unique_ptr<Converter>> converters;
+    std::atomic<bool> running;
+    std::atomic<int64_t> files;
+    std::atomic<int64_t> failed;
+    std::atomic<int64_t> cached;
+    std::atomic<int64_t> split;
+    std::atomic<int64_t> segments;
+};
+
+inline void BatchConverter::setOptions(const Options &options)                  {   this->options = options;}
+inline void BatchConverter::setOutputDir(const std::string &dir)                {   outputDir = dir;}
+inline void BatchConverter::setWorkers(const int &workers)                      {   this->workers = workers;}
+inline void BatchConverter::setSegmentDuration(const double &seconds)           {   segmentDuration = seconds;}
+inline bool BatchConverter::setCache(const std::string &dir)                    {   return cache.setDirectory(dir);}
+#endif // BATCHCONVERTER_H
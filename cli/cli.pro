@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# 命令行转换工具，不链接Qt
+#
+#-------------------------------------------------
+
+TARGET = pcm2wav-cli
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+
+SOURCES += \
+        main.cpp \
+        options.cpp \
+        pipeconverter.cpp \
+        jobserver.cpp \
+        folderwatch.cpp \
+        batchconverter.cpp
+
+HEADERS += \
+        options.h \
+        pipeconverter.h \
+        jobserver.h \
+        folderwatch.h \
+        batchconverter.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
+
+include(../core/core.pri)
@@ -0,0 +1,366 @@
+#include "folderwatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
+#include <algorithm>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#ifdef __linux__
+
+namespace {
+
+/*读事件和等待排队空位的超时，stop之后最多这么久返回*/
+const int pollMilliseconds = 200;
+
+/*能读的封装格式和裸PCM*/
+const char *const extensions[] = {"pcm", "raw", "wav", "w64", "aif", "aiff", "aifc", "caf"};
+
+bool modifiedTime(const std::string &path, std::chrono::system_clock::time_point *time)
+{
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+    auto since = std::chrono::seconds(st.st_mtim.tv_sec) + std::chrono::nanoseconds(st.st_mtim.tv_nsec);
+    *time = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(since));
+    return true;
+}
+
+std::string realPath(const std::string &path)
+{
+    char *p = realpath(path.c_str(), nullptr);
+    if(p == nullptr)
+        return path;
+    std::string result = p;
+    free(p);
+    return result;
+}
+
+double seconds(std::chrono::system_clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+}
+
+FolderWatch::FolderWatch() :
+    workers(0),
+    maxQueued(0),
+    running(false),
+    queued(0),
+    failed(0)
+{
+}
+
+FolderWatch::~FolderWatch()
+{
+    stop();
+    if(queue)
+        queue->stop();
+}
+
+bool FolderWatch::run(const std::string &dir)
+{
+    watchDir = dir;
+    while(watchDir.size() > 1 && watchDir.back() == '/')
+        watchDir.pop_back();
+    if(outputDir.empty())
+        outputDir = watchDir + "/converted";
+    if(mkdir(outputDir.c_str(), 0755) != 0 && errno != EEXIST){
+        perror(outputDir.c_str());
+        return false;
+    }
+    /*输出写进监视目录会被当作新文件再转换一次*/
+    if(realPath(outputDir) == realPath(watchDir)){
+        fprintf(stderr, "the output directory must not be the watched directory\n");
+        return false;
+    }
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(fd < 0){
+        perror("inotify_init1");
+        return false;
+    }
+    /*只关心写完的文件：写入后关闭，或者在别处写好后移进来*/
+    if(inotify_add_watch(fd, watchDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0){
+        perror(watchDir.c_str());
+        close(fd);
+        return false;
+    }
+
+    queue.reset(new JobQueue(workers));
+    converters.clear();
+    for(int i = 0; i < queue->workers(); ++i)
+        converters.emplace_back(new Converter);
+    if(maxQueued <= 0)
+        maxQueued = queue->workers() * 2;
+    running = true;
+    started = Clock::now();
+    fprintf(stderr, "watching %s, converting to %s with %d workers\n",
+            watchDir.c_str(), outputDir.c_str(), queue->workers());
+
+    _scan();
+    alignas(inotify_event) char buffer[16 * 1024];
+    while(running){
+        _waitForRoom();
+        pollfd item = {fd, POLLIN, 0};
+        int ready = poll(&item, 1, pollMilliseconds);
+        if(ready <= 0)
+            continue;
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if(n <= 0)
+            continue;
+        for(char *p = buffer; p < buffer + n && running; ){
+            auto *event = (inotify_event *)p;
+            p += sizeof(inotify_event) + event->len;
+            /*内核队列溢出时丢了事件，按文件时间重新找出没有转换的文件*/
+            if(event->mask & IN_Q_OVERFLOW){
+                fprintf(stderr, "event queue overflowed, rescanning %s\n", watchDir.c_str());
+                _scan();
+                continue;
+            }
+            if(event->len == 0 || (event->mask & IN_ISDIR) || !_accepts(event->name))
+                continue;
+            /*写完的时间就是文件的修改时间，排队等待的时间也算在延迟里；
+              暂停读取期间同一个文件的多个事件，第一个转换后其余的就不用再转换*/
+            Clock::time_point arrival;
+            if(!modifiedTime(watchDir + "/" + event->name, &arrival) || _converted(event->name, arrival))
+                continue;
+            _waitForRoom();
+            _enqueue(event->name, std::max(arrival, started), true);
+        }
+    }
+    /*正在转换的文件提交断点后结束，排队的文件输出不存在，下次启动时扫描到*/
+    for(auto &converter : converters)
+        converter->stop();
+    queue->stop();
+    close(fd);
+
+    auto result = stats();
+    fprintf(stderr, "%lld converted, %lld failed, latency mean %.2f s, p95 %.2f s, max %.2f s\n",
+            (long long)result.converted, (long long)result.failed,
+            result.meanLatency, result.p95Latency, result.maxLatency);
+    if(cache.isEnabled()){
+        auto cacheStats = cache.stats();
+        fprintf(stderr, "cache: %lld hits, %lld misses\n", (long long)cacheStats.hits, (long long)cacheStats.misses);
+    }
+    return true;
+}
+
+void FolderWatch::stop()
+{
+    running = false;
+}
+
+FolderWatch::Stats FolderWatch::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats result = {(int64_t)latencies.size(), failed, 0, 0, 0};
+    if(latencies.empty())
+        return result;
+    auto sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for(double latency : sorted)
+        sum += latency;
+    result.meanLatency = sum / sorted.size();
+    result.p95Latency = sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)];
+    result.maxLatency = sorted.back();
+    return result;
+}
+
+bool FolderWatch::_accepts(const std::string &name) const
+{
+    /*隐藏文件一般是还没写完、之后会改名的临时文件*/
+    if(name.empty() || name[0] == '.')
+        return false;
+    auto dot = name.find_last_of('.');
+    if(dot == std::string::npos)
+        return false;
+    std::string extension = name.substr(dot + 1);
+    for(auto &c : extension)
+        c = (char)tolower((unsigned char)c);
+    for(auto e : extensions){
+        if(extension == e)
+            return true;
+    }
+    return false;
+}
+
+std::string FolderWatch::_outputPath(const std::string &name) const
+{
+    return outputDir + "/" + name.substr(0, name.find_last_of('.'));
+}
+
+bool FolderWatch::_converted(const std::string &name, Clock::time_point source) const
+{
+    Clock::time_point output;
+    return modifiedTime(_outputPath(name) + "." + AudioContainer::extension(options.type), &output) && output >= source;
+}
+
+void FolderWatch::_scan()
+{
+    DIR *dir = opendir(watchDir.c_str());
+    if(dir == nullptr){
+        perror(watchDir.c_str());
+        return;
+    }
+    std::vector<std::string> names;
+    while(dirent *entry = readdir(dir)){
+        if(_accepts(entry->d_name))
+            names.push_back(entry->d_name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    for(auto &name : names){
+        Clock::time_point source;
+        if(!modifiedTime(watchDir + "/" + name, &source) || _converted(name, source))
+            continue;
+        _waitForRoom();
+        if(!running)
+            break;
+        _enqueue(name, std::max(source, started), false);
+    }
+}
+
+void FolderWatch::_enqueue(const std::string &name, Clock::time_point arrival, bool changed)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = files.find(name);
+        /*还在排队时转换会读到最新的内容；正在转换时结束后再转换一次*/
+        if(it != files.end()){
+            if(changed && it->second == Running)
+                it->second = RunningChanged;
+            return;
+        }
+        files[name] = Queued;
+        ++queued;
+    }
+    if(queue->submit(0, [this, name, arrival](int worker){ _convert(worker, name, arrival);}) < 0){
+        std::lock_guard<std::mutex> lock(mutex);
+        files.erase(name);
+        --queued;
+    }
+}
+
+void FolderWatch::_waitForRoom()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while(running && queued >= maxQueued)
+        room.wait_for(lock, std::chrono::milliseconds(pollMilliseconds));
+}
+
+void FolderWatch::_convert(int worker, const std::string &name, Clock::time_point arrival)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --queued;
+        if(worker < 0)
+            files.erase(name);
+        else
+            files[name] = Running;
+    }
+    room.notify_one();
+    if(worker < 0)
+        return;
+
+    auto begin = Clock::now();
+    Converter &converter = *converters[worker];
+    Options fileOptions = options;
+    fileOptions.input = watchDir + "/" + name;
+    fileOptions.output = _outputPath(name);
+    ConversionJob job;
+    std::string error, result;
+    bool ok = false, cancelled = false, cached = false;
+    if(!job.prepare(fileOptions, converter, &error))
+        result = error;
+    else if((cached = job.fetchCached(cache, fileOptions.input))){
+        result = job.outputPath() + " (cached)";
+        ok = true;
+    }
+    else{
+        Converter::Callbacks callbacks;
+        if(options.verbose)
+            callbacks.message = [&name](const std::string &msg){ fprintf(stderr, "%s: %s\n", name.c_str(), msg.c_str());};
+        converter.setCallbacks(callbacks);
+        converter.setConfig(job.config);
+        auto status = running ? converter.run() : Converter::Cancelled;
+        converter.setCallbacks(Converter::Callbacks());
+        if(status == Converter::Finished){
+            result = job.outputPath();
+            ok = converter.save(job.output);
+            if(!ok)
+                result = "cannot write " + result;
+            else
+                job.storeCached(cache);
+        }
+        else if(status == Converter::Cancelled){
+            result = "cancelled";
+            cancelled = true;
+        }
+        else
+            result = "conversion failed";
+    }
+    auto end = Clock::now();
+    double latency = seconds(end - arrival);
+
+    bool again;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(ok)
+            latencies.push_back(latency);
+        else if(!cancelled)
+            ++failed;
+        again = files[name] == RunningChanged && running;
+        files.erase(name);
+    }
+    if(ok)
+        fprintf(stderr, "worker %d: %s -> %s: latency %.2f s (waited %.2f s)\n",
+                worker, name.c_str(), result.c_str(), latency, seconds(begin - arrival));
+    else
+        fprintf(stderr, "worker %d: %s: %s\n", worker, name.c_str(), result.c_str());
+    /*转换期间文件又写完了一次，按新的修改时间重新排队*/
+    Clock::time_point modified;
+    if(again && modifiedTime(fileOptions.input, &modified))
+        _enqueue(name, std::max(modified, started), true);
+}
+
+#else
+
+FolderWatch::FolderWatch() :
+    workers(0),
+    maxQueued(0),
+    running(false),
+    queued(0),
+    failed(0)
+{
+}
+
+FolderWatch::~FolderWatch()
+{
+}
+
+bool FolderWatch::run(const std::string &)
+{
+    fprintf(stderr, "watch mode needs inotify (Linux)\n");
+    return false;
+}
+
+void FolderWatch::stop()
+{
+}
+
+FolderWatch::Stats FolderWatch::stats()
+{
+    return Stats{0, 0, 0, 0, 0};
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef FOLDERWATCH_H
+#define FOLDERWATCH_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "converter.h"
+#include "jobqueue.h"
+#include "conversioncache.h"
+#include "options.h"
+
+/**
+ * @brief 监视目录，文件写完（关闭写入或移入）后自动转换到输出目录
+ * 用inotify得到写完的PCM/WAV等音频文件，交给固定数量的工作线程转换。
+ * 排队的文件达到上限时暂停读取事件，新事件留在内核队列里；内核队列溢出时重新扫描目录，
+ * 启动时也扫描一次，转换输出不存在或比源文件旧的文件。
+ * 每个文件记录从写完到转换输出的延迟，退出时打印统计
+ */
+class FolderWatch
+{
+public:
+    struct Stats{
+        int64_t converted;
+        int64_t failed;
+        /*延迟（秒）的平均值、95%分位数和最大值*/
+        double meanLatency;
+        double p95Latency;
+        double maxLatency;
+    };
+
+public:
+    FolderWatch();
+    ~FolderWatch();
+
+    /**
+     * @brief 以下设置在run之前调用；options为每个文件的转换参数，输入和输出由文件名决定
+     */
+    void setOptions(const Options &options);
+    /**
+     * @brief 为空时使用监视目录下的converted目录，不能和监视目录相同
+     */
+    void setOutputDir(const std::string &dir);
+    void setWorkers(const int &workers);
+    /**
+     * @brief 排队等待转换的文件数上限，0时为工作线程数的两倍
+     */
+    void setMaxQueued(const int &count);
+    /**
+     * @brief 同样的文件再次放进来时使用缓存的输出
+     */
+    bool setCache(const std::string &dir);
+
+    /**
+     * @brief 监视dir直到stop后返回，无法监视时返回false
+     */
+    bool run(const std::string &dir);
+    /**
+     * @brief 可以在信号处理函数中调用：正在转换的文件提交断点后结束，排队的文件留到下次启动时转换
+     */
+    void stop();
+    Stats stats();
+
+private:
+    typedef std::chrono::system_clock Clock;
+    enum State{Queued, Running, RunningChanged};
+
+    bool _accepts(const std::string &name) const;
+    std::string _outputPath(const std::string &name) const;
+    /*输出比source时刻写完的源文件新*/
+    bool _converted(const std::string &name, Clock::time_point source) const;
+    void _scan();
+    void _enqueue(const std::string &name, Clock::time_point arrival, bool changed);
+    void _waitForRoom();
+    void _convert(int worker, const std::string &name, Clock::time_point arrival);
+private:
+    Options options;
+    std::string watchDir;
+    std::string outputDir;
+    int workers;
+    int maxQueued;
+    std::unique_ptr<JobQueue> queue;
+    /*每个工作线程一个，只在对应的线程里使用*/
+    std::vector<std::unique_ptr<Converter>> converters;
+    ConversionCache cache;
+    std::atomic<bool> running;
+    Clock::time_point started;
+    /*以下由mutex保护：排队或正在转换的文件，转换期间又写完一次的文件转换结束后重新排队*/
+    std::mutex mutex;
+    std::condition_variable room;
+    std::map<std::string, State> files;
+    int queued;
+    std::vector<double> latencies;
+    int64_t failed;
+};
+
+inline void FolderWatch::setOptions(const Options &options)                     {   this->options = options;}
+inline void FolderWatch::setOutputDir(const std::string &dir)                   {   outputDir = dir;}
+inline void FolderWatch::setWorkers(const int &workers)                         {   this->workers = workers;}
+inline void FolderWatch::setMaxQueued(const int &count)                         {   maxQueued = count;}
+inline bool FolderWatch::setCache(const std::string &dir)                       {   return cache.setDirectory(dir);}
+#endif // FOLDERWATCH_H
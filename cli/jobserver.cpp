@@ -0,0 +1,433 @@
+#include "jobserver.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <algorithm>
+#include <chrono>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+#include "swrpool.h"
+
+#ifndef _WIN32
+
+namespace {
+
+/*请求要在这段时间内发完，否则关闭连接*/
+const int requestTimeoutSeconds = 10;
+/*没有新连接和数据时也定期醒来，检查超时和停止*/
+const int pollMilliseconds = 200;
+/*一个请求只有工作目录和参数，超过这个长度的不是正常的客户端*/
+const size_t maxRequestBytes = 64 * 1024;
+
+/*还没收完的请求*/
+struct PendingRequest{
+    int fd;
+    std::string data;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+/*请求以空行结束，收完时拆出工作目录和参数*/
+bool parseRequest(const std::string &data, std::string *dir, std::vector<std::string> *args)
+{
+    args->clear();
+    size_t start = 0;
+    for(bool first = true;; first = false){
+        auto end = data.find('\n', start);
+        if(end == std::string::npos)
+            return false;
+        std::string line = data.substr(start, end - start);
+        start = end + 1;
+        if(first)
+            *dir = line;
+        else if(line.empty())
+            return true;
+        else
+            args->push_back(line);
+    }
+}
+
+bool sendLine(int fd, const std::string &line)
+{
+    std::string text = line + "\n";
+    const char *p = text.data();
+    size_t left = text.size();
+    while(left > 0){
+        ssize_t n = send(fd, p, left, 0);
+        if(n <= 0)
+            return false;
+        p += n;
+        left -= n;
+    }
+    return true;
+}
+
+/*按行读，连接关闭时返回false；buffer里保留下一行已经读到的部分*/
+bool readLine(int fd, std::string &buffer, std::string *line)
+{
+    for(;;){
+        auto pos = buffer.find('\n');
+        if(pos != std::string::npos){
+            line->assign(buffer, 0, pos);
+            buffer.erase(0, pos + 1);
+            return true;
+        }
+        char block[4096];
+        ssize_t n = recv(fd, block, sizeof(block), 0);
+        if(n <= 0)
+            return false;
+        buffer.append(block, n);
+    }
+}
+
+std::string absolutePath(const std::string &dir, const std::string &path)
+{
+    if(path.empty() || path[0] == '/')
+        return path;
+    return dir + "/" + path;
+}
+
+bool makeAddress(const std::string &path, sockaddr_un *address)
+{
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address->sun_path))
+        return false;
+    strcpy(address->sun_path, path.c_str());
+    return true;
+}
+
+/*读入后源数据和转换结果都在内存里，按两者之和估计*/
+double estimateMemory(const Options &options, const Converter &converter, const ConversionConfig &config)
+{
+    int64_t coded = 0;
+    if(converter.isRaw()){
+        struct stat st;
+        if(stat(options.input.c_str(), &st) == 0)
+            coded = st.st_size;
+    }
+    else
+        coded = converter.sourceInfo().dataSize;
+    int sampleBytes = SampleCodec::codedBytes(config.srcCoding, config.srcFormat);
+    int channels = converter.sourceChannels();
+    if(sampleBytes <= 0 || channels <= 0 || converter.sourceRate() <= 0)
+        return 0;
+    double samples = (double)coded / sampleBytes;
+    double decoded = samples * av_get_bytes_per_sample(converter.sourceFormat());
+    double frames = samples / channels * config.dstRate / converter.sourceRate();
+    double output = frames * av_get_channel_layout_nb_channels(config.dstLayout)
+            * av_get_bytes_per_sample(config.dstFormat);
+    return (std::max<double>(coded, decoded) + output) / (1024.0 * 1024.0);
+}
+
+}
+
+JobServer::JobServer() :
+    workers(0),
+    maxMemory(0),
+    listenFd(-1),
+    running(false)
+{
+}
+
+JobServer::~JobServer()
+{
+    stop();
+    if(queue)
+        queue->stop();
+}
+
+void JobServer::warm(int inRate, int outRate)
+{
+    SwrPool::Key key;
+    key.inLayout = key.outLayout = AV_CH_LAYOUT_STEREO;
+    key.inRate = inRate;
+    key.outRate = outRate;
+    key.inFormat = key.outFormat = AV_SAMPLE_FMT_S16;
+    key.quality = ResamplerOptions::Normal;
+    key.dither = ResamplerOptions::NoDither;
+    key.ditherScale = 1.0;
+    SwrPool::instance().warm(key);
+}
+
+bool JobServer::run(const std::string &path)
+{
+    sockaddr_un address;
+    if(!makeAddress(path, &address)){
+        fprintf(stderr, "socket path too long: %s\n", path.c_str());
+        return false;
+    }
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenFd < 0){
+        perror("socket");
+        return false;
+    }
+    /*上次没有正常退出时留下的socket文件*/
+    unlink(path.c_str());
+    if(bind(listenFd, (sockaddr *)&address, sizeof(address)) != 0 || listen(listenFd, 64) != 0){
+        perror(path.c_str());
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    /*客户端中途断开时send返回错误，不要因为SIGPIPE退出*/
+    signal(SIGPIPE, SIG_IGN);
+
+    queue.reset(new JobQueue(workers));
+    converters.clear();
+    for(int i = 0; i < queue->workers(); ++i)
+        converters.emplace_back(new Converter);
+    /*每个线程至少能留住一个常用的滤波器*/
+    SwrPool::instance().setCapacity(std::max(8, queue->workers() * 2));
+    running = true;
+    fprintf(stderr, "listening on %s with %d workers\n", path.c_str(), queue->workers());
+
+    /*接受连接和读请求都在这个线程里用poll进行，连上后不发送或发得很慢的客户端不会挡住其它连接*/
+    std::vector<PendingRequest> pending;
+    std::vector<pollfd> items;
+    while(running){
+        items.assign(1, pollfd{listenFd, POLLIN, 0});
+        for(auto &request : pending)
+            items.push_back(pollfd{request.fd, POLLIN, 0});
+        int ready = poll(items.data(), items.size(), pollMilliseconds);
+        if(ready < 0 && errno != EINTR)
+            break;
+        auto now = std::chrono::steady_clock::now();
+        for(size_t i = pending.size(); i-- > 0; ){
+            auto &request = pending[i];
+            bool closed = false;
+            if(ready > 0 && items[i + 1].revents != 0){
+                char block[4096];
+                ssize_t n = recv(request.fd, block, sizeof(block), 0);
+                closed = n <= 0;
+                if(n > 0)
+                    request.data.append(block, n);
+            }
+            std::string dir;
+            std::vector<std::string> args;
+            if(parseRequest(request.data, &dir, &args))
+                _accept(request.fd, dir, args);
+            else if(closed || now > request.deadline || request.data.size() > maxRequestBytes){
+                sendLine(request.fd, "failed incomplete request");
+                close(request.fd);
+            }
+            else
+                continue;
+            pending.erase(pending.begin() + i);
+        }
+        if(ready > 0 && items[0].revents != 0){
+            /*stop里shutdown之后accept返回错误*/
+            int fd = accept(listenFd, nullptr, nullptr);
+            if(fd < 0 && errno != EINTR && errno != EAGAIN && errno != ECONNABORTED)
+                break;
+            if(fd >= 0)
+                pending.push_back(PendingRequest{fd, std::string(),
+                                                 now + std::chrono::seconds(requestTimeoutSeconds)});
+        }
+    }
+    for(auto &request : pending){
+        sendLine(request.fd, "cancelled server stopping");
+        close(request.fd);
+    }
+    /*正在执行的任务提交断点后返回，还没开始的任务回复cancelled*/
+    for(auto &converter : converters)
+        converter->stop();
+    queue->stop();
+    close(listenFd);
+    listenFd = -1;
+    unlink(path.c_str());
+    return true;
+}
+
+void JobServer::stop()
+{
+    running = false;
+    /*shutdown可以在信号处理函数中调用，accept随即返回错误*/
+    if(listenFd >= 0)
+        shutdown(listenFd, SHUT_RDWR);
+}
+
+void JobServer::_accept(int fd, const std::string &dir, const std::vector<std::string> &args)
+{
+    Options options;
+    std::string error;
+    if(dir.empty() || dir[0] != '/')
+        error = "incomplete request";
+    else if(!options.parse(args, &error))
+        error = "invalid argument: " + error;
+    else if(options.input.empty())
+        error = "no input";
+    else if(options.isPipe() || !options.serve.empty() || !options.batch.empty() || !options.watch.empty())
+        error = "pipes, --serve, --batch and --watch cannot be used in a job";
+    options.input = absolutePath(dir, options.input);
+    if(!options.output.empty())
+        options.output = absolutePath(dir, options.output);
+    if(!options.cache.empty())
+        options.cache = absolutePath(dir, options.cache);
+    if(!error.empty()){
+        sendLine(fd, "failed " + error);
+        close(fd);
+        return;
+    }
+
+    /*先回复排队位置再提交，之后这个连接只由执行任务的线程写*/
+    sendLine(fd, "queued " + std::to_string(queue->ahead(options.priority)));
+    /*任务执行期间连接保持打开，结果在工作线程里回复*/
+    if(queue->submit(options.priority, [this, fd, options](int worker){ _runJob(fd, worker, options);}) < 0){
+        sendLine(fd, "cancelled server stopping");
+        close(fd);
+    }
+}
+
+void JobServer::_runJob(int fd, int worker, const Options &options)
+{
+    if(worker < 0){
+        sendLine(fd, "cancelled server stopping");
+        close(fd);
+        return;
+    }
+    Converter &converter = *converters[worker];
+    sendLine(fd, "started " + std::to_string(worker));
+    ConversionJob job;
+    std::string error, result;
+    double limit = maxMemory;
+    if(options.maxMemory > 0 && (limit <= 0 || options.maxMemory < limit))
+        limit = options.maxMemory;
+    double estimate = 0;
+    /*任务自己的--cache优先，否则用服务的缓存目录*/
+    ConversionCache jobCache;
+    ConversionCache &useCache = options.cache.empty() ? cache : jobCache;
+    jobCache.setDirectory(options.cache);
+    bool cached = false;
+    if(!job.prepare(options, converter, &error))
+        result = "failed " + error;
+    else if((cached = job.fetchCached(useCache, options.input))){
+        if(options.verbose)
+            sendLine(fd, "message cache hit");
+        result = "done " + job.outputPath();
+    }
+    else if(limit > 0 && (estimate = estimateMemory(options, converter, job.config)) > limit){
+        char text[128];
+        snprintf(text, sizeof(text), "failed needs about %.0f MB, limit is %.0f MB", estimate, limit);
+        result = text;
+    }
+    else{
+        auto deadline = std::chrono::steady_clock::now()
+                + std::chrono::milliseconds((int64_t)(options.timeout * 1000));
+        bool timedOut = false;
+        Converter::Callbacks callbacks;
+        if(options.verbose)
+            callbacks.message = [fd](const std::string &msg){ sendLine(fd, "message " + msg);};
+        /*进度每处理一块回调一次，在这里检查超时*/
+        if(options.timeout > 0)
+            callbacks.progress = [&](int64_t, int64_t){
+                if(!timedOut && std::chrono::steady_clock::now() > deadline){
+                    timedOut = true;
+                    converter.stop();
+                }
+            };
+        converter.setCallbacks(callbacks);
+        converter.setConfig(job.config);
+        auto status = running ? converter.run() : Converter::Cancelled;
+        converter.setCallbacks(Converter::Callbacks());
+        if(status == Converter::Finished){
+            if(converter.save(job.output)){
+                result = "done " + job.outputPath();
+                job.storeCached(useCache);
+            }
+            else
+                result = "failed cannot write " + job.output;
+        }
+        else if(status == Converter::Cancelled)
+            result = timedOut ? "cancelled timeout" : "cancelled server stopping";
+        else
+            result = "failed conversion failed";
+    }
+    sendLine(fd, result);
+    close(fd);
+    fprintf(stderr, "worker %d: %s: %s%s\n", worker, options.input.c_str(), result.c_str(), cached ? " (cached)" : "");
+}
+
+int JobServer::submit(const std::string &path, const std::vector<std::string> &args)
+{
+    sockaddr_un address;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || !makeAddress(path, &address) || connect(fd, (sockaddr *)&address, sizeof(address)) != 0){
+        fprintf(stderr, "cannot connect to %s\n", path.c_str());
+        if(fd >= 0)
+            close(fd);
+        return 1;
+    }
+    char dir[4096];
+    if(getcwd(dir, sizeof(dir)) == nullptr){
+        close(fd);
+        return 1;
+    }
+    sendLine(fd, dir);
+    for(auto &arg : args)
+        sendLine(fd, arg);
+    sendLine(fd, "");
+
+    /*结果行决定退出码，和本地转换一致*/
+    std::string buffer, line;
+    int code = 1;
+    while(readLine(fd, buffer, &line)){
+        auto space = line.find(' ');
+        auto word = line.substr(0, space);
+        auto rest = space == std::string::npos ? std::string() : line.substr(space + 1);
+        if(word == "message")
+            fprintf(stderr, "%s\n", rest.c_str());
+        else if(word == "done"){
+            code = 0;
+            break;
+        }
+        else if(word == "cancelled" || word == "failed"){
+            fprintf(stderr, "%s: %s\n", word.c_str(), rest.c_str());
+            code = word == "cancelled" ? 130 : 1;
+            break;
+        }
+    }
+    close(fd);
+    return code;
+}
+
+#else
+
+JobServer::JobServer() :
+    workers(0),
+    maxMemory(0),
+    listenFd(-1),
+    running(false)
+{
+}
+
+JobServer::~JobServer()
+{
+}
+
+void JobServer::warm(int, int)
+{
+}
+
+bool JobServer::run(const std::string &)
+{
+    fprintf(stderr, "the job server needs Unix domain sockets\n");
+    return false;
+}
+
+void JobServer::stop()
+{
+}
+
+int JobServer::submit(const std::string &, const std::vector<std::string> &)
+{
+    fprintf(stderr, "the job server needs Unix domain sockets\n");
+    return 1;
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "converter.h"
+#include "jobqueue.h"
+#include "conversioncache.h"
+#include "options.h"
+
+/**
+ * @brief 本机后台转换服务，监听Unix domain socket，不开网络端口
+ * 进程常驻，工作线程各自保留一个Converter，SwrPool里的滤波器和转换用的缓冲在任务之间复用，
+ * 批量转换时不用每次启动进程、重新计算滤波器。
+ *
+ * 协议为文本行，一个连接提交一个任务：客户端先发送工作目录，再逐行发送命令行参数（和本地转换相同），
+ * 空行结束，参数里的相对路径按客户端的工作目录解析；服务端依次回复
+ *   queued POSITION        排队，POSITION为前面还没开始的任务数
+ *   started WORKER
+ *   message TEXT           只在有-v时发送
+ *   done PATH | cancelled REASON | failed REASON
+ * 之后关闭连接
+ */
+class JobServer
+{
+public:
+    JobServer();
+    ~JobServer();
+
+    /**
+     * @brief 以下设置在run之前调用
+     */
+    void setWorkers(const int &workers);
+    /**
+     * @brief 单个任务估计占用内存的上限（MB），任务自己的--max-memory不能超过它，0为不限制
+     */
+    void setMaxMemory(const double &megabytes);
+    /**
+     * @brief 预先为立体声16位的采样率组合建立滤波器
+     */
+    void warm(int inRate, int outRate);
+    /**
+     * @brief 没有自己指定--cache的任务使用的缓存目录
+     */
+    bool setCache(const std::string &dir);
+
+    /**
+     * @brief 在path上监听，直到stop后返回；无法建立socket时返回false
+     */
+    bool run(const std::string &path);
+    /**
+     * @brief 可以在信号处理函数中调用：停止接受连接，正在执行的任务提交断点后结束
+     */
+    void stop();
+
+    /**
+     * @brief 客户端：提交args描述的任务并等待结果，返回进程的退出码
+     */
+    static int submit(const std::string &path, const std::vector<std::string> &args);
+
+private:
+    void _accept(int fd, const std::string &dir, const std::vector<std::string> &args);
+    void _runJob(int fd, int worker, const Options &options);
+private:
+    int workers;
+    double maxMemory;
+    std::unique_ptr<JobQueue> queue;
+    /*每个工作线程一个，只在对应的线程里使用*/
+    std::vector<std::unique_ptr<Converter>> converters;
+    ConversionCache cache;
+    int listenFd;
+    std::atomic<bool> running;
+};
+
+inline void JobServer::setWorkers(const int &workers)                           {   this->workers = workers;}
+inline void JobServer::setMaxMemory(const double &megabytes)                    {   maxMemory = megabytes;}
+inline bool JobServer::setCache(const std::string &dir)                         {   return cache.setDirectory(dir);}
+#endif // JOBSERVER_H
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <string>
+#include "converter.h"
+#include "options.h"
+#include "pipeconverter.h"
+#include "jobserver.h"
+#include "folderwatch.h"
+#include "batchconverter.h"
+
+namespace {
+
+/*收到中断信号时停止转换，run提交断点后返回；服务和监视模式下停止服务*/
+Converter activeConverter;
+JobServer server;
+JobServer *activeServer = nullptr;
+FolderWatch folderWatch;
+FolderWatch *activeWatch = nullptr;
+BatchConverter batchConverter;
+BatchConverter *activeBatch = nullptr;
+
+void interrupt(int)
+{
+    activeConverter.stop();
+    if(activeServer != nullptr)
+        activeServer->stop();
+    if(activeWatch != nullptr)
+        activeWatch->stop();
+    if(activeBatch != nullptr)
+        activeBatch->stop();
+}
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: pcm2wav-cli [options] input [output]\n"
+            "       pcm2wav-cli [options] --batch DIR input...\n"
+            "  output is the file name without extension, default is input_out\n"
+            "  use - as input to read raw PCM from stdin, as output to write to stdout\n"
+            "  (raw or wav only); pipes are converted while reading\n"
+            "  -f, --src-format FMT   raw input format: u8 s8 s16 s24 s32 flt dbl (default s16)\n"
+            "  -r, --src-rate N       raw input sample rate (default 48000)\n"
+            "  -c, --src-channels N   raw input channels (default 2)\n"
+            "  -F, --format FMT       output format, default is the source format\n"
+            "  -R, --rate N           output sample rate, default is the source rate\n"
+            "  -C, --channels N       output channels, default is the source channels\n"
+            "  -t, --type TYPE        raw wav rf64 aiff aifc caf w64 (default wav)\n"
+            "  -q, --quality Q        fast normal high best (default normal)\n"
+            "      --polyphase        use the built-in polyphase resampler when possible\n"
+            "      --measure-loudness add BS.1770 loudness and true peak to the report (-v)\n"
+            "      --normalize LUFS   loudness normalization target\n"
+            "      --trim             remove leading, trailing and long silence\n"
+            "      --checkpoint SEC   save progress to output.resume every SEC seconds of\n"
+            "                         input; an interrupted run continues from there\n"
+            "      --cache DIR        reuse the output of an earlier conversion of the same\n"
+            "                         input with the same settings (hardlink or reflink)\n"
+            "      --cache-stats      print the hit and miss counts of the --cache DIR\n"
+            "  -v, --verbose          print progress messages\n"
+            "job server (Unix domain socket):\n"
+            "      --serve SOCKET     run as a server, converting jobs sent to SOCKET\n"
+            "      --workers N        worker threads, default is the number of cores\n"
+            "      --warm IN:OUT      prepare the resampling filter for these rates\n"
+            "      --max-memory MB    server: limit for every job; job: its own limit\n"
+            "      --server SOCKET    send this conversion to a running server\n"
+            "      --priority N       jobs with higher priority run first (default 0)\n"
+            "      --timeout SEC      cancel the job after SEC seconds\n"
+            "batch mode:\n"
+            "      --batch DIR        convert all inputs into DIR, the largest first\n"
+            "      --workers N        worker threads, default is the number of cores\n"
+            "      --segment SEC      split files longer than two segments so that idle\n"
+            "                         workers share them (default 30, 0 to disable)\n"
+            "watch mode (inotify):\n"
+            "      --watch DIR        convert audio files as they are written to DIR\n"
+            "      --output-dir DIR   where converted files go, default is DIR/converted\n"
+            "      --workers N        files converted at the same time\n"
+            "      --max-queued N     stop taking new files while N are waiting\n"
+            "                         (default twice the workers)\n");
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    std::string error;
+    if(!options.parse(std::vector<std::string>(argv + 1, argv + argc), &error)){
+        fprintf(stderr, "invalid argument: %s\n", error.c_str());
+        usage();
+        return 2;
+    }
+    if(options.help){
+        usage();
+        return 0;
+    }
+    if(options.cacheStats){
+        if(options.cache.empty()){
+            fprintf(stderr, "--cache-stats needs --cache DIR\n");
+            return 2;
+        }
+        ConversionCache cache;
+        cache.setDirectory(options.cache);
+        auto totals = cache.totals();
+        int64_t lookups = totals.hits + totals.misses;
+        printf("hits %lld, misses %lld (%.1f%% hit rate), stored %lld\n"
+               "saved %.1f MB of output, hashed %.1f MB of input in %.2f s\n",
+               (long long)totals.hits, (long long)totals.misses,
+               lookups > 0 ? 100.0 * totals.hits / lookups : 0.0, (long long)totals.stores,
+               totals.savedBytes / (1024.0 * 1024.0), totals.hashedBytes / (1024.0 * 1024.0), totals.hashSeconds);
+        return 0;
+    }
+    /*后台服务：常驻进程，按优先级执行其它进程提交的任务*/
+    if(!options.serve.empty()){
+        activeServer = &server;
+        server.setWorkers(options.workers);
+        server.setMaxMemory(options.maxMemory);
+        if(!server.setCache(options.cache))
+            fprintf(stderr, "cannot use cache directory %s\n", options.cache.c_str());
+        for(auto &rates : options.warm)
+            server.warm(rates.first, rates.second);
+        signal(SIGINT, interrupt);
+        signal(SIGTERM, interrupt);
+        return server.run(options.serve) ? 0 : 1;
+    }
+    /*批量转换：大文件拆段，空闲的线程窃取其它线程的段*/
+    if(!options.batch.empty()){
+        if(options.inputs.empty()){
+            usage();
+            return 2;
+        }
+        activeBatch = &batchConverter;
+        batchConverter.setOptions(options);
+        batchConverter.setOutputDir(options.batch);
+        batchConverter.setWorkers(options.workers);
+        batchConverter.setSegmentDuration(options.segment);
+        if(!batchConverter.setCache(options.cache))
+            fprintf(stderr, "cannot use cache directory %s\n", options.cache.c_str());
+        signal(SIGINT, interrupt);
+        signal(SIGTERM, interrupt);
+        return batchConverter.run(options.inputs) ? 0 : 1;
+    }
+    /*监视模式：常驻进程，转换写进目录的文件*/
+    if(!options.watch.empty()){
+        activeWatch = &folderWatch;
+        folderWatch.setOptions(options);
+        folderWatch.setOutputDir(options.outputDir);
+        folderWatch.setWorkers(options.workers);
+        folderWatch.setMaxQueued(options.maxQueued);
+        if(!folderWatch.setCache(options.cache))
+            fprintf(stderr, "cannot use cache directory %s\n", options.cache.c_str());
+        signal(SIGINT, interrupt);
+        signal(SIGTERM, interrupt);
+        return folderWatch.run(options.watch) ? 0 : 1;
+    }
+    if(options.input.empty()){
+        usage();
+        return 2;
+    }
+    /*输入或输出为"-"时走管道模式，边读边写*/
+    bool pipe = options.isPipe();
+    if(pipe && (options.normalize || options.trim || options.checkpoint > 0 || !options.server.empty() || !options.cache.empty())){
+        fprintf(stderr, "--normalize, --trim, --checkpoint, --cache and --server need the whole input and cannot be used with pipes\n");
+        return 2;
+    }
+    if(!options.server.empty())
+        return JobServer::submit(options.server, std::vector<std::string>(argv + 1, argv + argc));
+
+    Converter &converter = activeConverter;
+    Converter::Callbacks callbacks;
+    bool verbose = options.verbose;
+    callbacks.message = [verbose](const std::string &msg){
+        if(verbose)
+            fprintf(stderr, "%s\n", msg.c_str());
+    };
+    converter.setCallbacks(callbacks);
+    ConversionJob job;
+    if(!job.prepare(options, converter, &error)){
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    auto &config = job.config;
+
+    if(pipe){
+        if(options.polyphase && verbose)
+            fprintf(stderr, "pipe mode always uses swresample\n");
+        PipeConverter pipeConverter;
+        pipeConverter.setSource({config.srcFormat, config.srcLayout, config.srcRate}, config.srcCoding,
+                                job.srcOffset, job.srcSize);
+        pipeConverter.setOutput({config.dstFormat, config.dstLayout, config.dstRate}, config.dstCoding, config.container);
+        pipeConverter.setQuality(config.quality);
+        auto path = job.output == "-" ? job.output : job.output + "." + AudioContainer::extension(config.container);
+        return pipeConverter.run(options.input, path) ? 0 : 1;
+    }
+
+    /*相同的输入和参数转换过，直接使用缓存的输出*/
+    ConversionCache cache;
+    if(!options.cache.empty() && !cache.setDirectory(options.cache))
+        fprintf(stderr, "cannot use cache directory %s\n", options.cache.c_str());
+    if(job.fetchCached(cache, options.input)){
+        if(verbose)
+            fprintf(stderr, "cache hit, output linked from %s\n", options.cache.c_str());
+        return 0;
+    }
+
+    if(options.checkpoint > 0){
+        signal(SIGINT, interrupt);
+        signal(SIGTERM, interrupt);
+    }
+    converter.setConfig(config);
+    auto status = converter.run();
+    if(status == Converter::Cancelled){
+        fprintf(stderr, "cancelled, run again to resume\n");
+        return 130;
+    }
+    if(status != Converter::Finished){
+        fprintf(stderr, "conversion failed\n");
+        return 1;
+    }
+    if(!converter.save(job.output)){
+        fprintf(stderr, "cannot write %s\n", job.outputPath().c_str());
+        return 1;
+    }
+    if(cache.isEnabled() && !job.storeCached(cache))
+        fprintf(stderr, "cannot store %s in the cache\n", job.outputPath().c_str());
+    return 0;
+}
@@ -0,0 +1,307 @@
+#include "options.h"
+#include <stdlib.h>
+
+namespace {
+
+/*s24是3字节紧凑存放，其它和ffmpeg的交错格式名相同*/
+bool parseFormat(const std::string &name, AVSampleFormat *format, SampleCodec::Coding *coding)
+{
+    *coding = SampleCodec::Native;
+    if(name == "s24"){
+        *format = AV_SAMPLE_FMT_S32;
+        *coding = SampleCodec::Packed24;
+        return true;
+    }
+    if(name == "s8"){
+        *format = AV_SAMPLE_FMT_U8;
+        *coding = SampleCodec::Signed8;
+        return true;
+    }
+    *format = av_get_sample_fmt(name.c_str());
+    if(*format == AV_SAMPLE_FMT_NONE || av_sample_fmt_is_planar(*format))
+        return false;
+    return true;
+}
+
+bool parseType(const std::string &name, AudioContainer::Type *type)
+{
+    const AudioContainer::Type types[] = {AudioContainer::Raw, AudioContainer::WAV, AudioContainer::AIFF,
+                                          AudioContainer::AIFC, AudioContainer::CAF, AudioContainer::W64};
+    for(auto t : types){
+        if(name == AudioContainer::extension(t) || (t == AudioContainer::Raw && name == "raw")){
+            *type = t;
+            return true;
+        }
+    }
+    /*RF64的扩展名也是wav*/
+    if(name == "rf64"){
+        *type = AudioContainer::RF64;
+        return true;
+    }
+    return false;
+}
+
+bool parseQuality(const std::string &name, ResamplerOptions::Quality *quality)
+{
+    for(int q = ResamplerOptions::Fast; q <= ResamplerOptions::Best; ++q){
+        if(name == ResamplerOptions::name((ResamplerOptions::Quality)q)){
+            *quality = (ResamplerOptions::Quality)q;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*IN:OUT，比如44100:48000*/
+bool parseRates(const std::string &text, std::pair<int, int> *rates)
+{
+    auto colon = text.find(':');
+    if(colon == std::string::npos)
+        return false;
+    rates->first = atoi(text.substr(0, colon).c_str());
+    rates->second = atoi(text.substr(colon + 1).c_str());
+    return rates->first > 0 && rates->second > 0;
+}
+
+}
+
+Options::Options() :
+    srcFormat(AV_SAMPLE_FMT_S16),
+    srcCoding(SampleCodec::Native),
+    srcRate(48000),
+    srcChannels(2),
+    dstFormat(AV_SAMPLE_FMT_NONE),
+    dstCoding(SampleCodec::Native),
+    dstRate(0),
+    dstChannels(0),
+    type(AudioContainer::WAV),
+    quality(ResamplerOptions::Normal),
+    polyphase(false),
+    measureLoudness(false),
+    normalize(false),
+    loudness(0),
+    trim(false),
+    checkpoint(0),
+    verbose(false),
+    help(false),
+    cacheStats(false),
+    priority(0),
+    maxMemory(0),
+    timeout(0),
+    workers(0),
+    segment(30),
+    maxQueued(0)
+{
+}
+
+bool Options::parse(const std::vector<std::string> &args, std::string *error)
+{
+    for(size_t i = 0; i < args.size(); ++i){
+        const std::string &arg = args[i];
+        /*带参数的选项取下一个参数，缺少时报错*/
+        auto value = [&](std::string &v){
+            if(i + 1 >= args.size())
+                return false;
+            v = args[++i];
+            return true;
+        };
+        std::string v;
+        std::pair<int, int> rates;
+        bool ok = true;
+        if(arg == "-f" || arg == "--src-format")
+            ok = value(v) && parseFormat(v, &srcFormat, &srcCoding);
+        else if(arg == "-r" || arg == "--src-rate")
+            ok = value(v) && (srcRate = atoi(v.c_str())) > 0;
+        else if(arg == "-c" || arg == "--src-channels")
+            ok = value(v) && (srcChannels = atoi(v.c_str())) > 0;
+        else if(arg == "-F" || arg == "--format")
+            ok = value(v) && parseFormat(v, &dstFormat, &dstCoding);
+        else if(arg == "-R" || arg == "--rate")
+            ok = value(v) && (dstRate = atoi(v.c_str())) > 0;
+        else if(arg == "-C" || arg == "--channels")
+            ok = value(v) && (dstChannels = atoi(v.c_str())) > 0;
+        else if(arg == "-t" || arg == "--type")
+            ok = value(v) && parseType(v, &type);
+        else if(arg == "-q" || arg == "--quality")
+            ok = value(v) && parseQuality(v, &quality);
+        else if(arg == "--polyphase")
+            polyphase = true;
+        else if(arg == "--measure-loudness")
+            measureLoudness = true;
+        else if(arg == "--normalize"){
+            ok = value(v);
+            loudness = atof(v.c_str());
+            normalize = true;
+        }
+        else if(arg == "--trim")
+            trim = true;
+        else if(arg == "--checkpoint")
+            ok = value(v) && (checkpoint = atof(v.c_str())) > 0;
+        else if(arg == "-v" || arg == "--verbose")
+            verbose = true;
+        else if(arg == "--priority"){
+            ok = value(v);
+            priority = atoi(v.c_str());
+        }
+        else if(arg == "--max-memory")
+            ok = value(v) && (maxMemory = atof(v.c_str())) > 0;
+        else if(arg == "--timeout")
+            ok = value(v) && (timeout = atof(v.c_str())) > 0;
+        else if(arg == "--server")
+            ok = value(v) && !(server = v).empty();
+        else if(arg == "--serve")
+            ok = value(v) && !(serve = v).empty();
+        else if(arg == "--workers")
+            ok = value(v) && (workers = atoi(v.c_str())) > 0;
+        else if(arg == "--warm"){
+            ok = value(v) && parseRates(v, &rates);
+            warm.push_back(rates);
+        }
+        else if(arg == "--batch")
+            ok = value(v) && !(batch = v).empty();
+        else if(arg == "--segment")
+            ok = value(v) && (segment = atof(v.c_str())) >= 0;
+        else if(arg == "--watch")
+            ok = value(v) && !(watch = v).empty();
+        else if(arg == "--output-dir")
+            ok = value(v) && !(outputDir = v).empty();
+        else if(arg == "--max-queued")
+            ok = value(v) && (maxQueued = atoi(v.c_str())) > 0;
+        else if(arg == "--cache")
+            ok = value(v) && !(cache = v).empty();
+        else if(arg == "--cache-stats")
+            cacheStats = true;
+        else if(arg == "-h" || arg == "--help")
+            help = true;
+        else if(arg.size() > 1 && arg[0] == '-')
+            ok = false;
+        else
+            inputs.push_back(arg);
+        if(!ok){
+            *error = arg;
+            return false;
+        }
+    }
+    /*批量转换时全部是输入，否则为输入和输出*/
+    if(batch.empty()){
+        if(inputs.size() > 2){
+            *error = inputs[2];
+            return false;
+        }
+        if(inputs.size() > 0)
+            input = inputs[0];
+        if(inputs.size() > 1)
+            output = inputs[1];
+        inputs.clear();
+    }
+    return true;
+}
+
+bool Options::isPipe() const
+{
+    return input == "-" || output == "-";
+}
+
+std::string Options::outputName() const
+{
+    if(!output.empty())
+        return output;
+    if(input == "-")
+        return "-";
+    auto dot = input.find_last_of('.');
+    auto slash = input.find_last_of("/\\");
+    return (dot != std::string::npos && (slash == std::string::npos || dot > slash) ? input.substr(0, dot) : input) + "_out";
+}
+
+bool ConversionJob::prepare(const Options &options, Converter &converter, std::string *error)
+{
+    AVSampleFormat srcFormat = options.srcFormat, dstFormat = options.dstFormat;
+    SampleCodec::Coding srcCoding = options.srcCoding, dstCoding = options.dstCoding;
+    int srcRate = options.srcRate, dstRate = options.dstRate;
+    config = ConversionConfig();
+    config.srcFormat = srcFormat;
+    config.srcCoding = srcCoding;
+    config.srcRate = srcRate;
+    config.srcLayout = av_get_default_channel_layout(options.srcChannels);
+    converter.setConfig(config);
+    if(options.input != "-" && !converter.open(options.input)){
+        *error = "cannot open " + options.input;
+        return false;
+    }
+    /*源文件中的存放方式，封装格式的参数来自文件头*/
+    bool raw = options.input == "-" || converter.isRaw();
+    int64_t srcLayout = config.srcLayout;
+    srcOffset = 0;
+    srcSize = -1;
+    if(!raw){
+        auto &info = converter.sourceInfo();
+        info.toSampleFormat(&srcFormat, &srcCoding);
+        srcLayout = info.layout;
+        srcRate = info.sampleRate;
+        srcOffset = info.dataOffset;
+        srcSize = info.dataSize;
+    }
+    /*没有指定的输出参数和源相同*/
+    if(dstFormat == AV_SAMPLE_FMT_NONE){
+        dstFormat = srcFormat;
+        dstCoding = srcCoding;
+        /*写出的数据按WAV的data块存放，封装需要的字节序和符号由AudioWriter转换*/
+        dstFormat = SampleCodec::decodedFormat(dstCoding, dstFormat);
+        if(dstCoding == SampleCodec::Packed24BE)
+            dstCoding = SampleCodec::Packed24;
+        else if(dstCoding != SampleCodec::Packed24 && (options.type != AudioContainer::Raw || !raw))
+            dstCoding = SampleCodec::Native;
+    }else if(dstCoding == SampleCodec::Signed8 && options.type != AudioContainer::Raw){
+        /*-F s8只对raw有意义：8位WAV规定无符号，AIFF、CAF等的有符号8位由AudioWriter转换*/
+        dstCoding = SampleCodec::Native;
+    }
+    /*管道模式直接使用源的参数，这里记下确定后的值*/
+    if(!raw){
+        config.srcFormat = srcFormat;
+        config.srcCoding = srcCoding;
+        config.srcRate = srcRate;
+        config.srcLayout = srcLayout;
+    }
+    config.dstFormat = dstFormat;
+    config.dstCoding = dstCoding;
+    config.dstRate = dstRate > 0 ? dstRate : srcRate;
+    config.dstLayout = options.dstChannels > 0 ? av_get_default_channel_layout(options.dstChannels) : srcLayout;
+    config.container = options.type;
+    config.quality = options.quality;
+    config.backend = options.polyphase ? ResamplerOptions::Polyphase : ResamplerOptions::Swresample;
+    config.measureLoudness = options.measureLoudness;
+    config.normalize = options.normalize;
+    config.targetLoudness = options.loudness;
+    config.trimSilence = options.trim;
+    output = options.outputName();
+    if(options.checkpoint > 0){
+        config.checkpointPath = output + ".resume";
+        config.checkpointInterval = options.checkpoint;
+    }
+    return true;
+}
+
+std::string ConversionJob::outputPath() const
+{
+    return output + "." + AudioContainer::extension(config.container);
+}
+
+bool ConversionJob::fetchCached(ConversionCache &cache, const std::string &input)
+{
+    cacheKey.clear();
+    /*声道映射拆成多个文件时输出不止一个，不缓存*/
+    if(!cache.isEnabled() || config.channelMap.size() > 1)
+        return false;
+    cacheKey = cache.key(input, config);
+    auto path = outputPath();
+    if(cache.fetch(cacheKey, path))
+        return true;
+    /*输出可能是上次命中时链接的缓存项，不能原地覆盖*/
+    cache.detach(path);
+    return false;
+}
+
+bool ConversionJob::storeCached(ConversionCache &cache)
+{
+    return !cacheKey.empty() && cache.store(cacheKey, outputPath());
+}
@@ -0,0 +1,107 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "converter.h"
+#include "conversioncache.h"
+
+/**
+ * @brief 命令行参数
+ * 本地转换和提交给后台服务的任务用同一套参数，服务端收到的就是客户端的参数列表
+ */
+struct Options
+{
+    Options();
+
+    std::string input;
+    std::string output;
+    AVSampleFormat srcFormat;
+    SampleCodec::Coding srcCoding;
+    int srcRate;
+    int srcChannels;
+    /*AV_SAMPLE_FMT_NONE和0表示和源相同*/
+    AVSampleFormat dstFormat;
+    SampleCodec::Coding dstCoding;
+    int dstRate;
+    int dstChannels;
+    AudioContainer::Type type;
+    ResamplerOptions::Quality quality;
+    bool polyphase;
+    bool measureLoudness;
+    bool normalize;
+    double loudness;
+    bool trim;
+    double checkpoint;
+    bool verbose;
+    bool help;
+    /*转换结果缓存目录，为空时不使用；cacheStats为打印累计的命中统计*/
+    std::string cache;
+    bool cacheStats;
+
+    /*提交给服务的任务：优先级、内存上限（MB）和超时（秒），0为不限制*/
+    int priority;
+    double maxMemory;
+    double timeout;
+    std::string server;
+
+    /*后台服务*/
+    std::string serve;
+    int workers;
+    /*预先建立滤波器的采样率组合*/
+    std::vector<std::pair<int, int>> warm;
+
+    /*批量转换：输出目录、全部输入和拆段的时长（秒）；也使用workers*/
+    std::string batch;
+    std::vector<std::string> inputs;
+    double segment;
+
+    /*监视目录，转换写完的文件；也使用workers*/
+    std::string watch;
+    std::string outputDir;
+    int maxQueued;
+
+    /**
+     * @brief 解析失败时error为出错的参数
+     */
+    bool parse(const std::vector<std::string> &args, std::string *error);
+    /**
+     * @brief 输入或输出为"-"
+     */
+    bool isPipe() const;
+    /**
+     * @brief 没有指定输出时为去掉扩展名的输入加上_out
+     */
+    std::string outputName() const;
+};
+
+/**
+ * @brief 一个转换任务：转换参数和按源文件确定的读取范围
+ */
+struct ConversionJob
+{
+    ConversionConfig config;
+    std::string output;
+    /*封装格式的数据位置，裸PCM为0和-1*/
+    int64_t srcOffset;
+    int64_t srcSize;
+    /*fetchCached算出的缓存键，不使用缓存时为空*/
+    std::string cacheKey;
+
+    /**
+     * @brief 按参数打开输入（"-"时不打开），没有指定的输出参数取源的参数
+     */
+    bool prepare(const Options &options, Converter &converter, std::string *error);
+    /**
+     * @brief 输出文件的完整路径
+     */
+    std::string outputPath() const;
+    /**
+     * @brief 命中时输出已经就位，返回true；未命中时记下键，转换保存后调用storeCached
+     */
+    bool fetchCached(ConversionCache &cache, const std::string &input);
+    bool storeCached(ConversionCache &cache);
+};
+
+#endif // OPTIONS_H
@@ -0,0 +1,179 @@
+#include "pipeconverter.h"
+#include <stdio.h>
+#include <algorithm>
+#include "wavheader.h"
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+namespace {
+
+const int readBlockBytes = 64 * 1024;
+
+/*Windows下标准输入输出默认是文本模式，会改动0x0A和0x1A*/
+void setBinary(FILE *fp)
+{
+#ifdef _WIN32
+    _setmode(_fileno(fp), _O_BINARY);
+#else
+    (void)fp;
+#endif
+}
+
+}
+
+PipeConverter::PipeConverter() :
+    srcFormat{AV_SAMPLE_FMT_S16, AV_CH_LAYOUT_STEREO, 48000},
+    dstFormat{AV_SAMPLE_FMT_S16, AV_CH_LAYOUT_STEREO, 48000},
+    srcCoding(SampleCodec::Native),
+    dstCoding(SampleCodec::Native),
+    container(AudioContainer::WAV),
+    srcOffset(0),
+    srcSize(-1),
+    out(nullptr),
+    ditherSeed(0)
+{
+}
+
+void PipeConverter::setSource(const StreamConverter::Format &format, SampleCodec::Coding coding,
+                              int64_t offset, int64_t size)
+{
+    srcFormat = format;
+    srcCoding = coding;
+    srcOffset = offset;
+    srcSize = size;
+}
+
+void PipeConverter::setOutput(const StreamConverter::Format &format, SampleCodec::Coding coding,
+                              AudioContainer::Type container)
+{
+    dstFormat = format;
+    dstCoding = coding;
+    this->container = container;
+}
+
+bool PipeConverter::run(const std::string &input, const std::string &output)
+{
+    bool toStdout = output == "-";
+    if(toStdout && container != AudioContainer::Raw && container != AudioContainer::WAV){
+        fprintf(stderr, "only raw and wav can be written to stdout\n");
+        return false;
+    }
+    /*内部格式为解码后的交错格式*/
+    StreamConverter::Format decoded = srcFormat;
+    decoded.format = SampleCodec::decodedFormat(srcCoding, av_get_packed_sample_fmt(srcFormat.format));
+    StreamConverter::Format target = dstFormat;
+    target.format = SampleCodec::decodedFormat(dstCoding, av_get_packed_sample_fmt(dstFormat.format));
+    if(!stream.open(decoded, target)){
+        fprintf(stderr, "Failed to initialize the resampling context\n");
+        return false;
+    }
+
+    FILE *in = stdin;
+    if(input == "-")
+        setBinary(stdin);
+    else{
+        in = fopen(input.c_str(), "rb");
+        if(in == nullptr || fseek(in, (long)srcOffset, SEEK_SET) != 0){
+            fprintf(stderr, "cannot open %s\n", input.c_str());
+            if(in != nullptr)
+                fclose(in);
+            return false;
+        }
+    }
+
+    auto wavFormat = WavFormat::fromSampleFormat(target.format, target.layout, target.rate);
+    if(dstCoding == SampleCodec::Packed24)
+        wavFormat.bitsPerSample = wavFormat.validBits = 24;
+    bool ok = true;
+    writer.reset();
+    out = nullptr;
+    if(toStdout){
+        out = stdout;
+        setBinary(stdout);
+        if(container == AudioContainer::WAV){
+            auto head = WavHeader::buildStreaming(wavFormat);
+            ok = _write(head.data(), head.size());
+        }
+    }
+    else{
+        writer = AudioWriter::create(container);
+        ok = writer->open(output, wavFormat);
+    }
+
+    /*解码按整帧进行，不满一帧的字节留到下一块*/
+    auto codedFormat = av_get_packed_sample_fmt(srcFormat.format);
+    int sampleBytes = SampleCodec::codedBytes(srcCoding, codedFormat);
+    int frameBytes = sampleBytes * decoded.channels();
+    std::vector<uint8_t> block(readBlockBytes + frameBytes);
+    std::vector<uint8_t> decodedBlock;
+    int64_t carry = 0, remaining = srcSize;
+    while(ok && remaining != 0){
+        int64_t want = readBlockBytes;
+        if(remaining > 0)
+            want = std::min<int64_t>(want, remaining);
+        int64_t n = fread(block.data() + carry, 1, want, in);
+        if(n <= 0)
+            break;
+        if(remaining > 0)
+            remaining -= n;
+        n += carry;
+        int64_t whole = n / frameBytes * frameBytes;
+        if(srcCoding == SampleCodec::Native)
+            ok = stream.push(block.data(), whole);
+        else{
+            int64_t count = whole / sampleBytes;
+            decodedBlock.resize(count * av_get_bytes_per_sample(decoded.format));
+            ok = SampleCodec::decode(srcCoding, codedFormat, block.data(), count, decodedBlock.data())
+                    && stream.push(decodedBlock.data(), decodedBlock.size());
+        }
+        carry = n - whole;
+        std::copy(block.begin() + whole, block.begin() + n, block.begin());
+        ok = ok && _drain();
+    }
+    if(ok && ferror(in)){
+        fprintf(stderr, "read error\n");
+        ok = false;
+    }
+    if(in != stdin)
+        fclose(in);
+    ok = ok && stream.finish() && _drain();
+    stream.close();
+
+    if(writer)
+        ok = writer->close() && ok;
+    else
+        ok = fflush(out) == 0 && ok;
+    writer.reset();
+    if(!ok)
+        fprintf(stderr, "pipe conversion failed\n");
+    return ok;
+}
+
+bool PipeConverter::_drain()
+{
+    int64_t bytes;
+    auto data = stream.peek(&bytes);
+    if(bytes == 0)
+        return true;
+    bool ok;
+    if(dstCoding == SampleCodec::Native)
+        ok = _write(data, bytes);
+    else{
+        auto format = stream.outputFormat().format;
+        int64_t count = bytes / av_get_bytes_per_sample(format);
+        encoded.resize(count * SampleCodec::codedBytes(dstCoding, format));
+        ok = SampleCodec::encode(dstCoding, format, data, count, encoded.data(), false, &ditherSeed)
+                && _write(encoded.data(), encoded.size());
+    }
+    stream.consume(bytes);
+    return ok;
+}
+
+bool PipeConverter::_write(const uint8_t *data, int64_t bytes)
+{
+    if(writer)
+        return writer->write(data, bytes);
+    return (int64_t)fwrite(data, 1, bytes, out) == bytes;
+}
@@ -0,0 +1,58 @@
+#ifndef PIPECONVERTER_H
+#define PIPECONVERTER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include "streamconverter.h"
+#include "samplecodec.h"
+#include "audiowriter.h"
+
+/**
+ * @brief 管道模式：边读边转换边写，中间不落盘
+ * 输入为"-"时从标准输入读裸PCM，否则从文件的dataOffset开始读；
+ * 输出为"-"时写到标准输出，只支持裸PCM和WAV（流式文件头），其它封装需要回写文件头，只能写文件。
+ * 响度归一化和静音裁剪需要完整的数据，由Converter处理
+ */
+class PipeConverter
+{
+public:
+    PipeConverter();
+
+    /**
+     * @brief size为-1时读到输入结束
+     */
+    void setSource(const StreamConverter::Format &format, SampleCodec::Coding coding,
+                   int64_t offset = 0, int64_t size = -1);
+    void setOutput(const StreamConverter::Format &format, SampleCodec::Coding coding,
+                   AudioContainer::Type container);
+    void setQuality(const ResamplerOptions::Quality &quality);
+    void setDither(const ResamplerOptions::Dither &method, const double &scale);
+
+    /**
+     * @brief output为完整的文件名或"-"，失败时错误信息写到标准错误
+     */
+    bool run(const std::string &input, const std::string &output);
+
+private:
+    bool _write(const uint8_t *data, int64_t bytes);
+    bool _drain();
+private:
+    StreamConverter stream;
+    StreamConverter::Format srcFormat;
+    StreamConverter::Format dstFormat;
+    SampleCodec::Coding srcCoding;
+    SampleCodec::Coding dstCoding;
+    AudioContainer::Type container;
+    int64_t srcOffset;
+    int64_t srcSize;
+    /*写到标准输出时为stdout，写文件时使用writer*/
+    FILE *out;
+    std::unique_ptr<AudioWriter> writer;
+    std::vector<uint8_t> encoded;
+    uint32_t ditherSeed;
+};
+
+inline void PipeConverter::setQuality(const ResamplerOptions::Quality &quality)  {   stream.setQuality(quality);}
+inline void PipeConverter::setDither(const ResamplerOptions::Dither &method, const double &scale)   {   stream.setDither(method, scale);}
+#endif // PIPECONVERTER_H
@@ -0,0 +1,76 @@
+#include "audioanalyzer.h"
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+namespace {
+double toDb(double value)
+{
+    return value > 0 ? 20 * log10(value) : -INFINITY;
+}
+}
+
+AudioAnalyzer::AudioAnalyzer(int channels, AVSampleFormat format)
+{
+    reset(channels, format);
+}
+
+void AudioAnalyzer::reset(int channels, AVSampleFormat format)
+{
+    nbChannels = std::max(channels, 1);
+    clip = AudioKernels::clipLevel(format);
+    totalFrames = 0;
+    stats.resize(nbChannels);
+    for(auto &s : stats)
+        AudioKernels::resetStats(&s);
+}
+
+void AudioAnalyzer::addBlock(const float *planar, int frames)
+{
+    if(frames <= 0)
+        return;
+    for(int c = 0; c < nbChannels; ++c)
+        AudioKernels::blockStats(planar + (int64_t)c * frames, frames, clip, &stats[c]);
+    totalFrames += frames;
+}
+
+std::vector<AudioAnalyzer::ChannelResult> AudioAnalyzer::result() const
+{
+    std::vector<ChannelResult> r(nbChannels);
+    for(int c = 0; c < nbChannels; ++c){
+        const auto &s = stats[c];
+        /*count不含NaN/Inf，全部无效时最值没有意义*/
+        r[c].peak = s.count > 0 ? std::max(fabs(s.min), fabs(s.max)) : 0;
+        r[c].rms = s.count > 0 ? sqrt(s.sumSq / s.count) : 0;
+        r[c].dcOffset = s.count > 0 ? s.sum / s.count : 0;
+        r[c].clipped = s.clipped;
+        r[c].nonFinite = s.nonFinite;
+    }
+    return r;
+}
+
+std::string AudioAnalyzer::report(const std::string &name) const
+{
+    std::string text = name;
+    char line[256];
+    snprintf(line, sizeof(line), ": %lld frames\n", (long long)totalFrames);
+    text += line;
+    auto r = result();
+    bool silent = true;
+    for(int c = 0; c < nbChannels; ++c){
+        snprintf(line, sizeof(line),
+                 "  ch%d peak %.2f dBFS, rms %.2f dBFS, dc %+.6f, clipped %lld, nan/inf %lld\n",
+                 c, toDb(r[c].peak), toDb(r[c].rms), r[c].dcOffset,
+                 (long long)r[c].clipped, (long long)r[c].nonFinite);
+        text += line;
+        if(r[c].peak > 0)
+            silent = false;
+        if(r[c].clipped > 0)
+            text += "  warning: clipping\n";
+        if(r[c].nonFinite > 0)
+            text += "  warning: NaN/Inf samples\n";
+    }
+    if(silent && totalFrames > 0)
+        text += "  warning: digital silence\n";
+    return text;
+}
@@ -0,0 +1,48 @@
+#ifndef AUDIOANALYZER_H
+#define AUDIOANALYZER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "audiokernels.h"
+
+/**
+ * @brief 转换过程中的逐声道统计
+ * 峰值、RMS、直流偏移、削波样本数以及NaN/Inf个数，
+ * 输入为AudioKernels::deinterleaveToFloat得到的按声道分开的数据
+ */
+class AudioAnalyzer
+{
+public:
+    struct ChannelResult{
+        double peak;
+        double rms;
+        double dcOffset;
+        int64_t clipped;
+        int64_t nonFinite;
+    };
+
+public:
+    explicit AudioAnalyzer(int channels = 1, AVSampleFormat format = AV_SAMPLE_FMT_S16);
+
+    void reset(int channels, AVSampleFormat format);
+    void addBlock(const float *planar, int frames);
+
+    int channels() const;
+    int64_t frames() const;
+    std::vector<ChannelResult> result() const;
+    /**
+     * @brief 生成一段文本报告，name用来区分源和目标
+     */
+    std::string report(const std::string &name) const;
+
+private:
+    int nbChannels;
+    float clip;
+    int64_t totalFrames;
+    std::vector<AudioKernels::BlockStats> stats;
+};
+
+inline int AudioAnalyzer::channels() const                                      {   return nbChannels;}
+inline int64_t AudioAnalyzer::frames() const                                    {   return totalFrames;}
+#endif // AUDIOANALYZER_H
@@ -0,0 +1,302 @@
+#include "audiokernels.h"
+#include <string.h>
+#include <math.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AUDIOKERNELS_SSE2
+#endif
+
+namespace {
+
+template<typename T>
+void deinterleave(const uint8_t *src, int channels, int frames, float *dst, float scale, float bias)
+{
+    /*
+     * 按64帧分块：块内的输入留在L1缓存中，每个声道的输出连续写入，
+     * 输入只从内存读一次，开销随声道数线性增长
+     */
+    const int tile = 64;
+    const T *in = reinterpret_cast<const T *>(src);
+    for(int start = 0; start < frames; start += tile){
+        int n = frames - start < tile ? frames - start : tile;
+        const T *p = in + (int64_t)start * channels;
+        for(int c = 0; c < channels; ++c){
+            float *out = dst + (int64_t)c * frames + start;
+            for(int i = 0; i < n; ++i)
+                out[i] = ((float)p[i * channels + c] - bias) * scale;
+        }
+    }
+}
+
+/*单声道时不需要跨步访问，单独走一遍连续循环，方便向量化*/
+template<typename T>
+void convert(const uint8_t *src, int count, float *dst, float scale, float bias)
+{
+    const T *in = reinterpret_cast<const T *>(src);
+    for(int i = 0; i < count; ++i)
+        dst[i] = ((float)in[i] - bias) * scale;
+}
+
+template<typename T>
+inline T quantize(float v, float lo, float hi)
+{
+    v = v < lo ? lo : (v > hi ? hi : v);
+    return (T)lrintf(v);
+}
+
+template<>
+inline float quantize<float>(float v, float, float)
+{
+    return v;
+}
+
+template<>
+inline double quantize<double>(float v, float, float)
+{
+    return v;
+}
+
+/*和deinterleave相同的分块方式，每个声道连续读，交错写回*/
+template<typename T>
+void interleave(const float *src, int64_t stride, int channels, int frames, uint8_t *dst,
+                float scale, float bias, float lo, float hi)
+{
+    const int tile = 64;
+    T *out = reinterpret_cast<T *>(dst);
+    for(int start = 0; start < frames; start += tile){
+        int n = frames - start < tile ? frames - start : tile;
+        T *p = out + (int64_t)start * channels;
+        for(int c = 0; c < channels; ++c){
+            const float *in = src + (int64_t)c * stride + start;
+            for(int i = 0; i < n; ++i)
+                p[i * channels + c] = quantize<T>(in[i] * scale + bias, lo, hi);
+        }
+    }
+}
+
+}
+
+bool AudioKernels::interleaveFromFloat(const float *src, int64_t stride, int channels, int frames,
+                                       float gain, AVSampleFormat format, uint8_t *dst)
+{
+    if(channels <= 0 || frames <= 0)
+        return frames == 0;
+    switch(format){
+    case AV_SAMPLE_FMT_U8:
+        interleave<uint8_t>(src, stride, channels, frames, dst, gain * 128, 128.0f, 0.0f, 255.0f);
+        return true;
+    case AV_SAMPLE_FMT_S16:
+        interleave<int16_t>(src, stride, channels, frames, dst, gain * 32768, 0.0f, -32768.0f, 32767.0f);
+        return true;
+    case AV_SAMPLE_FMT_S32:
+        /*2147483647不能用float精确表示，上限取float里不超过它的最大值*/
+        interleave<int32_t>(src, stride, channels, frames, dst, gain * 2147483648.0f, 0.0f,
+                            -2147483648.0f, 2147483520.0f);
+        return true;
+    case AV_SAMPLE_FMT_FLT:
+        interleave<float>(src, stride, channels, frames, dst, gain, 0.0f, 0.0f, 0.0f);
+        return true;
+    case AV_SAMPLE_FMT_DBL:
+        interleave<double>(src, stride, channels, frames, dst, gain, 0.0f, 0.0f, 0.0f);
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool AudioKernels::deinterleaveToFloat(const uint8_t *src, AVSampleFormat format,
+                                       int channels, int frames, float *dst)
+{
+    if(channels <= 0 || frames <= 0)
+        return frames == 0;
+    switch(format){
+    case AV_SAMPLE_FMT_U8:
+        if(channels == 1)
+            convert<uint8_t>(src, frames, dst, 1.0f / 128, 128.0f);
+        else
+            deinterleave<uint8_t>(src, channels, frames, dst, 1.0f / 128, 128.0f);
+        return true;
+    case AV_SAMPLE_FMT_S16:
+        if(channels == 1)
+            convert<int16_t>(src, frames, dst, 1.0f / 32768, 0.0f);
+        else
+            deinterleave<int16_t>(src, channels, frames, dst, 1.0f / 32768, 0.0f);
+        return true;
+    case AV_SAMPLE_FMT_S32:
+        if(channels == 1)
+            convert<int32_t>(src, frames, dst, 1.0f / 2147483648.0f, 0.0f);
+        else
+            deinterleave<int32_t>(src, channels, frames, dst, 1.0f / 2147483648.0f, 0.0f);
+        return true;
+    case AV_SAMPLE_FMT_FLT:
+        if(channels == 1)
+            memcpy(dst, src, frames * sizeof(float));
+        else
+            deinterleave<float>(src, channels, frames, dst, 1.0f, 0.0f);
+        return true;
+    case AV_SAMPLE_FMT_DBL:
+        if(channels == 1)
+            convert<double>(src, frames, dst, 1.0f, 0.0f);
+        else
+            deinterleave<double>(src, channels, frames, dst, 1.0f, 0.0f);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void AudioKernels::minMaxSumSq(const float *src, int count, float *min, float *max, double *sumSq)
+{
+    float mn = 0, mx = 0;
+    double sq = 0;
+    int i = 0;
+    if(count > 0)
+        mn = mx = src[0];
+#ifdef AUDIOKERNELS_SSE2
+    if(count >= 8){
+        __m128 vmin = _mm_loadu_ps(src), vmax = vmin;
+        __m128 vsq0 = _mm_setzero_ps(), vsq1 = _mm_setzero_ps();
+        /*float累加每4096个样本折算一次到double，避免长块精度损失*/
+        int flush = 0;
+        for(; i + 8 <= count; i += 8){
+            __m128 a = _mm_loadu_ps(src + i);
+            __m128 b = _mm_loadu_ps(src + i + 4);
+            vmin = _mm_min_ps(vmin, _mm_min_ps(a, b));
+            vmax = _mm_max_ps(vmax, _mm_max_ps(a, b));
+            vsq0 = _mm_add_ps(vsq0, _mm_mul_ps(a, a));
+            vsq1 = _mm_add_ps(vsq1, _mm_mul_ps(b, b));
+            if(++flush == 512){
+                float t[4];
+                _mm_storeu_ps(t, _mm_add_ps(vsq0, vsq1));
+                sq += (double)t[0] + t[1] + t[2] + t[3];
+                vsq0 = vsq1 = _mm_setzero_ps();
+                flush = 0;
+            }
+        }
+        float tmin[4], tmax[4], tsq[4];
+        _mm_storeu_ps(tmin, vmin);
+        _mm_storeu_ps(tmax, vmax);
+        _mm_storeu_ps(tsq, _mm_add_ps(vsq0, vsq1));
+        for(int k = 0; k < 4; ++k){
+            if(tmin[k] < mn) mn = tmin[k];
+            if(tmax[k] > mx) mx = tmax[k];
+            sq += tsq[k];
+        }
+    }
+#endif
+    for(; i < count; ++i){
+        float v = src[i];
+        if(v < mn) mn = v;
+        if(v > mx) mx = v;
+        sq += (double)v * v;
+    }
+    *min = mn;
+    *max = mx;
+    *sumSq = sq;
+}
+
+void AudioKernels::resetStats(BlockStats *stats)
+{
+    stats->min = 0;
+    stats->max = 0;
+    stats->sum = 0;
+    stats->sumSq = 0;
+    stats->count = 0;
+    stats->clipped = 0;
+    stats->nonFinite = 0;
+}
+
+void AudioKernels::blockStats(const float *src, int count, float clipLevel, BlockStats *stats)
+{
+    if(count <= 0)
+        return;
+    float mn = stats->count > 0 ? stats->min : INFINITY;
+    float mx = stats->count > 0 ? stats->max : -INFINITY;
+    double sum = 0, sq = 0;
+    int64_t clipped = 0, nonFinite = 0;
+    int i = 0;
+#ifdef AUDIOKERNELS_SSE2
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 vclip = _mm_set1_ps(clipLevel);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 vmin = _mm_set1_ps(mn), vmax = _mm_set1_ps(mx);
+    __m128 vsum = zero, vsq = zero;
+    __m128i vclipped = _mm_setzero_si128(), vbad = _mm_setzero_si128();
+    int flush = 0;
+    for(; i + 4 <= count; i += 4){
+        __m128 a = _mm_loadu_ps(src + i);
+        /*x - x对NaN和Inf都得到NaN，和自身比较不相等*/
+        __m128 d = _mm_sub_ps(a, a);
+        __m128 finite = _mm_cmpeq_ps(d, d);
+        a = _mm_and_ps(a, finite);
+        /*无效的样本在最值里换成当前的最值，累加时是0*/
+        vmin = _mm_min_ps(vmin, _mm_or_ps(a, _mm_andnot_ps(finite, vmin)));
+        vmax = _mm_max_ps(vmax, _mm_or_ps(a, _mm_andnot_ps(finite, vmax)));
+        vsum = _mm_add_ps(vsum, a);
+        vsq = _mm_add_ps(vsq, _mm_mul_ps(a, a));
+        /*比较结果为全1，即-1，减去就是计数*/
+        vclipped = _mm_sub_epi32(vclipped, _mm_castps_si128(_mm_cmpge_ps(_mm_and_ps(a, absMask), vclip)));
+        vbad = _mm_sub_epi32(vbad, _mm_castps_si128(_mm_cmpeq_ps(finite, zero)));
+        if(++flush == 1024){
+            float s[4], q[4];
+            _mm_storeu_ps(s, vsum);
+            _mm_storeu_ps(q, vsq);
+            for(int k = 0; k < 4; ++k){
+                sum += s[k];
+                sq += q[k];
+            }
+            vsum = vsq = zero;
+            flush = 0;
+        }
+    }
+    float tmin[4], tmax[4], s[4], q[4];
+    int32_t c[4], b[4];
+    _mm_storeu_ps(tmin, vmin);
+    _mm_storeu_ps(tmax, vmax);
+    _mm_storeu_ps(s, vsum);
+    _mm_storeu_ps(q, vsq);
+    _mm_storeu_si128((__m128i *)c, vclipped);
+    _mm_storeu_si128((__m128i *)b, vbad);
+    for(int k = 0; k < 4; ++k){
+        if(tmin[k] < mn) mn = tmin[k];
+        if(tmax[k] > mx) mx = tmax[k];
+        sum += s[k];
+        sq += q[k];
+        clipped += c[k];
+        nonFinite += b[k];
+    }
+#endif
+    for(; i < count; ++i){
+        float v = src[i];
+        if(v - v != 0){
+            ++nonFinite;
+            continue;
+        }
+        if(v < mn) mn = v;
+        if(v > mx) mx = v;
+        sum += v;
+        sq += (double)v * v;
+        if(fabsf(v) >= clipLevel)
+            ++clipped;
+    }
+    stats->min = mn;
+    stats->max = mx;
+    stats->sum += sum;
+    stats->sumSq += sq;
+    stats->count += count - nonFinite;
+    stats->clipped += clipped;
+    stats->nonFinite += nonFinite;
+}
+
+float AudioKernels::clipLevel(AVSampleFormat format)
+{
+    /*整数格式的正满刻度比负满刻度小一个量化级*/
+    switch(av_get_packed_sample_fmt(format)){
+    case AV_SAMPLE_FMT_U8:
+        return 127.0f / 128;
+    case AV_SAMPLE_FMT_S16:
+        return 32767.0f / 32768;
+    default:
+        return 1.0f;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef AUDIOKERNELS_H
+#define AUDIOKERNELS_H
+
+#include <stdint.h>
+extern "C"{
+#include "libavutil/samplefmt.h"
+}
+
+/**
+ * @brief 音频块处理的基础内核
+ * 全部以packed（交错）数据为输入，统一转为float后再做统计，
+ * 循环写成编译器可以自动向量化的形式，x86上的归约使用SSE
+ */
+namespace AudioKernels {
+
+/**
+ * @brief 将交错的采样转为按声道分开的float数据
+ * dst需要有channels * frames个float，第c个声道从dst + c * frames开始
+ * 整数格式归一化到[-1,1)，不支持的格式返回false
+ */
+bool deinterleaveToFloat(const uint8_t *src, AVSampleFormat format,
+                         int channels, int frames, float *dst);
+
+/**
+ * @brief deinterleaveToFloat的逆操作，第c个声道从src + c * stride开始
+ * 乘以gain后写成交错的format，整数格式四舍五入并限幅，不支持的格式返回false
+ */
+bool interleaveFromFloat(const float *src, int64_t stride, int channels, int frames,
+                         float gain, AVSampleFormat format, uint8_t *dst);
+
+/**
+ * @brief 一段连续float数据的最小值、最大值和平方和
+ */
+void minMaxSumSq(const float *src, int count, float *min, float *max, double *sumSq);
+
+/**
+ * @brief 分析用的累加量，blockStats会在原有值上继续累加
+ * NaN/Inf只计入nonFinite，不计入count，也不参与其它统计
+ */
+struct BlockStats{
+    float min;
+    float max;
+    double sum;
+    double sumSq;
+    int64_t count;
+    int64_t clipped;
+    int64_t nonFinite;
+};
+
+void resetStats(BlockStats *stats);
+void blockStats(const float *src, int count, float clipLevel, BlockStats *stats);
+
+/**
+ * @brief 转为float后认为是削波的绝对值门限
+ */
+float clipLevel(AVSampleFormat format);
+
+}
+
+#endif // AUDIOKERNELS_H
@@ -0,0 +1,400 @@
+#include "audioreader.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "wavheader.h"
+extern "C"{
+#include "libavutil/channel_layout.h"
+}
+
+namespace {
+
+const uint8_t w64RiffGuid[16] = {'r', 'i', 'f', 'f', 0x2E, 0x91, 0xCF, 0x11,
+                                 0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00};
+const uint8_t w64Suffix[12] = {0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1,
+                               0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A};
+
+uint16_t le16(const uint8_t *p) { return p[0] | p[1] << 8; }
+uint32_t le32(const uint8_t *p) { return le16(p) | (uint32_t)le16(p + 2) << 16; }
+uint64_t le64(const uint8_t *p) { return le32(p) | (uint64_t)le32(p + 4) << 32; }
+uint16_t be16(const uint8_t *p) { return p[0] << 8 | p[1]; }
+uint32_t be32(const uint8_t *p) { return (uint32_t)be16(p) << 16 | be16(p + 2); }
+uint64_t be64(const uint8_t *p) { return (uint64_t)be32(p) << 32 | be32(p + 4); }
+
+double extended(const uint8_t *p)
+{
+    int exponent = be16(p) & 0x7FFF;
+    uint64_t mantissa = be64(p + 2);
+    if(exponent == 0 || mantissa == 0)
+        return 0;
+    double v = ldexp((double)mantissa, exponent - 16383 - 63);
+    return (p[0] & 0x80) ? -v : v;
+}
+
+class File
+{
+public:
+    explicit File(const std::string &path) : fp(fopen(path.c_str(), "rb")), fileSize(0)
+    {
+        if(fp != nullptr && fseek(fp, 0, SEEK_END) == 0){
+            fileSize = ftell64();
+            fseek(fp, 0, SEEK_SET);
+        }
+    }
+    ~File()
+    {
+        if(fp != nullptr)
+            fclose(fp);
+    }
+    bool isOpen() const { return fp != nullptr; }
+    int64_t size() const { return fileSize; }
+    bool read(int64_t offset, void *dst, size_t n)
+    {
+        return seek64(offset) && fread(dst, 1, n, fp) == n;
+    }
+private:
+    int64_t ftell64()
+    {
+#ifdef _WIN32
+        return _ftelli64(fp);
+#else
+        return ftello(fp);
+#endif
+    }
+    bool seek64(int64_t offset)
+    {
+#ifdef _WIN32
+        return _fseeki64(fp, offset, SEEK_SET) == 0;
+#else
+        return fseeko(fp, offset, SEEK_SET) == 0;
+#endif
+    }
+    FILE *fp;
+    int64_t fileSize;
+};
+
+/*WAV和W64共用的fmt块*/
+bool parseFmt(const uint8_t *p, uint64_t size, AudioReader::Info &info)
+{
+    if(size < 16)
+        return false;
+    uint16_t tag = le16(p);
+    info.channels = le16(p + 2);
+    info.sampleRate = le32(p + 4);
+    info.bitsPerSample = le16(p + 14);
+    if(tag == WavHeader::Extensible && size >= 40){
+        if(!WavHeader::isBaseSubFormat(p + 24))
+            return false;
+        info.layout = le32(p + 20);
+        tag = le16(p + 24);
+    }
+    /*位数不是8的倍数时按占用的字节数处理*/
+    int blockAlign = le16(p + 12);
+    if(info.channels > 0 && blockAlign % info.channels == 0)
+        info.bitsPerSample = blockAlign / info.channels * 8;
+    switch(tag){
+    case 1:
+        return true;
+    case 3:
+        info.isFloat = true;
+        return true;
+    case 6:
+        info.compression = SampleCodec::ALaw;
+        return true;
+    case 7:
+        info.compression = SampleCodec::MuLaw;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool probeWav(File &file, AudioReader::Info &info)
+{
+    uint8_t head[40];
+    bool hasFmt = false;
+    /*RF64的ds64块里是64位的data长度*/
+    int64_t ds64DataSize = -1;
+    int64_t pos = 12;
+    while(pos + 8 <= file.size() && file.read(pos, head, 8)){
+        uint64_t size = le32(head + 4);
+        if(memcmp(head, "ds64", 4) == 0 && size >= 16){
+            if(!file.read(pos + 8, head + 8, 16))
+                return false;
+            ds64DataSize = (int64_t)le64(head + 16);
+        }
+        else if(memcmp(head, "fmt ", 4) == 0){
+            uint8_t fmt[40] = {0};
+            uint64_t n = size < sizeof(fmt) ? size : sizeof(fmt);
+            if(!file.read(pos + 8, fmt, n) || !parseFmt(fmt, size, info))
+                return false;
+            hasFmt = true;
+        }
+        else if(memcmp(head, "data", 4) == 0){
+            info.dataOffset = pos + 8;
+            /*流式写入的文件长度可能是0或0xFFFFFFFF，以文件实际长度为准*/
+            info.dataSize = file.size() - info.dataOffset;
+            if(size == 0xFFFFFFFFULL && ds64DataSize > 0)
+                size = ds64DataSize;
+            if(size > 0 && (size < 0xFFFFFFFFULL || ds64DataSize > 0) && (int64_t)size < info.dataSize)
+                info.dataSize = size;
+            return hasFmt;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    return false;
+}
+
+bool probeW64(File &file, AudioReader::Info &info)
+{
+    uint8_t head[24];
+    bool hasFmt = false;
+    int64_t pos = 40;
+    while(pos + 24 <= file.size() && file.read(pos, head, 24)){
+        uint64_t size = le64(head + 16);
+        if(size < 24 || memcmp(head + 4, w64Suffix, 12) != 0)
+            return false;
+        if(memcmp(head, "fmt ", 4) == 0){
+            uint8_t fmt[40] = {0};
+            uint64_t n = size - 24 < sizeof(fmt) ? size - 24 : sizeof(fmt);
+            if(!file.read(pos + 24, fmt, n) || !parseFmt(fmt, size - 24, info))
+                return false;
+            hasFmt = true;
+        }
+        else if(memcmp(head, "data", 4) == 0){
+            info.dataOffset = pos + 24;
+            info.dataSize = file.size() - info.dataOffset;
+            if((int64_t)(size - 24) < info.dataSize)
+                info.dataSize = size - 24;
+            return hasFmt;
+        }
+        pos += (size + 7) & ~7ULL;
+    }
+    return false;
+}
+
+bool probeAiff(File &file, AudioReader::Info &info)
+{
+    bool aifc = info.container == AudioContainer::AIFC;
+    uint8_t head[8];
+    bool hasComm = false;
+    info.bigEndian = true;
+    info.signed8 = true;
+    int64_t pos = 12;
+    while(pos + 8 <= file.size() && file.read(pos, head, 8)){
+        uint64_t size = be32(head + 4);
+        if(memcmp(head, "COMM", 4) == 0){
+            uint8_t comm[22] = {0};
+            if(size < (aifc ? 22u : 18u) || !file.read(pos + 8, comm, aifc ? 22 : 18))
+                return false;
+            info.channels = be16(comm);
+            info.bitsPerSample = (be16(comm + 6) + 7) / 8 * 8;
+            info.sampleRate = (int)lrint(extended(comm + 8));
+            if(aifc){
+                char type[5] = {0};
+                memcpy(type, comm + 18, 4);
+                if(strcmp(type, "NONE") == 0 || strcmp(type, "twos") == 0)
+                    ;
+                else if(strcmp(type, "sowt") == 0)
+                    info.bigEndian = false;
+                else if(strcmp(type, "fl32") == 0 || strcmp(type, "FL32") == 0){
+                    info.isFloat = true;
+                    info.bitsPerSample = 32;
+                }
+                else if(strcmp(type, "fl64") == 0 || strcmp(type, "FL64") == 0){
+                    info.isFloat = true;
+                    info.bitsPerSample = 64;
+                }
+                else if(strcmp(type, "ulaw") == 0 || strcmp(type, "ULAW") == 0){
+                    info.compression = SampleCodec::MuLaw;
+                    info.bitsPerSample = 8;
+                }
+                else if(strcmp(type, "alaw") == 0 || strcmp(type, "ALAW") == 0){
+                    info.compression = SampleCodec::ALaw;
+                    info.bitsPerSample = 8;
+                }
+                else
+                    return false;
+            }
+            hasComm = true;
+        }
+        else if(memcmp(head, "SSND", 4) == 0){
+            uint8_t ssnd[8];
+            if(size < 8 || !file.read(pos + 8, ssnd, 8))
+                return false;
+            info.dataOffset = pos + 16 + be32(ssnd);
+            info.dataSize = file.size() - info.dataOffset;
+            int64_t declared = (int64_t)size - 8 - be32(ssnd);
+            if(declared >= 0 && declared < info.dataSize)
+                info.dataSize = declared;
+            return hasComm;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    return false;
+}
+
+bool probeCaf(File &file, AudioReader::Info &info)
+{
+    uint8_t head[12];
+    bool hasDesc = false;
+    info.signed8 = true;
+    int64_t pos = 8;
+    while(pos + 12 <= file.size() && file.read(pos, head, 12)){
+        int64_t size = (int64_t)be64(head + 4);
+        if(memcmp(head, "desc", 4) == 0){
+            uint8_t desc[32];
+            if(size < 32 || !file.read(pos + 12, desc, 32))
+                return false;
+            uint64_t bits = be64(desc);
+            double rate;
+            memcpy(&rate, &bits, sizeof(rate));
+            info.sampleRate = (int)lrint(rate);
+            uint32_t flags = be32(desc + 12);
+            uint32_t bytesPerPacket = be32(desc + 16);
+            info.channels = be32(desc + 24);
+            info.bitsPerSample = be32(desc + 28);
+            if(memcmp(desc + 8, "lpcm", 4) == 0){
+                info.isFloat = (flags & 1) != 0;
+                info.bigEndian = (flags & 2) == 0;
+                if(info.channels > 0 && bytesPerPacket % info.channels == 0)
+                    info.bitsPerSample = bytesPerPacket / info.channels * 8;
+            }
+            else if(memcmp(desc + 8, "ulaw", 4) == 0){
+                info.compression = SampleCodec::MuLaw;
+                info.bitsPerSample = 8;
+            }
+            else if(memcmp(desc + 8, "alaw", 4) == 0){
+                info.compression = SampleCodec::ALaw;
+                info.bitsPerSample = 8;
+            }
+            else
+                return false;
+            hasDesc = true;
+        }
+        else if(memcmp(head, "chan", 4) == 0){
+            uint8_t chan[8];
+            if(size >= 12 && file.read(pos + 12, chan, 8) && be32(chan) == 0x10000)
+                info.layout = be32(chan + 4);
+        }
+        else if(memcmp(head, "data", 4) == 0){
+            /*开头4个字节是编辑计数；长度为-1表示数据一直到文件结尾*/
+            info.dataOffset = pos + 12 + 4;
+            info.dataSize = file.size() - info.dataOffset;
+            if(size >= 4 && size - 4 < info.dataSize)
+                info.dataSize = size - 4;
+            return hasDesc;
+        }
+        if(size < 0)
+            return false;
+        pos += 12 + size;
+    }
+    return false;
+}
+
+uint64_t defaultLayout(int channels)
+{
+    uint64_t layout = av_get_default_channel_layout(channels);
+    if(layout != 0)
+        return layout;
+    /*没有标准布局时按顺序占用前N个位置，跳过LFE*/
+    for(int bit = 0, n = 0; n < channels && bit < 64; ++bit){
+        if((1ULL << bit) == AV_CH_LOW_FREQUENCY)
+            continue;
+        layout |= 1ULL << bit;
+        ++n;
+    }
+    return layout;
+}
+
+}
+
+bool AudioReader::Info::toSampleFormat(AVSampleFormat *format, SampleCodec::Coding *coding) const
+{
+    if(compression != SampleCodec::Native){
+        *format = AV_SAMPLE_FMT_S16;
+        *coding = compression;
+        return true;
+    }
+    switch(bitsPerSample){
+    case 8:
+        *format = AV_SAMPLE_FMT_U8;
+        *coding = signed8 ? SampleCodec::Signed8 : SampleCodec::Native;
+        return !isFloat;
+    case 16:
+        *format = AV_SAMPLE_FMT_S16;
+        *coding = bigEndian ? SampleCodec::BigEndian : SampleCodec::Native;
+        return !isFloat;
+    case 24:
+        *format = AV_SAMPLE_FMT_S32;
+        *coding = bigEndian ? SampleCodec::Packed24BE : SampleCodec::Packed24;
+        return !isFloat;
+    case 32:
+        *format = isFloat ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_S32;
+        *coding = bigEndian ? SampleCodec::BigEndian : SampleCodec::Native;
+        return true;
+    case 64:
+        *format = AV_SAMPLE_FMT_DBL;
+        *coding = bigEndian ? SampleCodec::BigEndian : SampleCodec::Native;
+        return isFloat;
+    default:
+        return false;
+    }
+}
+
+bool AudioReader::probe(const std::string &path, Info &info)
+{
+    info.container = AudioContainer::Raw;
+    info.channels = 0;
+    info.layout = 0;
+    info.sampleRate = 0;
+    info.bitsPerSample = 0;
+    info.isFloat = false;
+    info.bigEndian = false;
+    info.signed8 = false;
+    info.compression = SampleCodec::Native;
+    info.dataOffset = 0;
+    info.dataSize = 0;
+
+    File file(path);
+    /*裸PCM整个文件都是音频数据*/
+    info.dataSize = file.size();
+    uint8_t magic[16];
+    if(!file.isOpen() || !file.read(0, magic, sizeof(magic)))
+        return false;
+    bool ok;
+    if(memcmp(magic, "RIFF", 4) == 0 && memcmp(magic + 8, "WAVE", 4) == 0){
+        info.container = AudioContainer::WAV;
+        ok = probeWav(file, info);
+    }
+    else if(memcmp(magic, "RF64", 4) == 0 && memcmp(magic + 8, "WAVE", 4) == 0){
+        info.container = AudioContainer::RF64;
+        ok = probeWav(file, info);
+    }
+    else if(memcmp(magic, w64RiffGuid, 16) == 0){
+        info.container = AudioContainer::W64;
+        ok = probeW64(file, info);
+    }
+    else if(memcmp(magic, "FORM", 4) == 0 && memcmp(magic + 8, "AIFF", 4) == 0){
+        info.container = AudioContainer::AIFF;
+        ok = probeAiff(file, info);
+    }
+    else if(memcmp(magic, "FORM", 4) == 0 && memcmp(magic + 8, "AIFC", 4) == 0){
+        info.container = AudioContainer::AIFC;
+        ok = probeAiff(file, info);
+    }
+    else if(memcmp(magic, "caff", 4) == 0){
+        info.container = AudioContainer::CAF;
+        ok = probeCaf(file, info);
+    }
+    else
+        return false;
+
+    if(!ok || info.channels <= 0 || info.sampleRate <= 0 || info.dataSize < 0)
+        return false;
+    if(info.layout == 0 || av_get_channel_layout_nb_channels(info.layout) != info.channels)
+        info.layout = defaultLayout(info.channels);
+    AVSampleFormat format;
+    SampleCodec::Coding coding;
+    return info.toSampleFormat(&format, &coding);
+}
@@ -0,0 +1,49 @@
+#ifndef AUDIOREADER_H
+#define AUDIOREADER_H
+
+#include <stdint.h>
+#include <string>
+#include "audiowriter.h"
+#include "samplecodec.h"
+extern "C"{
+#include "libavutil/samplefmt.h"
+}
+
+/**
+ * @brief 解析WAV、AIFF/AIFC、CAF、W64的文件头，找到格式和音频数据的位置
+ * 只读文件头和块目录，数据本身由调用者按dataOffset/dataSize读取
+ */
+namespace AudioReader {
+
+struct Info{
+    AudioContainer::Type container;
+    int channels;
+    /*文件中没有声道位置或者和声道数不符时为默认布局*/
+    uint64_t layout;
+    int sampleRate;
+    /*每个样本在文件中占的位数，G.711为8*/
+    int bitsPerSample;
+    bool isFloat;
+    bool bigEndian;
+    /*8位数据是否有符号（AIFF、CAF为有符号，WAV为无符号）*/
+    bool signed8;
+    /*ALaw、MuLaw或者Native*/
+    SampleCodec::Coding compression;
+    int64_t dataOffset;
+    int64_t dataSize;
+
+    /**
+     * @brief 对应的内部格式和解码方式，不支持的组合返回false
+     */
+    bool toSampleFormat(AVSampleFormat *format, SampleCodec::Coding *coding) const;
+};
+
+/**
+ * @brief 不是已知封装时container为Raw并返回false；
+ * 是已知封装但头不完整或者格式不支持时container不为Raw，同样返回false
+ */
+bool probe(const std::string &path, Info &info);
+
+}
+
+#endif // AUDIOREADER_H
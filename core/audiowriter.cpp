@@ -0,0 +1,460 @@
+#include "audiowriter.h"
+#include "samplecodec.h"
+#include <string.h>
+#include <math.h>
+
+namespace {
+
+void putBE16(std::vector<uint8_t> &out, uint16_t v)
+{
+    out.push_back(v >> 8);
+    out.push_back(v & 0xFF);
+}
+
+void putBE32(std::vector<uint8_t> &out, uint32_t v)
+{
+    for(int i = 3; i >= 0; --i)
+        out.push_back((v >> (8 * i)) & 0xFF);
+}
+
+void putBE64(std::vector<uint8_t> &out, uint64_t v)
+{
+    for(int i = 7; i >= 0; --i)
+        out.push_back((v >> (8 * i)) & 0xFF);
+}
+
+void putLE64(std::vector<uint8_t> &out, uint64_t v)
+{
+    for(int i = 0; i < 8; ++i)
+        out.push_back((v >> (8 * i)) & 0xFF);
+}
+
+void putTag(std::vector<uint8_t> &out, const char *tag)
+{
+    out.insert(out.end(), tag, tag + 4);
+}
+
+/*AIFF的采样率是80位扩展精度浮点数*/
+void putExtended(std::vector<uint8_t> &out, double v)
+{
+    uint16_t exponent = 0;
+    uint64_t mantissa = 0;
+    if(v > 0){
+        int e;
+        double m = frexp(v, &e);
+        exponent = (uint16_t)(e - 1 + 16383);
+        mantissa = (uint64_t)ldexp(m, 64);
+    }
+    putBE16(out, exponent);
+    putBE64(out, mantissa);
+}
+
+/*AIFC的压缩名称是Pascal字符串，连同长度字节补齐到偶数*/
+void putPString(std::vector<uint8_t> &out, const char *text)
+{
+    size_t n = strlen(text);
+    out.push_back((uint8_t)n);
+    out.insert(out.end(), text, text + n);
+    if((n + 1) & 1)
+        out.push_back(0);
+}
+
+uint32_t clamp32(uint64_t v)
+{
+    return v > 0xFFFFFFFFULL ? 0xFFFFFFFFU : (uint32_t)v;
+}
+
+/*大端封装：多字节样本交换字节，8位转为有符号*/
+bool toBigEndian(const WavFormat &format, const uint8_t *src, int64_t bytes, uint8_t *dst)
+{
+    int size = format.bitsPerSample / 8;
+    if(size == 1)
+        SampleCodec::flipSign8(src, bytes, dst);
+    else
+        SampleCodec::swapBytes(src, bytes / size, size, dst);
+    return true;
+}
+
+class RawWriter : public AudioWriter
+{
+protected:
+    std::vector<uint8_t> header(uint64_t) const override
+    {
+        return std::vector<uint8_t>();
+    }
+    int alignment() const override
+    {
+        return 1;
+    }
+};
+
+class WavWriter : public AudioWriter
+{
+protected:
+    std::vector<uint8_t> header(uint64_t dataSize) const override
+    {
+        return WavHeader::build(format, clamp32(dataSize));
+    }
+};
+
+class Rf64Writer : public AudioWriter
+{
+protected:
+    std::vector<uint8_t> header(uint64_t dataSize) const override
+    {
+        return WavHeader::buildRf64(format, dataSize);
+    }
+};
+
+/**
+ * AIFF只能存整数，浮点自动写为AIFC，AIFC的整数使用NONE（大端）
+ */
+class AiffWriter : public AudioWriter
+{
+public:
+    explicit AiffWriter(bool aifc) : forceAifc(aifc) {}
+protected:
+    std::vector<uint8_t> header(uint64_t dataSize) const override
+    {
+        bool aifc = forceAifc || format.isFloat;
+        int blockAlign = format.blockAlign();
+        std::vector<uint8_t> out;
+        putTag(out, "FORM");
+        putBE32(out, 0);
+        putTag(out, aifc ? "AIFC" : "AIFF");
+        if(aifc){
+            putTag(out, "FVER");
+            putBE32(out, 4);
+            /*AIFC规范版本1的时间戳*/
+            putBE32(out, 0xA2805140);
+        }
+
+        std::vector<uint8_t> comm;
+        putBE16(comm, format.channels);
+        putBE32(comm, clamp32(blockAlign > 0 ? dataSize / blockAlign : 0));
+        putBE16(comm, format.bitsPerSample);
+        putExtended(comm, format.sampleRate);
+        if(aifc){
+            if(!format.isFloat){
+                putTag(comm, "NONE");
+                putPString(comm, "not compressed");
+            }
+            else if(format.bitsPerSample == 64){
+                putTag(comm, "fl64");
+                putPString(comm, "64-bit floating point");
+            }
+            else{
+                putTag(comm, "fl32");
+                putPString(comm, "32-bit floating point");
+            }
+        }
+        putTag(out, "COMM");
+        putBE32(out, comm.size());
+        out.insert(out.end(), comm.begin(), comm.end());
+
+        /*SSND块开头是offset和blockSize，都写0*/
+        putTag(out, "SSND");
+        putBE32(out, clamp32(dataSize + 8));
+        putBE32(out, 0);
+        putBE32(out, 0);
+
+        uint32_t size = clamp32(out.size() - 8 + dataSize + (dataSize & 1));
+        out[4] = size >> 24;
+        out[5] = (size >> 16) & 0xFF;
+        out[6] = (size >> 8) & 0xFF;
+        out[7] = size & 0xFF;
+        return out;
+    }
+    bool convert(const uint8_t *src, int64_t bytes, uint8_t *dst) const override
+    {
+        return toBigEndian(format, src, bytes, dst);
+    }
+private:
+    bool forceAifc;
+};
+
+/**
+ * CAF的数据可以声明为小端，只有8位需要转为有符号；
+ * 块长度是64位的，不受4GB限制
+ */
+class CafWriter : public AudioWriter
+{
+protected:
+    std::vector<uint8_t> header(uint64_t dataSize) const override
+    {
+        std::vector<uint8_t> out;
+        putTag(out, "caff");
+        putBE16(out, 1);
+        putBE16(out, 0);
+
+        putTag(out, "desc");
+        putBE64(out, 32);
+        uint64_t rate;
+        double r = format.sampleRate;
+        memcpy(&rate, &r, sizeof(rate));
+        putBE64(out, rate);
+        putTag(out, "lpcm");
+        /*kCAFLinearPCMFormatFlagIsFloat = 1, IsLittleEndian = 2*/
+        putBE32(out, (format.isFloat ? 1 : 0) | (format.bitsPerSample > 8 ? 2 : 0));
+        putBE32(out, format.blockAlign());
+        putBE32(out, 1);
+        putBE32(out, format.channels);
+        putBE32(out, format.validBits);
+
+        /*声道位置按位图描述，位定义和WAV一致*/
+        if(format.channelMask() != 0){
+            putTag(out, "chan");
+            putBE64(out, 12);
+            putBE32(out, 0x10000);
+            putBE32(out, format.channelMask());
+            putBE32(out, 0);
+        }
+
+        /*data块开头4个字节为编辑计数*/
+        putTag(out, "data");
+        putBE64(out, dataSize + 4);
+        putBE32(out, 0);
+        return out;
+    }
+    bool convert(const uint8_t *src, int64_t bytes, uint8_t *dst) const override
+    {
+        if(format.bitsPerSample != 8)
+            return false;
+        SampleCodec::flipSign8(src, bytes, dst);
+        return true;
+    }
+    int alignment() const override
+    {
+        return 1;
+    }
+};
+
+/**
+ * Sony Wave64：块标识为16字节GUID，长度为64位且包含块头的24字节，块按8字节对齐
+ */
+class W64Writer : public AudioWriter
+{
+protected:
+    std::vector<uint8_t> header(uint64_t dataSize) const override
+    {
+        static const uint8_t riffGuid[16] = {'r', 'i', 'f', 'f', 0x2E, 0x91, 0xCF, 0x11,
+                                             0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00};
+        static const uint8_t waveGuid[12] = {0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1,
+                                             0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A};
+        auto chunk = [](std::vector<uint8_t> &out, const char *tag, uint64_t size){
+            putTag(out, tag);
+            out.insert(out.end(), waveGuid, waveGuid + 12);
+            putLE64(out, size + 24);
+        };
+        auto align = [](std::vector<uint8_t> &out){
+            while(out.size() % 8)
+                out.push_back(0);
+        };
+
+        std::vector<uint8_t> out;
+        out.insert(out.end(), riffGuid, riffGuid + 16);
+        putLE64(out, 0);
+        putTag(out, "wave");
+        out.insert(out.end(), waveGuid, waveGuid + 12);
+
+        auto fmt = WavHeader::fmtChunk(format);
+        chunk(out, "fmt ", fmt.size());
+        out.insert(out.end(), fmt.begin(), fmt.end());
+        align(out);
+
+        if(WavHeader::formatTag(format) != WavHeader::PCM){
+            int blockAlign = format.blockAlign();
+            chunk(out, "fact", 4);
+            uint32_t frames = clamp32(blockAlign > 0 ? dataSize / blockAlign : 0);
+            for(int i = 0; i < 4; ++i)
+                out.push_back((frames >> (8 * i)) & 0xFF);
+            align(out);
+        }
+
+        chunk(out, "data", dataSize);
+        uint64_t total = out.size() + dataSize + (8 - dataSize % 8) % 8;
+        for(int i = 0; i < 8; ++i)
+            out[16 + i] = (total >> (8 * i)) & 0xFF;
+        return out;
+    }
+    int alignment() const override
+    {
+        return 8;
+    }
+};
+
+}
+
+const char *AudioContainer::extension(Type type)
+{
+    switch(type){
+    case WAV:
+        return "wav";
+    case AIFF:
+        return "aiff";
+    case AIFC:
+        return "aifc";
+    case CAF:
+        return "caf";
+    case W64:
+        return "w64";
+    case RF64:
+        return "wav";
+    case Raw:
+    default:
+        return "pcm";
+    }
+}
+
+std::unique_ptr<AudioWriter> AudioWriter::create(AudioContainer::Type type)
+{
+    switch(type){
+    case AudioContainer::WAV:
+        return std::unique_ptr<AudioWriter>(new WavWriter);
+    case AudioContainer::AIFF:
+        return std::unique_ptr<AudioWriter>(new AiffWriter(false));
+    case AudioContainer::AIFC:
+        return std::unique_ptr<AudioWriter>(new AiffWriter(true));
+    case AudioContainer::CAF:
+        return std::unique_ptr<AudioWriter>(new CafWriter);
+    case AudioContainer::W64:
+        return std::unique_ptr<AudioWriter>(new W64Writer);
+    case AudioContainer::RF64:
+        return std::unique_ptr<AudioWriter>(new Rf64Writer);
+    case AudioContainer::Raw:
+    default:
+        return std::unique_ptr<AudioWriter>(new RawWriter);
+    }
+}
+
+AudioWriter::AudioWriter() :
+    fp(nullptr),
+    headerSize(0),
+    written(0),
+    failed(false),
+    removeOnError(true)
+{
+}
+
+AudioWriter::~AudioWriter()
+{
+    if(fp != nullptr)
+        close();
+}
+
+bool AudioWriter::open(const std::string &path, const WavFormat &format)
+{
+    if(fp != nullptr)
+        close();
+    this->format = format;
+    filePath = path;
+    written = 0;
+    failed = false;
+    fp = fopen(path.c_str(), "wb");
+    if(fp == nullptr)
+        return false;
+    auto head = header(0);
+    headerSize = head.size();
+    if(!head.empty() && fwrite(head.data(), 1, head.size(), fp) != head.size())
+        failed = true;
+    return !failed;
+}
+
+bool AudioWriter::write(const uint8_t *data, int64_t bytes)
+{
+    if(fp == nullptr || failed)
+        return false;
+    if(!_writeData(data, bytes)){
+        failed = true;
+        return false;
+    }
+    written += bytes;
+    return true;
+}
+
+bool AudioWriter::writeAt(uint64_t offset, const uint8_t *data, int64_t bytes)
+{
+    if(fp == nullptr || failed)
+        return false;
+    /*写完回到数据末尾，后面的write和close不受影响*/
+    if(!_seek(headerSize + offset) || !_writeData(data, bytes)){
+        failed = true;
+        return false;
+    }
+    if(offset + bytes > written)
+        written = offset + bytes;
+    failed = !_seek(headerSize + written);
+    return !failed;
+}
+
+bool AudioWriter::_writeData(const uint8_t *data, int64_t bytes)
+{
+    /*分块转换，临时缓冲不随数据长度增长；块大小是3、4、8字节样本的公倍数*/
+    const int64_t chunk = 3 * 8 * 8192;
+    for(int64_t pos = 0; pos < bytes; pos += chunk){
+        int64_t n = bytes - pos < chunk ? bytes - pos : chunk;
+        const uint8_t *p = data + pos;
+        if(scratch.size() < (size_t)n)
+            scratch.resize(n);
+        if(convert(p, n, scratch.data()))
+            p = scratch.data();
+        if(fwrite(p, 1, n, fp) != (size_t)n)
+            return false;
+    }
+    return true;
+}
+
+bool AudioWriter::_seek(uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(fp, (int64_t)offset, SEEK_SET) == 0;
+#else
+    return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool AudioWriter::sync()
+{
+    if(fp == nullptr || failed)
+        return false;
+    /*文件头长度固定，重写后回到结尾继续追加*/
+    auto head = header(written);
+    if(!head.empty()){
+        failed = fseek(fp, 0, SEEK_SET) != 0
+                || fwrite(head.data(), 1, head.size(), fp) != head.size()
+                || fseek(fp, 0, SEEK_END) != 0;
+    }
+    failed = fflush(fp) != 0 || failed;
+    return !failed;
+}
+
+bool AudioWriter::close()
+{
+    if(fp == nullptr)
+        return false;
+    int align = alignment();
+    if(!failed && align > 1 && written % align){
+        std::vector<uint8_t> pad(align - written % align, 0);
+        failed = fwrite(pad.data(), 1, pad.size(), fp) != pad.size();
+    }
+    auto head = header(written);
+    if(!failed && !head.empty()){
+        failed = fseek(fp, 0, SEEK_SET) != 0
+                || fwrite(head.data(), 1, head.size(), fp) != head.size();
+    }
+    failed = fclose(fp) != 0 || failed;
+    fp = nullptr;
+    if(failed && removeOnError)
+        remove(filePath.c_str());
+    return !failed;
+}
+
+bool AudioWriter::convert(const uint8_t *, int64_t, uint8_t *) const
+{
+    return false;
+}
+
+int AudioWriter::alignment() const
+{
+    return 2;
+}
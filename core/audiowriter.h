@@ -0,0 +1,94 @@
+#ifndef AUDIOWRITER_H
+#define AUDIOWRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "wavheader.h"
+
+namespace AudioContainer {
+
+enum Type{
+    Raw = 0,
+    WAV,
+    AIFF,
+    AIFC,
+    CAF,
+    W64,
+    RF64        /*超过4GB时自动转为RF64的WAV，扩展名同WAV*/
+};
+
+const char *extension(Type type);
+
+}
+
+/**
+ * @brief 流式写音频文件
+ * 打开时先按数据长度0写文件头，数据边写边转换为封装要求的存放方式，
+ * 关闭时补齐对齐字节，再回到开头用实际长度重写文件头，所以各种封装的文件头长度都不随数据长度变化。
+ * 写入的数据和WAV的data块相同：小端交错，8位为无符号，24位为3字节
+ */
+class AudioWriter
+{
+public:
+    static std::unique_ptr<AudioWriter> create(AudioContainer::Type type);
+    virtual ~AudioWriter();
+
+    bool open(const std::string &path, const WavFormat &format);
+    bool write(const uint8_t *data, int64_t bytes);
+    /**
+     * @brief 写在数据的offset字节处，分段转换时各段完成的先后不定；之后write仍然追加在已写入的数据末尾
+     */
+    bool writeAt(uint64_t offset, const uint8_t *data, int64_t bytes);
+    /**
+     * @brief 按目前写入的长度重写文件头并刷到磁盘，录音时定期调用，程序中断后文件仍然可以播放
+     */
+    bool sync();
+    /**
+     * @brief 失败时删除写了一半的文件，除非用setRemoveOnError关闭
+     */
+    bool close();
+    /**
+     * @brief 录音时即使出错也保留已经写入的部分
+     */
+    void setRemoveOnError(bool enable);
+    bool isOpen() const;
+    uint64_t dataBytes() const;
+
+protected:
+    AudioWriter();
+    /**
+     * @brief 按目前的数据长度生成文件头，长度必须和dataSize无关
+     */
+    virtual std::vector<uint8_t> header(uint64_t dataSize) const = 0;
+    /**
+     * @brief 转为文件中的存放方式，不需要转换时返回false，直接写原数据
+     */
+    virtual bool convert(const uint8_t *src, int64_t bytes, uint8_t *dst) const;
+    /**
+     * @brief 数据之后需要对齐到的字节数
+     */
+    virtual int alignment() const;
+
+protected:
+    WavFormat format;
+
+private:
+    bool _writeData(const uint8_t *data, int64_t bytes);
+    bool _seek(uint64_t offset);
+private:
+    FILE *fp;
+    std::string filePath;
+    uint64_t headerSize;
+    uint64_t written;
+    bool failed;
+    bool removeOnError;
+    std::vector<uint8_t> scratch;
+};
+
+inline bool AudioWriter::isOpen() const                                         {   return fp != nullptr;}
+inline uint64_t AudioWriter::dataBytes() const                                  {   return written;}
+inline void AudioWriter::setRemoveOnError(bool enable)                          {   removeOnError = enable;}
+#endif // AUDIOWRITER_H
@@ -0,0 +1,370 @@
+#include "channelmapper.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CHANNELMAPPER_SSE2
+#endif
+
+namespace {
+
+bool isCopy(const ChannelMapper::Channel &terms)
+{
+    return terms.size() == 1 && terms[0].gain == 1.0;
+}
+
+/*
+ * 常见布局的SSE2版本，和下面的标量循环逐位相同：
+ * 立体声取出一个声道、单声道复制成立体声、立体声按增益合成单声道（S16和FLT）。
+ * 返回已处理的帧数，其余的交给标量循环，不支持的样本类型返回0
+ */
+template<typename T>
+int extractStereo(const T *, int, T *, int)
+{
+    return 0;
+}
+
+template<typename T>
+int duplicateMono(const T *, T *, int)
+{
+    return 0;
+}
+
+template<typename T>
+int mixStereo(const T *, double, double, T *, int)
+{
+    return 0;
+}
+
+#ifdef CHANNELMAPPER_SSE2
+int extractStereo(const uint16_t *in, int channel, uint16_t *out, int frames)
+{
+    int i = 0;
+    for(; i + 8 <= frames; i += 8){
+        __m128i a = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(in + 2 * i + 8));
+        /*把要的那个声道符号扩展到32位，再饱和打包不会改变数值*/
+        if(channel == 0){
+            a = _mm_slli_epi32(a, 16);
+            b = _mm_slli_epi32(b, 16);
+        }
+        a = _mm_srai_epi32(a, 16);
+        b = _mm_srai_epi32(b, 16);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(a, b));
+    }
+    return i;
+}
+
+int extractStereo(const uint32_t *in, int channel, uint32_t *out, int frames)
+{
+    int i = 0;
+    for(; i + 4 <= frames; i += 4){
+        __m128 a = _mm_loadu_ps((const float *)(in + 2 * i));
+        __m128 b = _mm_loadu_ps((const float *)(in + 2 * i + 4));
+        __m128 v = channel == 0 ? _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))
+                                : _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps((float *)(out + i), v);
+    }
+    return i;
+}
+
+int duplicateMono(const uint16_t *in, uint16_t *out, int frames)
+{
+    int i = 0;
+    for(; i + 8 <= frames; i += 8){
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        _mm_storeu_si128((__m128i *)(out + 2 * i), _mm_unpacklo_epi16(v, v));
+        _mm_storeu_si128((__m128i *)(out + 2 * i + 8), _mm_unpackhi_epi16(v, v));
+    }
+    return i;
+}
+
+int duplicateMono(const uint32_t *in, uint32_t *out, int frames)
+{
+    int i = 0;
+    for(; i + 4 <= frames; i += 4){
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        _mm_storeu_si128((__m128i *)(out + 2 * i), _mm_unpacklo_epi32(v, v));
+        _mm_storeu_si128((__m128i *)(out + 2 * i + 4), _mm_unpackhi_epi32(v, v));
+    }
+    return i;
+}
+
+/*一帧[L, R]乘以[g0, g1]后相加，和标量一样从0开始累加，保证-0的结果相同*/
+inline __m128d mixPair(__m128d x0, __m128d x1, __m128d g)
+{
+    x0 = _mm_mul_pd(x0, g);
+    x1 = _mm_mul_pd(x1, g);
+    __m128d acc = _mm_add_pd(_mm_setzero_pd(), _mm_unpacklo_pd(x0, x1));
+    return _mm_add_pd(acc, _mm_unpackhi_pd(x0, x1));
+}
+
+int mixStereo(const int16_t *in, double g0, double g1, int16_t *out, int frames)
+{
+    const __m128d g = _mm_set_pd(g1, g0);
+    const __m128d lo = _mm_set1_pd(-32768.0), hi = _mm_set1_pd(32767.0);
+    int i = 0;
+    for(; i + 4 <= frames; i += 4){
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+        __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        __m128d m0 = mixPair(_mm_cvtepi32_pd(a), _mm_cvtepi32_pd(_mm_srli_si128(a, 8)), g);
+        __m128d m1 = mixPair(_mm_cvtepi32_pd(b), _mm_cvtepi32_pd(_mm_srli_si128(b, 8)), g);
+        /*先限幅再转换，舍入和lrint一样按当前的舍入模式*/
+        m0 = _mm_min_pd(_mm_max_pd(m0, lo), hi);
+        m1 = _mm_min_pd(_mm_max_pd(m1, lo), hi);
+        __m128i r = _mm_unpacklo_epi64(_mm_cvtpd_epi32(m0), _mm_cvtpd_epi32(m1));
+        _mm_storel_epi64((__m128i *)(out + i), _mm_packs_epi32(r, r));
+    }
+    return i;
+}
+
+int mixStereo(const float *in, double g0, double g1, float *out, int frames)
+{
+    const __m128d g = _mm_set_pd(g1, g0);
+    int i = 0;
+    for(; i + 4 <= frames; i += 4){
+        __m128 a = _mm_loadu_ps(in + 2 * i);
+        __m128 b = _mm_loadu_ps(in + 2 * i + 4);
+        __m128d m0 = mixPair(_mm_cvtps_pd(a), _mm_cvtps_pd(_mm_movehl_ps(a, a)), g);
+        __m128d m1 = mixPair(_mm_cvtps_pd(b), _mm_cvtps_pd(_mm_movehl_ps(b, b)), g);
+        _mm_storeu_ps(out + i, _mm_movelh_ps(_mm_cvtpd_ps(m0), _mm_cvtpd_ps(m1)));
+    }
+    return i;
+}
+#endif
+
+/*只选一个声道且增益为1时按字节搬运，不做任何转换*/
+template<typename T>
+void copyChannel(const uint8_t *src, int inChannels, int channel,
+                 uint8_t *dst, int outChannels, int index, int frames)
+{
+    const T *in = reinterpret_cast<const T *>(src) + channel;
+    T *out = reinterpret_cast<T *>(dst) + index;
+    if(inChannels == 1 && outChannels == 1){
+        memcpy(out, in, frames * sizeof(T));
+        return;
+    }
+    int i = 0;
+    if(inChannels == 2 && outChannels == 1)
+        i = extractStereo(in - channel, channel, out, frames);
+    for(; i < frames; ++i)
+        out[(int64_t)i * outChannels] = in[(int64_t)i * inChannels];
+}
+
+template<typename T>
+void duplicateChannel(const uint8_t *src, uint8_t *dst, int frames)
+{
+    const T *in = reinterpret_cast<const T *>(src);
+    T *out = reinterpret_cast<T *>(dst);
+    for(int i = duplicateMono(in, out, frames); i < frames; ++i)
+        out[2 * i] = out[2 * i + 1] = in[i];
+}
+
+template<typename T, typename Acc>
+void mixChannel(const uint8_t *src, int inChannels, const ChannelMapper::Channel &terms,
+                uint8_t *dst, int outChannels, int index, int frames, Acc *acc, Acc bias)
+{
+    const T *in = reinterpret_cast<const T *>(src);
+    T *out = reinterpret_cast<T *>(dst) + index;
+    int done = 0;
+    if(inChannels == 2 && outChannels == 1 && terms.size() == 2 && terms[0].channel != terms[1].channel){
+        /*两项的和与顺序无关*/
+        double g0 = terms[0].channel == 0 ? terms[0].gain : terms[1].gain;
+        double g1 = terms[0].channel == 0 ? terms[1].gain : terms[0].gain;
+        done = mixStereo(in, g0, g1, out, frames);
+        in += 2 * done;
+        out += done;
+        frames -= done;
+    }
+    std::fill(acc, acc + frames, Acc(0));
+    for(const auto &term : terms){
+        const T *p = in + term.channel;
+        Acc g = (Acc)term.gain;
+        for(int i = 0; i < frames; ++i)
+            acc[i] += g * ((Acc)p[(int64_t)i * inChannels] - bias);
+    }
+    if(std::numeric_limits<T>::is_integer){
+        const Acc lo = (Acc)std::numeric_limits<T>::min();
+        const Acc hi = (Acc)std::numeric_limits<T>::max();
+        for(int i = 0; i < frames; ++i){
+            Acc v = acc[i] + bias;
+            v = v < lo ? lo : (v > hi ? hi : v);
+            out[(int64_t)i * outChannels] = (T)lrint(v);
+        }
+    }
+    else{
+        for(int i = 0; i < frames; ++i)
+            out[(int64_t)i * outChannels] = (T)acc[i];
+    }
+}
+
+}
+
+ChannelMapper::ChannelMapper() :
+    inChannels(0),
+    sampleFormat(AV_SAMPLE_FMT_NONE)
+{
+}
+
+bool ChannelMapper::setup(int channels, AVSampleFormat format, const std::vector<Output> &outputs)
+{
+    maps.clear();
+    format = av_get_packed_sample_fmt(format);
+    if(channels <= 0 || format == AV_SAMPLE_FMT_NONE || format == AV_SAMPLE_FMT_S64)
+        return false;
+    for(const auto &output : outputs){
+        if(output.empty())
+            return false;
+        for(const auto &channel : output){
+            if(channel.empty())
+                return false;
+            for(const auto &term : channel){
+                if(term.channel < 0 || term.channel >= channels)
+                    return false;
+            }
+        }
+    }
+    inChannels = channels;
+    sampleFormat = format;
+    maps = outputs;
+    return !maps.empty();
+}
+
+bool ChannelMapper::isSelection() const
+{
+    for(const auto &output : maps){
+        for(const auto &channel : output){
+            if(!isCopy(channel))
+                return false;
+        }
+    }
+    return true;
+}
+
+void ChannelMapper::process(const uint8_t *src, int frames, uint8_t * const *dst)
+{
+    if(frames <= 0)
+        return;
+    accumulator.resize(frames);
+    for(int k = 0; k < outputCount(); ++k){
+        const Output &output = maps[k];
+        int oc = (int)output.size();
+        /*单声道复制成立体声时两个声道一起写*/
+        if(inChannels == 1 && oc == 2 && isCopy(output[0]) && isCopy(output[1])){
+            switch(av_get_bytes_per_sample(sampleFormat)){
+            case 1:
+                duplicateChannel<uint8_t>(src, dst[k], frames);
+                continue;
+            case 2:
+                duplicateChannel<uint16_t>(src, dst[k], frames);
+                continue;
+            case 4:
+                duplicateChannel<uint32_t>(src, dst[k], frames);
+                continue;
+            case 8:
+                duplicateChannel<uint64_t>(src, dst[k], frames);
+                continue;
+            }
+        }
+        for(int j = 0; j < oc; ++j){
+            const Channel &terms = output[j];
+            if(isCopy(terms)){
+                int ch = terms[0].channel;
+                switch(av_get_bytes_per_sample(sampleFormat)){
+                case 1:
+                    copyChannel<uint8_t>(src, inChannels, ch, dst[k], oc, j, frames);
+                    break;
+                case 2:
+                    copyChannel<uint16_t>(src, inChannels, ch, dst[k], oc, j, frames);
+                    break;
+                case 4:
+                    copyChannel<uint32_t>(src, inChannels, ch, dst[k], oc, j, frames);
+                    break;
+                case 8:
+                    copyChannel<uint64_t>(src, inChannels, ch, dst[k], oc, j, frames);
+                    break;
+                }
+                continue;
+            }
+            double *acc = accumulator.data();
+            switch(sampleFormat){
+            case AV_SAMPLE_FMT_U8:
+                mixChannel<uint8_t, double>(src, inChannels, terms, dst[k], oc, j, frames, acc, 128.0);
+                break;
+            case AV_SAMPLE_FMT_S16:
+                mixChannel<int16_t, double>(src, inChannels, terms, dst[k], oc, j, frames, acc, 0.0);
+                break;
+            case AV_SAMPLE_FMT_S32:
+                mixChannel<int32_t, double>(src, inChannels, terms, dst[k], oc, j, frames, acc, 0.0);
+                break;
+            case AV_SAMPLE_FMT_FLT:
+                mixChannel<float, double>(src, inChannels, terms, dst[k], oc, j, frames, acc, 0.0);
+                break;
+            case AV_SAMPLE_FMT_DBL:
+                mixChannel<double, double>(src, inChannels, terms, dst[k], oc, j, frames, acc, 0.0);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+bool ChannelMapper::parse(const std::string &text, std::vector<Output> &outputs)
+{
+    outputs.clear();
+    std::stringstream files(text);
+    std::string file;
+    while(std::getline(files, file, ';')){
+        Output output;
+        std::stringstream channels(file);
+        std::string channel;
+        while(std::getline(channels, channel, ',')){
+            Channel terms;
+            std::stringstream items(channel);
+            std::string item;
+            while(std::getline(items, item, '+')){
+                Term term;
+                term.gain = 1.0;
+                auto star = item.find('*');
+                char *end;
+                if(star != std::string::npos){
+                    term.gain = strtod(item.c_str(), &end);
+                    if(end == item.c_str())
+                        return false;
+                    item = item.substr(star + 1);
+                }
+                term.channel = (int)strtol(item.c_str(), &end, 10);
+                while(*end == ' ')
+                    ++end;
+                if(end == item.c_str() || *end != '\0')
+                    return false;
+                terms.push_back(term);
+            }
+            if(terms.empty())
+                return false;
+            output.push_back(terms);
+        }
+        if(output.empty())
+            return false;
+        outputs.push_back(output);
+    }
+    return !outputs.empty();
+}
+
+std::vector<double> ChannelMapper::toMatrix(const Output &output, int inChannels)
+{
+    std::vector<double> matrix(output.size() * inChannels, 0.0);
+    for(size_t j = 0; j < output.size(); ++j){
+        for(const auto &term : output[j]){
+            if(term.channel >= 0 && term.channel < inChannels)
+                matrix[j * inChannels + term.channel] += term.gain;
+        }
+    }
+    return matrix;
+}
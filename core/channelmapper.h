@@ -0,0 +1,62 @@
+#ifndef CHANNELMAPPER_H
+#define CHANNELMAPPER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+extern "C"{
+#include "libavutil/samplefmt.h"
+}
+
+/**
+ * @brief 声道映射（选择、重排、按增益求和）
+ * 采样率和格式不变时不经过SwrContext，直接在原始格式上处理交错数据；
+ * 可以有多个输出，一次读取同时得到多个文件（比如把8声道拆成若干单声道）
+ */
+class ChannelMapper
+{
+public:
+    struct Term{
+        int channel;
+        double gain;
+    };
+    /*输出的一个声道由若干输入声道加权求和*/
+    typedef std::vector<Term> Channel;
+    /*一个输出文件的全部声道*/
+    typedef std::vector<Channel> Output;
+
+public:
+    ChannelMapper();
+
+    bool setup(int channels, AVSampleFormat format, const std::vector<Output> &outputs);
+    int outputCount() const;
+    int outputChannels(int output) const;
+    /**
+     * @brief 所有输出声道都只是选择一个输入声道（增益为1），结果和源数据逐位相同
+     */
+    bool isSelection() const;
+    /**
+     * @brief dst[k]为第k个输出的交错数据，需要frames * outputChannels(k)个样本的空间
+     */
+    void process(const uint8_t *src, int frames, uint8_t * const *dst);
+
+    /**
+     * @brief 解析映射描述：';'分隔输出文件，','分隔声道，'+'分隔求和项，
+     * 项可以带增益如"0.5*1"，声道从0开始。例如"2;3"拆出两个单声道，"0.5*0+0.5*1"为立体声合成单声道
+     */
+    static bool parse(const std::string &text, std::vector<Output> &outputs);
+    /**
+     * @brief 单个输出转为swr_set_matrix使用的矩阵（输出声道 x 输入声道）
+     */
+    static std::vector<double> toMatrix(const Output &output, int inChannels);
+
+private:
+    int inChannels;
+    AVSampleFormat sampleFormat;
+    std::vector<Output> maps;
+    std::vector<double> accumulator;
+};
+
+inline int ChannelMapper::outputCount() const                                   {   return (int)maps.size();}
+inline int ChannelMapper::outputChannels(int output) const                      {   return (int)maps[output].size();}
+#endif // CHANNELMAPPER_H
@@ -0,0 +1,102 @@
+#include "checkpoint.h"
+#include <stdio.h>
+#include <inttypes.h>
+
+namespace {
+
+bool seek64(FILE *fp, int64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(fp, offset, SEEK_SET) == 0;
+#else
+    return fseeko(fp, offset, SEEK_SET) == 0;
+#endif
+}
+
+}
+
+Checkpoint::Checkpoint() :
+    committed(0)
+{
+}
+
+bool Checkpoint::load(const State &expect, State &state, std::vector<uint8_t> &data)
+{
+    committed = 0;
+    if(path.empty())
+        return false;
+    FILE *fp = fopen(path.c_str(), "r");
+    if(fp == nullptr)
+        return false;
+    bool ok = fscanf(fp, "source %" SCNd64 " %" SCNd64 "\nconfig %" SCNu64 "\ninput %" SCNd64
+                     "\noutput %" SCNd64 "\ndelay %" SCNd64,
+                     &state.sourceSize, &state.sourceTime, &state.configTag,
+                     &state.inputFrames, &state.outputBytes, &state.delay) == 6;
+    fclose(fp);
+    /*源文件或参数变了，旧的断点不能再用*/
+    if(!ok || state.sourceSize != expect.sourceSize || state.sourceTime != expect.sourceTime
+            || state.configTag != expect.configTag || state.inputFrames < 0 || state.outputBytes < 0)
+        return false;
+
+    fp = fopen(_dataPath().c_str(), "rb");
+    if(fp == nullptr)
+        return false;
+    data.resize(state.outputBytes);
+    ok = fread(data.data(), 1, data.size(), fp) == data.size();
+    fclose(fp);
+    if(!ok){
+        data.clear();
+        return false;
+    }
+    committed = state.outputBytes;
+    return true;
+}
+
+bool Checkpoint::commit(const State &state, const std::vector<uint8_t> &data)
+{
+    if(path.empty() || state.outputBytes < committed || state.outputBytes > (int64_t)data.size())
+        return false;
+    /*数据文件可能比状态文件记录的长（上次在两步之间中断），从已提交的位置覆盖写*/
+    auto dataPath = _dataPath();
+    FILE *fp = fopen(dataPath.c_str(), committed > 0 ? "r+b" : "wb");
+    if(fp == nullptr)
+        return false;
+    size_t n = state.outputBytes - committed;
+    bool ok = seek64(fp, committed)
+            && fwrite(data.data() + committed, 1, n, fp) == n;
+    ok = fclose(fp) == 0 && ok;
+    if(!ok)
+        return false;
+
+    /*先写临时文件再替换，中断时状态文件总是完整的*/
+    auto tmpPath = path + ".tmp";
+    fp = fopen(tmpPath.c_str(), "w");
+    if(fp == nullptr)
+        return false;
+    ok = fprintf(fp, "source %" PRId64 " %" PRId64 "\nconfig %" PRIu64 "\ninput %" PRId64
+                 "\noutput %" PRId64 "\ndelay %" PRId64 "\n",
+                 state.sourceSize, state.sourceTime, state.configTag,
+                 state.inputFrames, state.outputBytes, state.delay) > 0;
+    ok = fclose(fp) == 0 && ok;
+#ifdef _WIN32
+    ::remove(path.c_str());
+#endif
+    ok = ok && rename(tmpPath.c_str(), path.c_str()) == 0;
+    if(ok)
+        committed = state.outputBytes;
+    return ok;
+}
+
+void Checkpoint::remove()
+{
+    if(path.empty())
+        return;
+    ::remove(path.c_str());
+    ::remove(_dataPath().c_str());
+    committed = 0;
+}
+
+std::string Checkpoint::_dataPath() const
+{
+    return path + ".data";
+}
@@ -0,0 +1,58 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 长时间转换的断点
+ * 状态文件记录源文件、转换参数的标签、已提交的输入帧数和输出字节数，
+ * 已提交的输出数据追加写在path + ".data"里，中断后从最后一次提交的位置继续，不用从头开始
+ */
+class Checkpoint
+{
+public:
+    struct State{
+        /*用来确认源文件和参数没有变化*/
+        int64_t sourceSize;
+        int64_t sourceTime;
+        uint64_t configTag;
+        int64_t inputFrames;
+        int64_t outputBytes;
+        /*提交时重采样器里缓存的输入帧数，恢复时据此决定预读长度*/
+        int64_t delay;
+    };
+
+public:
+    Checkpoint();
+
+    /**
+     * @brief 为空时不读写断点
+     */
+    void setPath(const std::string &path);
+    bool isEnabled() const;
+
+    /**
+     * @brief 读出状态，和expect的源文件、参数一致时把已提交的输出读到data并返回true
+     */
+    bool load(const State &expect, State &state, std::vector<uint8_t> &data);
+    /**
+     * @brief 把data中上次提交之后到state.outputBytes的部分写入数据文件，再替换状态文件
+     */
+    bool commit(const State &state, const std::vector<uint8_t> &data);
+    /**
+     * @brief 转换完成后删除断点文件
+     */
+    void remove();
+
+private:
+    std::string _dataPath() const;
+private:
+    std::string path;
+    int64_t committed;
+};
+
+inline void Checkpoint::setPath(const std::string &path)                        {   this->path = path;}
+inline bool Checkpoint::isEnabled() const                                       {   return !path.empty();}
+#endif // CHECKPOINT_H
@@ -0,0 +1,317 @@
+#include "conversioncache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <chrono>
+#include <vector>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#endif
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+extern "C"{
+#include "libavutil/mem.h"
+#include "libavutil/murmur3.h"
+}
+
+namespace {
+
+/*缓存格式或转换结果的算法变化时改这个值，旧的缓存项自然不再命中*/
+const char *const cacheVersion = "pcm2wav-cache 1\n";
+/*计算哈希时每次读的字节数*/
+const size_t hashBlock = 1 << 20;
+
+struct FileStamp{
+    int64_t size;
+    int64_t mtime;
+};
+
+bool fileStamp(const std::string &path, FileStamp *stamp)
+{
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0)
+        return false;
+    stamp->size = st.st_size;
+#if defined(__linux__)
+    stamp->mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    stamp->mtime = (int64_t)st.st_mtime * 1000000000;
+#endif
+    return true;
+}
+
+bool copyFile(const std::string &from, const std::string &to)
+{
+    FILE *in = fopen(from.c_str(), "rb");
+    if(in == nullptr)
+        return false;
+    FILE *out = fopen(to.c_str(), "wb");
+    if(out == nullptr){
+        fclose(in);
+        return false;
+    }
+    std::vector<char> block(hashBlock);
+    bool ok = true;
+    size_t n;
+    while(ok && (n = fread(block.data(), 1, block.size(), in)) > 0)
+        ok = fwrite(block.data(), 1, n, out) == n;
+    ok = !ferror(in) && ok;
+    fclose(in);
+    ok = fclose(out) == 0 && ok;
+    return ok;
+}
+
+/*克隆只复制元数据，两个文件之后互不影响；不支持时硬链接，跨文件系统时只能复制*/
+bool cloneFile(const std::string &from, const std::string &to)
+{
+#ifdef __linux__
+    int in = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if(in >= 0){
+        int out = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        bool ok = out >= 0 && ioctl(out, FICLONE, in) == 0;
+        if(out >= 0)
+            close(out);
+        close(in);
+        if(ok)
+            return true;
+        unlink(to.c_str());
+    }
+#endif
+#ifndef _WIN32
+    if(link(from.c_str(), to.c_str()) == 0)
+        return true;
+#endif
+    return copyFile(from, to);
+}
+
+/*先放到临时名再改名，替换已有的文件时别的进程看到的不是旧文件就是完整的新文件*/
+bool placeFile(const std::string &from, const std::string &to)
+{
+    auto tmpPath = to + ".cache-tmp";
+    ::remove(tmpPath.c_str());
+    if(!cloneFile(from, tmpPath)){
+        ::remove(tmpPath.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    ::remove(to.c_str());
+#endif
+    bool ok = rename(tmpPath.c_str(), to.c_str()) == 0;
+    /*to已经是同一个文件的硬链接时rename什么也不做，临时名还在*/
+    ::remove(tmpPath.c_str());
+    return ok;
+}
+
+void parseStats(const char *text, ConversionCache::Stats *stats)
+{
+    long long hits = 0, misses = 0, stores = 0, saved = 0, hashed = 0, micro = 0;
+    sscanf(text, "hits %lld\nmisses %lld\nstores %lld\nsaved %lld\nhashed %lld\nhash_us %lld",
+           &hits, &misses, &stores, &saved, &hashed, &micro);
+    *stats = {hits, misses, stores, saved, hashed, micro / 1e6};
+}
+
+}
+
+ConversionCache::ConversionCache() :
+    hits(0),
+    misses(0),
+    stores(0),
+    savedBytes(0),
+    hashedBytes(0),
+    hashMicroseconds(0)
+{
+}
+
+bool ConversionCache::setDirectory(const std::string &dir)
+{
+    this->dir = dir;
+    while(this->dir.size() > 1 && (this->dir.back() == '/' || this->dir.back() == '\\'))
+        this->dir.pop_back();
+    if(this->dir.empty())
+        return true;
+#ifdef _WIN32
+    int ret = _mkdir(this->dir.c_str());
+#else
+    int ret = mkdir(this->dir.c_str(), 0755);
+#endif
+    if(ret != 0 && errno != EEXIST){
+        this->dir.clear();
+        return false;
+    }
+    return true;
+}
+
+std::string ConversionCache::key(const std::string &input, const ConversionConfig &config)
+{
+    FILE *fp = fopen(input.c_str(), "rb");
+    if(fp == nullptr)
+        return std::string();
+    auto start = std::chrono::steady_clock::now();
+    AVMurMur3 *hash = av_murmur3_alloc();
+    av_murmur3_init(hash);
+    av_murmur3_update(hash, (const uint8_t *)cacheVersion, strlen(cacheVersion));
+    std::vector<uint8_t> block(hashBlock);
+    int64_t total = 0;
+    size_t n;
+    while((n = fread(block.data(), 1, block.size(), fp)) > 0){
+        av_murmur3_update(hash, block.data(), (int)n);
+        total += n;
+    }
+    bool ok = !ferror(fp);
+    fclose(fp);
+    /*长度也算进去，源数据和参数文本的分界不会有歧义*/
+    auto text = "\n" + std::to_string(total) + "\n" + config.outputKey();
+    av_murmur3_update(hash, (const uint8_t *)text.data(), (int)text.size());
+    uint8_t digest[16];
+    av_murmur3_final(hash, digest);
+    av_free(hash);
+    int64_t micro = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+    hashedBytes += total;
+    hashMicroseconds += micro;
+    Stats delta = {};
+    delta.hashedBytes = total;
+    delta.hashSeconds = micro / 1e6;
+    _addTotals(delta);
+    if(!ok)
+        return std::string();
+    char hex[33];
+    for(int i = 0; i < 16; ++i)
+        snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    return hex;
+}
+
+bool ConversionCache::fetch(const std::string &key, const std::string &path)
+{
+    if(!isEnabled() || key.empty())
+        return false;
+    auto entry = _entryPath(key);
+    FileStamp stamp = {}, expect = {};
+    bool hit = false;
+    if(fileStamp(entry, &stamp)){
+        FILE *fp = fopen((entry + ".info").c_str(), "r");
+        long long size = -1, mtime = -1;
+        if(fp != nullptr){
+            if(fscanf(fp, "size %lld\nmtime %lld", &size, &mtime) == 2)
+                expect = {size, mtime};
+            fclose(fp);
+        }
+        /*缓存项被原地改写过（比如通过硬链接的输出），内容已经不可信，转换后store会替换它*/
+        hit = expect.size == stamp.size && expect.mtime == stamp.mtime;
+    }
+    hit = hit && placeFile(entry, path);
+    Stats delta = {};
+    if(hit){
+        ++hits;
+        savedBytes += stamp.size;
+        delta.hits = 1;
+        delta.savedBytes = stamp.size;
+    }
+    else{
+        ++misses;
+        delta.misses = 1;
+    }
+    _addTotals(delta);
+    return hit;
+}
+
+bool ConversionCache::store(const std::string &key, const std::string &path)
+{
+    if(!isEnabled() || key.empty())
+        return false;
+    auto entry = _entryPath(key);
+    FileStamp stamp;
+    if(!placeFile(path, entry) || !fileStamp(entry, &stamp))
+        return false;
+    auto infoPath = entry + ".info";
+    auto tmpPath = infoPath + ".tmp";
+    FILE *fp = fopen(tmpPath.c_str(), "w");
+    if(fp == nullptr)
+        return false;
+    bool ok = fprintf(fp, "size %lld\nmtime %lld\n", (long long)stamp.size, (long long)stamp.mtime) > 0;
+    ok = fclose(fp) == 0 && ok;
+#ifdef _WIN32
+    ::remove(infoPath.c_str());
+#endif
+    ok = ok && rename(tmpPath.c_str(), infoPath.c_str()) == 0;
+    if(ok){
+        ++stores;
+        Stats delta = {};
+        delta.stores = 1;
+        _addTotals(delta);
+    }
+    return ok;
+}
+
+void ConversionCache::detach(const std::string &path)
+{
+#ifndef _WIN32
+    struct stat st;
+    if(isEnabled() && stat(path.c_str(), &st) == 0 && st.st_nlink > 1)
+        unlink(path.c_str());
+#else
+    (void)path;
+#endif
+}
+
+ConversionCache::Stats ConversionCache::stats() const
+{
+    return Stats{hits, misses, stores, savedBytes, hashedBytes, hashMicroseconds / 1e6};
+}
+
+ConversionCache::Stats ConversionCache::totals() const
+{
+    Stats result = {};
+    FILE *fp = fopen((dir + "/stats").c_str(), "r");
+    if(fp == nullptr)
+        return result;
+#ifndef _WIN32
+    flock(fileno(fp), LOCK_SH);
+#endif
+    char text[512];
+    size_t n = fread(text, 1, sizeof(text) - 1, fp);
+    text[n] = 0;
+    fclose(fp);
+    parseStats(text, &result);
+    return result;
+}
+
+std::string ConversionCache::_entryPath(const std::string &key) const
+{
+    return dir + "/" + key;
+}
+
+void ConversionCache::_addTotals(const Stats &delta)
+{
+#ifndef _WIN32
+    /*多个进程共用缓存目录，加锁后读出、累加、写回*/
+    int fd = open((dir + "/stats").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(fd < 0)
+        return;
+    flock(fd, LOCK_EX);
+    char text[512];
+    ssize_t n = pread(fd, text, sizeof(text) - 1, 0);
+    text[n > 0 ? n : 0] = 0;
+    Stats total;
+    parseStats(text, &total);
+    int length = snprintf(text, sizeof(text), "hits %lld\nmisses %lld\nstores %lld\nsaved %lld\nhashed %lld\nhash_us %lld\n",
+                          (long long)(total.hits + delta.hits), (long long)(total.misses + delta.misses),
+                          (long long)(total.stores + delta.stores), (long long)(total.savedBytes + delta.savedBytes),
+                          (long long)(total.hashedBytes + delta.hashedBytes),
+                          (long long)((total.hashSeconds + delta.hashSeconds) * 1e6 + 0.5));
+    if(ftruncate(fd, 0) == 0 && pwrite(fd, text, length, 0) != length)
+        fprintf(stderr, "cannot update cache statistics in %s\n", dir.c_str());
+    close(fd);
+#else
+    (void)delta;
+#endif
+}
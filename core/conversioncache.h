@@ -0,0 +1,80 @@
+#ifndef CONVERSIONCACHE_H
+#define CONVERSIONCACHE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include "conversionconfig.h"
+
+/**
+ * @brief 按内容缓存转换结果
+ * 键为源文件全部字节和影响输出的转换参数的murmur3哈希，命中时把缓存的输出克隆（reflink）或硬链接到输出路径，
+ * 不用再转换；文件系统都不支持时复制。
+ * 缓存项和输出可能是同一个inode，输出被原地改写后缓存项也变了，所以每项旁边记下存入时的长度和修改时间，
+ * 对不上时当作没有命中，转换后重新存入。
+ * 命中、未命中等计数除了本进程的，还累加到缓存目录的stats文件里，多个进程共用一个目录时是总数
+ */
+class ConversionCache
+{
+public:
+    struct Stats{
+        int64_t hits;
+        int64_t misses;
+        int64_t stores;
+        /*命中时省下的输出字节数*/
+        int64_t savedBytes;
+        /*计算哈希读过的源文件字节数和用时*/
+        int64_t hashedBytes;
+        double hashSeconds;
+    };
+
+public:
+    ConversionCache();
+
+    /**
+     * @brief 为空时不使用缓存，目录不存在时创建，创建失败时返回false并且不使用缓存
+     */
+    bool setDirectory(const std::string &dir);
+    bool isEnabled() const;
+
+    /**
+     * @brief 源文件内容加上参数的键，读不了源文件时返回空
+     */
+    std::string key(const std::string &input, const ConversionConfig &config);
+    /**
+     * @brief 命中时把缓存的输出放到path（替换已有的文件）并返回true；不论结果都计数
+     */
+    bool fetch(const std::string &key, const std::string &path);
+    /**
+     * @brief 转换写出path之后调用，把它存为key的缓存项
+     */
+    bool store(const std::string &key, const std::string &path);
+    /**
+     * @brief 未命中、准备写出之前调用：path是缓存项的硬链接时先删掉，转换结果不会写进缓存项
+     */
+    void detach(const std::string &path);
+
+    /**
+     * @brief 本进程的计数
+     */
+    Stats stats() const;
+    /**
+     * @brief 缓存目录里累计的计数
+     */
+    Stats totals() const;
+
+private:
+    std::string _entryPath(const std::string &key) const;
+    void _addTotals(const Stats &delta);
+private:
+    std::string dir;
+    std::atomic<int64_t> hits;
+    std::atomic<int64_t> misses;
+    std::atomic<int64_t> stores;
+    std::atomic<int64_t> savedBytes;
+    std::atomic<int64_t> hashedBytes;
+    std::atomic<int64_t> hashMicroseconds;
+};
+
+inline bool ConversionCache::isEnabled() const                                  {   return !dir.empty();}
+#endif // CONVERSIONCACHE_H
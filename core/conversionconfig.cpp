@@ -0,0 +1,72 @@
+#include "conversionconfig.h"
+#include <stdio.h>
+#include <inttypes.h>
+extern "C"{
+#include "libavutil/channel_layout.h"
+}
+
+ConversionConfig::ConversionConfig() :
+    srcFormat(AV_SAMPLE_FMT_S16),
+    srcLayout(AV_CH_LAYOUT_STEREO),
+    srcRate(48000),
+    srcCoding(SampleCodec::Native),
+    dstFormat(AV_SAMPLE_FMT_S16),
+    dstLayout(AV_CH_LAYOUT_STEREO),
+    dstRate(48000),
+    dstCoding(SampleCodec::Native),
+    container(AudioContainer::WAV),
+    dither(false),
+    ditherMethod(ResamplerOptions::NoDither),
+    ditherScale(1.0),
+    quality(ResamplerOptions::Normal),
+    backend(ResamplerOptions::Swresample),
+    measureLoudness(false),
+    normalize(false),
+    targetLoudness(-23.0),
+    truePeakCeiling(-1.0),
+    trimSilence(false),
+    silenceThreshold(-60.0),
+    silenceMinDuration(0.5),
+    silenceMaxGap(0),
+    segmentStart(0),
+    segmentEnd(-1),
+    checkpointInterval(0)
+{
+}
+
+bool ConversionConfig::setChannelMap(const std::string &map)
+{
+    channelMap.clear();
+    if(map.find_first_not_of(" \t\r\n") == std::string::npos)
+        return true;
+    return ChannelMapper::parse(map,channelMap);
+}
+
+std::string ConversionConfig::outputKey() const
+{
+    /*路径和断点间隔不影响输出内容，不在其中；浮点数用%.17g，不同的double写出的文本一定不同*/
+    char text[512];
+    snprintf(text,sizeof(text),"%d %" PRId64 " %d %d %d %" PRId64 " %d %d %d %d %d %.17g %d %d %d %.17g %.17g %d %.17g %.17g %.17g %" PRId64 " %" PRId64,
+             (int)srcFormat,srcLayout,srcRate,(int)srcCoding,
+             (int)dstFormat,dstLayout,dstRate,(int)dstCoding,(int)container,
+             (int)dither,(int)ditherMethod,ditherScale,(int)quality,(int)backend,
+             (int)normalize,targetLoudness,truePeakCeiling,
+             (int)trimSilence,silenceThreshold,silenceMinDuration,silenceMaxGap,
+             segmentStart,segmentEnd);
+    std::string key = text;
+    for(double v : matrix){
+        snprintf(text,sizeof(text)," %.17g",v);
+        key += text;
+    }
+    for(auto &output : channelMap){
+        key += " |";
+        for(auto &channel : output){
+            key += " ;";
+            for(auto &term : channel){
+                snprintf(text,sizeof(text)," %d:%.17g",term.channel,term.gain);
+                key += text;
+            }
+        }
+    }
+    return key;
+}
@@ -0,0 +1,78 @@
+#ifndef CONVERSIONCONFIG_H
+#define CONVERSIONCONFIG_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "channelmapper.h"
+#include "samplecodec.h"
+#include "audiowriter.h"
+#include "resampleroptions.h"
+extern "C"{
+#include "libavutil/samplefmt.h"
+}
+
+/**
+ * @brief 一次转换的全部参数
+ * 调用方在自己的线程里填好后按值交给执行转换的线程，转换期间不再改变，
+ * 多个任务各自持有一份，不需要加锁
+ */
+struct ConversionConfig
+{
+    ConversionConfig();
+
+    /**
+     * @brief 解析声道映射，空白时清空，格式错误时返回false
+     */
+    bool setChannelMap(const std::string &map);
+    /**
+     * @brief 影响输出文件内容的全部参数写成的文本，相同的源文件和相同的文本得到相同的输出
+     */
+    std::string outputKey() const;
+
+    /*裸PCM源的参数，封装格式以文件头为准*/
+    AVSampleFormat srcFormat;
+    int64_t srcLayout;
+    int srcRate;
+    SampleCodec::Coding srcCoding;
+
+    AVSampleFormat dstFormat;
+    int64_t dstLayout;
+    int dstRate;
+    SampleCodec::Coding dstCoding;
+    AudioContainer::Type container;
+
+    /*dither为写出时降低位深的抖动，ditherMethod为swresample内的抖动*/
+    bool dither;
+    ResamplerOptions::Dither ditherMethod;
+    double ditherScale;
+    ResamplerOptions::Quality quality;
+    ResamplerOptions::Backend backend;
+    /*自定义混音矩阵，按输出声道排列，每行为输入声道数个系数*/
+    std::vector<double> matrix;
+    /*声道映射，每项为一个输出文件*/
+    std::vector<ChannelMapper::Output> channelMap;
+
+    /*BS.1770响度和真峰值的测量开销较大，只在归一化或者measureLoudness时进行*/
+    bool measureLoudness;
+    bool normalize;
+    double targetLoudness;
+    double truePeakCeiling;
+
+    bool trimSilence;
+    double silenceThreshold;
+    double silenceMinDuration;
+    double silenceMaxGap;
+
+    /*分段转换的源帧范围[segmentStart, segmentEnd)，segmentEnd为-1时到结尾；
+      两端要落在两个采样率的公共周期上，各段的输出依次拼接后和整个文件一次转换的结果相同*/
+    int64_t segmentStart;
+    int64_t segmentEnd;
+
+    /*为空时不使用*/
+    std::string overviewPath;
+    std::string checkpointPath;
+    double checkpointInterval;
+};
+
+#endif // CONVERSIONCONFIG_H
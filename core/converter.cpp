@@ -0,0 +1,902 @@
+#include "converter.h"
+#include "audiokernels.h"
+#include "wavheader.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+extern "C"{
+#include "libavutil/opt.h"
+}
+
+namespace {
+
+std::string format(const char *fmt, ...)
+{
+    char text[512];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    return text;
+}
+
+int64_t elapsedNs(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+int gcd(int a, int b)
+{
+    while(b != 0){
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/*分段转换时段前段后多读的源帧数，比各档质量的滤波器长度都大得多*/
+const int64_t segmentOverlapFrames = 16384;
+
+bool seek64(FILE *fp, int64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(fp, offset, SEEK_SET) == 0;
+#else
+    return fseeko(fp, offset, SEEK_SET) == 0;
+#endif
+}
+
+}
+
+Converter::Converter() :
+    srcLayout(AV_CH_LAYOUT_STEREO),
+    dstLayout(AV_CH_LAYOUT_STEREO),
+    srcSampleFormat(AV_SAMPLE_FMT_S16),
+    dstSampleFormat(AV_SAMPLE_FMT_S16),
+    srcSampleRate(48000),
+    dstSampleRate(48000),
+    srcCoding(SampleCodec::Native),
+    dstCoding(SampleCodec::Native),
+    exactCopy(false),
+    analysisTime(0),
+    loudnessMeasured(false),
+    normalizeGain(1.0),
+    resumedFrames(0),
+    segmentSkip(0),
+    segmentOutput(-1),
+    segmentTail(true),
+    changeFlag(false),
+    progressDone(0),
+    progressTotal(0)
+{
+    srcInfo.container = AudioContainer::Raw;
+}
+
+bool Converter::open(const std::string &path)
+{
+    srcPath = path;
+    srcData.clear();
+    bool ok = AudioReader::probe(path,srcInfo);
+    if(isRaw())
+        return true;
+    if(!ok){
+        _message("unsupported or damaged file header");
+        return false;
+    }
+    _message(format("%s: %d ch, %d Hz, %d bits%s%s",
+                    AudioContainer::extension(srcInfo.container),
+                    srcInfo.channels,srcInfo.sampleRate,srcInfo.bitsPerSample,
+                    srcInfo.isFloat ? " float" : "",
+                    srcInfo.bigEndian ? " big endian" : ""));
+    return true;
+}
+
+int Converter::sourceRate() const
+{
+    return isRaw() ? config.srcRate : srcInfo.sampleRate;
+}
+
+AVSampleFormat Converter::sourceFormat() const
+{
+    AVSampleFormat format = config.srcFormat;
+    SampleCodec::Coding coding = config.srcCoding;
+    if(!isRaw())
+        srcInfo.toSampleFormat(&format,&coding);
+    return SampleCodec::decodedFormat(coding,format);
+}
+
+int Converter::sourceChannels() const
+{
+    return av_get_channel_layout_nb_channels(isRaw() ? config.srcLayout : srcInfo.layout);
+}
+
+int64_t Converter::sourceFrames() const
+{
+    AVSampleFormat format = config.srcFormat;
+    SampleCodec::Coding coding = config.srcCoding;
+    if(!isRaw())
+        srcInfo.toSampleFormat(&format,&coding);
+    int64_t frameBytes = (int64_t)SampleCodec::codedBytes(coding,format) * sourceChannels();
+    return frameBytes > 0 ? srcInfo.dataSize / frameBytes : 0;
+}
+
+bool Converter::exactPhases() const
+{
+    int srcRate = sourceRate();
+    if(srcRate == config.dstRate)
+        return true;
+    /*内置的多相滤波器总是使用约分后的全部相位*/
+    if(config.backend == ResamplerOptions::Polyphase
+            && _polyphaseUsable(srcRate,isRaw() ? config.srcLayout : srcInfo.layout,sourceFormat()))
+        return true;
+    return ResamplerOptions::hasExactPhases(config.quality,srcRate,config.dstRate);
+}
+
+bool Converter::_polyphaseUsable(int srcRate, int64_t srcLayout, AVSampleFormat srcFormat) const
+{
+    return srcRate != config.dstRate && srcLayout == config.dstLayout
+            && config.matrix.empty() && config.channelMap.empty() && !av_sample_fmt_is_planar(srcFormat)
+            && config.ditherMethod == ResamplerOptions::NoDither
+            && PolyphaseResampler::supports(srcRate,config.dstRate);
+}
+
+void Converter::_applySrcInfo()
+{
+    /*每次读入都从配置开始，上次解码后的格式不会带到这次*/
+    srcLayout = config.srcLayout;
+    srcSampleRate = config.srcRate;
+    srcSampleFormat = config.srcFormat;
+    srcCoding = config.srcCoding;
+    if(isRaw())
+        return;
+    srcLayout = srcInfo.layout;
+    srcSampleRate = srcInfo.sampleRate;
+    srcInfo.toSampleFormat(&srcSampleFormat,&srcCoding);
+}
+
+bool Converter::load()
+{
+    _applySrcInfo();
+    srcData.clear();
+    FILE *fp = fopen(srcPath.c_str(),"rb");
+    if(fp == nullptr){
+        _message("file open error");
+        return false;
+    }
+    /*封装格式只取音频数据，文件头和其它块不读；分段转换只读这一段和前后的重叠部分*/
+    int64_t begin, end;
+    if(!_segmentRange(&begin,&end)){
+        fclose(fp);
+        _message("segment is outside the file or not aligned to the sample rates");
+        return false;
+    }
+    int64_t frameBytes = (int64_t)SampleCodec::codedBytes(srcCoding,srcSampleFormat) * av_get_channel_layout_nb_channels(srcLayout);
+    int64_t size = _segmented() ? (end - begin) * frameBytes : srcInfo.dataSize;
+    bool ok = seek64(fp,srcInfo.dataOffset + begin * frameBytes);
+    if(ok && size > 0){
+        srcData.resize(size);
+        srcData.resize(fread(srcData.data(),1,srcData.size(),fp));
+    }
+    fclose(fp);
+    if(!ok){
+        _message("file read error");
+        return false;
+    }
+    if(srcCoding != SampleCodec::Native){
+        /*整个文件一次解码为内部格式，后面的流程不用关心文件里的存放方式*/
+        auto start = std::chrono::steady_clock::now();
+        auto decodedFormat = SampleCodec::decodedFormat(srcCoding,srcSampleFormat);
+        int64_t count = srcData.size() / SampleCodec::codedBytes(srcCoding,srcSampleFormat);
+        std::vector<uint8_t> decoded(count * av_get_bytes_per_sample(decodedFormat));
+        SampleCodec::decode(srcCoding,srcSampleFormat,srcData.data(),count,decoded.data());
+        auto ns = elapsedNs(start);
+        _message(format("decode %.1f MB in %.1f ms (%.0f MB/s)",
+                        srcData.size() / 1e6,ns / 1e6,ns > 0 ? srcData.size() * 1e3 / ns : 0.0));
+        srcData.swap(decoded);
+    }
+    srcSampleFormat = SampleCodec::decodedFormat(srcCoding,srcSampleFormat);
+    return true;
+}
+
+Converter::Status Converter::run()
+{
+    progressDone = 0;
+    progressTotal = 0;
+    auto start = std::chrono::steady_clock::now();
+    /*文件里的数据总是交错存放，平面格式按对应的交错格式输出*/
+    dstLayout = config.dstLayout;
+    dstSampleRate = config.dstRate;
+    dstCoding = config.dstCoding;
+    dstSampleFormat = av_get_packed_sample_fmt(config.dstFormat);
+    dstSampleFormat = SampleCodec::decodedFormat(dstCoding,dstSampleFormat);
+    checkpoint.setPath(config.checkpointPath);
+    trimmer.setThreshold(config.silenceThreshold);
+    trimmer.setMinDuration(config.silenceMinDuration);
+    trimmer.setMaxGap(config.silenceMaxGap);
+    dstData.clear();
+    mappedData.clear();
+    exactCopy = false;
+    resumedFrames = 0;
+    /*开始之前已经停止，没有结果，也没有报告*/
+    if(!changeFlag){
+        lastReport.clear();
+        _message("conversion cancelled");
+        return Cancelled;
+    }
+    /*这些处理依赖整个文件的内容*/
+    if(_segmented() && (config.normalize || config.trimSilence || config.channelMap.size() > 1)){
+        _message("loudness normalization, silence trimming and multiple outputs need the whole file");
+        return Failed;
+    }
+    if(_segmented() && !exactPhases()){
+        _message("segmented conversion needs a resampler with exact phases");
+        return Failed;
+    }
+    if(!load())
+        return Failed;
+    if(checkpoint.isEnabled() && config.checkpointInterval > 0 && !exactPhases())
+        _message("resampler phases are not exact for this quality and rate, checkpoints disabled");
+    /*有声道映射时输出布局由第一个输出的声道数决定*/
+    if(!config.channelMap.empty())
+        dstLayout = av_get_default_channel_layout((int)config.channelMap[0].size());
+    srcAnalyzer.reset(av_get_channel_layout_nb_channels(srcLayout),srcSampleFormat);
+    dstAnalyzer.reset(av_get_channel_layout_nb_channels(dstLayout),dstSampleFormat);
+    analysisTime = 0;
+    srcMeter.reset(av_get_channel_layout_nb_channels(srcLayout),srcSampleRate,srcLayout);
+    dstMeter.reset(av_get_channel_layout_nb_channels(dstLayout),dstSampleRate,dstLayout);
+    loudnessMeasured = false;
+    normalizeGain = 1.0;
+    trimmer.reset(av_get_channel_layout_nb_channels(dstLayout),dstSampleFormat,dstSampleRate);
+    /*旁路文件有效时直接使用，否则在这次读取中一起生成*/
+    if(!loadOverview())
+        overview.reset(av_get_channel_layout_nb_channels(srcLayout),srcSampleRate);
+    /*响度归一化需要先完整测量一遍源文件*/
+    if(config.normalize)
+        _measureLoudness();
+    bool f;
+    /*只改变声道时不经过swresample，多个输出也只读一遍源数据*/
+    bool mapOnly = !config.channelMap.empty() && av_get_packed_sample_fmt(srcSampleFormat) == dstSampleFormat
+            && srcSampleRate == dstSampleRate && normalizeGain == 1.0 && !config.trimSilence;
+    if(mapOnly)
+        f = _channelMap();
+    else if(config.channelMap.size() > 1){
+        _message("multiple outputs need the same sample rate and format as the source");
+        f = false;
+    }
+    else if(srcLayout != dstLayout || srcSampleFormat != dstSampleFormat || srcSampleRate != dstSampleRate
+            || normalizeGain != 1.0 || config.trimSilence || !config.matrix.empty() || !config.channelMap.empty()){
+        /*内置的多相滤波器只做采样率和格式转换，混音和抖动仍交给swresample*/
+        bool polyphaseOk = _polyphaseUsable(srcSampleRate,srcLayout,srcSampleFormat);
+        if(config.backend == ResamplerOptions::Polyphase && !polyphaseOk)
+            _message("polyphase resampler does not support this conversion, use swresample");
+        if(config.backend == ResamplerOptions::Polyphase && polyphaseOk)
+            f = _resamplePolyphase();
+        else
+            f = _resample();
+    }
+    else
+        f = _passthrough();
+    /*中途停止时结果不完整，不能当作成功；断点保留，下次从断点继续*/
+    Status status = !f ? Failed : (changeFlag ? Finished : Cancelled);
+    if(status == Finished){
+        /*恢复的转换和分段转换没有读整个文件，波形概览不完整，不保存*/
+        if(resumedFrames == 0 && !_segmented())
+            _finishOverview();
+        checkpoint.remove();
+    }
+    if(f)
+        _buildReport(elapsedNs(start));
+    if(status == Cancelled)
+        _message("conversion cancelled");
+    return status;
+}
+
+bool Converter::loadOverview()
+{
+    if(srcPath.empty() || config.overviewPath.empty())
+        return false;
+    struct stat src, peaks;
+    if(stat(srcPath.c_str(),&src) != 0 || stat(config.overviewPath.c_str(),&peaks) != 0
+            || peaks.st_mtime < src.st_mtime)
+        return false;
+    if(!overview.load(config.overviewPath,src.st_size,_overviewTag()))
+        return false;
+    _message("load waveform overview from " + config.overviewPath);
+    if(callbacks.overviewReady)
+        callbacks.overviewReady();
+    return true;
+}
+
+bool Converter::_resample()
+{
+    std::vector<double> matrix;
+    if((normalizeGain != 1.0 || !config.matrix.empty() || !config.channelMap.empty()) && !_buildMatrix(normalizeGain,matrix)){
+        fprintf(stderr, "Failed to set the rematrix matrix\n");
+        return false;
+    }
+    if(config.quality == ResamplerOptions::Best && !ResamplerOptions::soxrAvailable())
+        _message("soxr is not available, use the built-in resampler");
+
+    /*抖动在swr_convert里按块进行，误差反馈的状态在块之间保持；
+      相同参数的context从缓存中取，滤波器组不用重新计算*/
+    stream.setQuality(config.quality);
+    stream.setDither(config.ditherMethod,config.ditherScale);
+    stream.setMatrix(matrix);
+    auto initStart = std::chrono::steady_clock::now();
+    /*文件里的数据总是交错存放*/
+    if(!stream.open({av_get_packed_sample_fmt(srcSampleFormat),srcLayout,srcSampleRate},
+                    {dstSampleFormat,dstLayout,dstSampleRate})){
+        fprintf(stderr, "Failed to initialize the resampling context\n");
+        return false;
+    }
+
+    _message(format("resampler quality %s, dither %s x%.2f, init %.2f ms%s",
+                    ResamplerOptions::name(config.quality),
+                    ResamplerOptions::ditherName(config.ditherMethod),
+                    config.ditherScale,
+                    elapsedNs(initStart) / 1e6,
+                    stream.reusedFilter() ? " (cached filter)" : ""));
+
+    int64_t frameSize = stream.inputFormat().frameBytes();
+    int64_t dstFrameSize = stream.outputFormat().frameBytes();
+    int64_t startFrame, skipBytes;
+    _resumeCheckpoint(&startFrame,&skipBytes);
+    if(_segmented())
+        skipBytes = segmentSkip * dstFrameSize;
+    int64_t keepBytes = segmentOutput < 0 ? INT64_MAX : segmentOutput * dstFrameSize;
+    /*转换结果直接从队列里交给分析和写出，不再拷贝一次；恢复和分段时先丢掉预读部分的输出，
+      分段时段后重叠部分的输出也不要*/
+    auto drain = [&](){
+        int64_t bytes;
+        auto data = stream.peek(&bytes);
+        int64_t skip = std::min(skipBytes,bytes);
+        skipBytes -= skip;
+        int64_t n = std::min(bytes - skip,keepBytes);
+        if(n > 0){
+            _emitDst(data + skip,n / dstFrameSize,n);
+            keepBytes -= n;
+        }
+        stream.consume(bytes);
+    };
+    const int64_t blockSize = 1024 * frameSize;
+    int64_t size = srcData.size() / frameSize * frameSize;
+    int64_t checkpointBytes = (int64_t)(config.checkpointInterval * srcSampleRate) * frameSize;
+    int64_t nextCheckpoint = startFrame * frameSize + checkpointBytes;
+    _progress(startFrame * frameSize,size);
+    for(int64_t pos = startFrame * frameSize;pos < size && changeFlag;pos += blockSize){
+        int64_t n = std::min(blockSize,size - pos);
+        _inspectSrc(srcData.data() + pos,n / frameSize);
+        if(!stream.push(srcData.data() + pos,n)){
+            fprintf(stderr, "Error while converting\n");
+            stream.close();
+            return false;
+        }
+        drain();
+        _progress(pos + n,size);
+        if(_checkpointEnabled() && pos + n >= nextCheckpoint && skipBytes == 0){
+            _commitCheckpoint(stream.delay());
+            nextCheckpoint += checkpointBytes;
+        }
+    }
+    if(!changeFlag && _checkpointEnabled() && skipBytes == 0)
+        _commitCheckpoint(stream.delay());
+    /*取出滤波器延迟里剩下的样本，输出长度和采样率之比一致；分段时只有读到文件结尾的一段需要*/
+    if(changeFlag && segmentTail && !stream.finish()){
+        fprintf(stderr, "Error while converting\n");
+        stream.close();
+        return false;
+    }
+    drain();
+    if(changeFlag && segmentOutput >= 0 && keepBytes > 0){
+        _message("segment overlap too short for the resampling filter");
+        stream.close();
+        return false;
+    }
+
+    if(config.trimSilence)
+        trimmer.finish([this](const uint8_t *data,int bytes){ _writeDst(data,bytes);});
+    stream.close();
+    return true;
+}
+
+bool Converter::_resamplePolyphase()
+{
+    auto channels = av_get_channel_layout_nb_channels(srcLayout);
+    auto initStart = std::chrono::steady_clock::now();
+    if(!polyphase.init(srcSampleRate,dstSampleRate,channels)){
+        _message("Failed to initialize the polyphase resampler");
+        return false;
+    }
+    _message(format("resampler %s, init %.2f ms",
+                    ResamplerOptions::backendName(config.backend),elapsedNs(initStart) / 1e6));
+
+    auto frameSize = av_get_bytes_per_sample(srcSampleFormat) * channels;
+    auto dstFrameSize = av_get_bytes_per_sample(dstSampleFormat) * channels;
+    int64_t totalFrames = srcData.size() / frameSize;
+    const int blockFrames = 4096;
+    int stride = polyphase.maxOutput(blockFrames);
+    resampledBuffer.resize(stride * channels);
+    std::vector<uint8_t> block(stride * dstFrameSize);
+    int64_t startFrame, skipBytes;
+    _resumeCheckpoint(&startFrame,&skipBytes);
+    int64_t skipFrames = _segmented() ? segmentSkip : skipBytes / dstFrameSize;
+    int64_t keepFrames = segmentOutput < 0 ? INT64_MAX : segmentOutput;
+    /*增益在转回输出格式时一起乘上，恢复和分段时先丢掉预读部分的输出，分段时也不要段后重叠部分的输出*/
+    auto emitBlock = [&](int frames){
+        int skip = (int)std::min<int64_t>(skipFrames,frames);
+        skipFrames -= skip;
+        frames = (int)std::min<int64_t>(frames - skip,keepFrames);
+        keepFrames -= frames;
+        AudioKernels::interleaveFromFloat(resampledBuffer.data() + skip,stride,channels,frames,
+                                          (float)normalizeGain,dstSampleFormat,block.data());
+        _emitDst(block.data(),frames,frames * dstFrameSize);
+    };
+    int64_t checkpointFrames = (int64_t)(config.checkpointInterval * srcSampleRate);
+    int64_t nextCheckpoint = startFrame + checkpointFrames;
+    _progress(startFrame * frameSize,srcData.size());
+    for(int64_t pos = startFrame;pos < totalFrames && changeFlag;pos += blockFrames){
+        int n = (int)std::min<int64_t>(blockFrames,totalFrames - pos);
+        /*_inspectSrc成功后floatBuffer里就是这一块按声道分开的float数据*/
+        if(!_inspectSrc(srcData.data() + pos * frameSize,n)){
+            _message("unsupported source sample format");
+            return false;
+        }
+        emitBlock(polyphase.process(floatBuffer.data(),n,resampledBuffer.data(),stride));
+        _progress((pos + n) * frameSize,srcData.size());
+        if(_checkpointEnabled() && pos + n >= nextCheckpoint && skipFrames == 0){
+            _commitCheckpoint(0);
+            nextCheckpoint += checkpointFrames;
+        }
+    }
+    if(!changeFlag){
+        if(_checkpointEnabled() && skipFrames == 0)
+            _commitCheckpoint(0);
+        return true;
+    }
+    if(segmentTail)
+        emitBlock(polyphase.flush(resampledBuffer.data(),stride));
+    if(segmentOutput >= 0 && keepFrames > 0){
+        _message("segment overlap too short for the resampling filter");
+        return false;
+    }
+
+    if(config.trimSilence)
+        trimmer.finish([this](const uint8_t *data,int bytes){ _writeDst(data,bytes);});
+    return true;
+}
+
+bool Converter::_passthrough()
+{
+    int64_t frameSize = av_get_bytes_per_sample(srcSampleFormat) * av_get_channel_layout_nb_channels(srcLayout);
+    const int64_t blockSize = 1024 * frameSize;
+    int64_t size = srcData.size();
+    _progress(0,size);
+    for(int64_t pos = 0;pos < size && changeFlag;pos += blockSize){
+        int64_t n = std::min(blockSize,size - pos);
+        _inspectSrc(srcData.data() + pos,n / frameSize);
+        _progress(pos + n,size);
+    }
+    /*输出和输入完全一样，不用再统计一遍*/
+    exactCopy = true;
+    dstAnalyzer = srcAnalyzer;
+    dstMeter = srcMeter;
+    dstData = srcData;
+    _progress(size,size);
+    return true;
+}
+
+bool Converter::_channelMap()
+{
+    auto channels = av_get_channel_layout_nb_channels(srcLayout);
+    if(!mapper.setup(channels,srcSampleFormat,config.channelMap)){
+        _message("channel map does not match the source channels");
+        return false;
+    }
+    auto bytesPerSample = av_get_bytes_per_sample(dstSampleFormat);
+    auto frameSize = bytesPerSample * channels;
+    int64_t totalFrames = srcData.size() / frameSize;
+    /*输出一次分配好，映射结果直接写到最终位置*/
+    mappedData.resize(mapper.outputCount());
+    for(int k = 0;k < mapper.outputCount();++k)
+        mappedData[k].resize(totalFrames * mapper.outputChannels(k) * bytesPerSample);
+    std::vector<uint8_t *> dst(mapper.outputCount());
+    const int blockFrames = 4096;
+    _progress(0,srcData.size());
+    for(int64_t pos = 0;pos < totalFrames && changeFlag;pos += blockFrames){
+        int n = (int)std::min<int64_t>(blockFrames,totalFrames - pos);
+        auto src = srcData.data() + pos * frameSize;
+        _inspectSrc(src,n);
+        for(int k = 0;k < mapper.outputCount();++k)
+            dst[k] = mappedData[k].data() + pos * mapper.outputChannels(k) * bytesPerSample;
+        mapper.process(src,n,dst.data());
+        /*分析和测试播放只针对第一个输出*/
+        _inspectDst(dst[0],n);
+        _progress((pos + n) * frameSize,srcData.size());
+    }
+    dstData = mappedData[0];
+    exactCopy = mapper.isSelection();
+    return true;
+}
+
+bool Converter::_inspectSrc(const uint8_t *data, int frames)
+{
+    if(frames <= 0)
+        return false;
+    auto start = std::chrono::steady_clock::now();
+    auto channels = srcAnalyzer.channels();
+    if(floatBuffer.size() < (size_t)channels * frames)
+        floatBuffer.resize(channels * frames);
+    bool converted = AudioKernels::deinterleaveToFloat(data,srcSampleFormat,channels,frames,floatBuffer.data());
+    if(converted){
+        srcAnalyzer.addBlock(floatBuffer.data(),frames);
+        if(!loudnessMeasured && _loudnessEnabled())
+            srcMeter.addBlock(floatBuffer.data(),frames);
+        if(!overview.isFinished())
+            overview.addBlock(floatBuffer.data(),frames);
+    }
+    analysisTime += elapsedNs(start);
+    return converted;
+}
+
+bool Converter::_inspectDst(const uint8_t *data, int frames)
+{
+    if(frames <= 0)
+        return false;
+    auto start = std::chrono::steady_clock::now();
+    auto channels = dstAnalyzer.channels();
+    if(floatBuffer.size() < (size_t)channels * frames)
+        floatBuffer.resize(channels * frames);
+    bool converted = AudioKernels::deinterleaveToFloat(data,dstSampleFormat,channels,frames,floatBuffer.data());
+    if(converted){
+        dstAnalyzer.addBlock(floatBuffer.data(),frames);
+        if(_loudnessEnabled())
+            dstMeter.addBlock(floatBuffer.data(),frames);
+    }
+    analysisTime += elapsedNs(start);
+    return converted;
+}
+
+void Converter::_emitDst(const uint8_t *data, int frames, int bytes)
+{
+    /*_inspectDst成功后floatBuffer里就是这一块的float数据*/
+    if(_inspectDst(data,frames) && config.trimSilence)
+        trimmer.process(data,floatBuffer.data(),frames,
+                        [this](const uint8_t *data,int bytes){ _writeDst(data,bytes);});
+    else
+        _writeDst(data,bytes);
+}
+
+void Converter::_writeDst(const uint8_t *data, int bytes)
+{
+    dstData.insert(dstData.end(),data,data + bytes);
+}
+
+void Converter::_buildReport(int64_t totalTime)
+{
+    std::string report = srcAnalyzer.report("source") + dstAnalyzer.report("output");
+    /*恢复的转换只分析了断点之后的部分*/
+    if(resumedFrames > 0 && srcSampleRate > 0)
+        report += format("resumed from checkpoint at %.1f s, analysis covers the rest only\n",
+                         (double)resumedFrames / srcSampleRate);
+    if(_loudnessEnabled())
+        report += format("loudness: source %.1f LUFS, %.1f dBTP; output %.1f LUFS, %.1f dBTP\n",
+                         srcMeter.integrated(),srcMeter.truePeak(),
+                         dstMeter.integrated(),dstMeter.truePeak());
+    if(config.trimSilence && dstSampleRate > 0){
+        report += format("silence: removed %.2f s leading, %.2f s trailing, %.2f s in gaps\n",
+                         (double)trimmer.leadingFrames() / dstSampleRate,
+                         (double)trimmer.trailingFrames() / dstSampleRate,
+                         (double)trimmer.gapFrames() / dstSampleRate);
+    }
+    /*分析本身的耗时，用来确认对转换速度的影响*/
+    double seconds = srcSampleRate > 0 ? (double)srcAnalyzer.frames() / srcSampleRate : 0;
+    report += format("analysis %.2f ms of %.2f ms (%.1f%%), %.0fx realtime overall",
+                     analysisTime / 1e6,totalTime / 1e6,
+                     totalTime > 0 ? 100.0 * analysisTime / totalTime : 0.0,
+                     totalTime > 0 ? seconds * 1e9 / totalTime : 0.0);
+    lastReport = report;
+    _message(report);
+}
+
+void Converter::_finishOverview()
+{
+    if(overview.isFinished())
+        return;
+    overview.finish();
+    if(config.overviewPath.empty())
+        return;
+    struct stat src;
+    if(stat(srcPath.c_str(),&src) == 0 && overview.save(config.overviewPath,src.st_size,_overviewTag()))
+        _message("waveform overview saved");
+    else
+        _message("waveform overview save error");
+    if(callbacks.overviewReady)
+        callbacks.overviewReady();
+}
+
+bool Converter::_loudnessEnabled() const
+{
+    return config.normalize || config.measureLoudness;
+}
+
+void Converter::_measureLoudness()
+{
+    auto channels = srcMeter.channels();
+    int64_t frameSize = av_get_bytes_per_sample(srcSampleFormat) * channels;
+    const int64_t blockSize = 4096 * frameSize;
+    int64_t size = srcData.size();
+    auto start = std::chrono::steady_clock::now();
+    for(int64_t pos = 0;pos < size && changeFlag;pos += blockSize){
+        int frames = (int)(std::min(blockSize,size - pos) / frameSize);
+        if(floatBuffer.size() < (size_t)channels * frames)
+            floatBuffer.resize(channels * frames);
+        if(!AudioKernels::deinterleaveToFloat(srcData.data() + pos,srcSampleFormat,
+                                              channels,frames,floatBuffer.data()))
+            return;
+        srcMeter.addBlock(floatBuffer.data(),frames);
+    }
+    analysisTime += elapsedNs(start);
+    loudnessMeasured = true;
+
+    double loudness = srcMeter.integrated();
+    if(std::isinf(loudness)){
+        _message("loudness: source is too short or silent, skip normalization");
+        return;
+    }
+    /*增益不能让真峰值超过上限*/
+    double gain = config.targetLoudness - loudness;
+    double peakLimit = config.truePeakCeiling - srcMeter.truePeak();
+    if(gain > peakLimit){
+        _message(format("loudness: gain limited by true peak ceiling %.1f dBTP",config.truePeakCeiling));
+        gain = peakLimit;
+    }
+    normalizeGain = pow(10.0,gain / 20);
+    _message(format("loudness: measured %.1f LUFS, apply %.2f dB gain",loudness,gain));
+}
+
+bool Converter::_buildMatrix(double gain, std::vector<double> &result)
+{
+    /*
+     * 使用设置的混音矩阵，没有设置时取swresample默认的矩阵，
+     * 再乘以归一化增益，增益在重采样内部的浮点运算中完成
+     */
+    auto in = av_get_channel_layout_nb_channels(srcLayout);
+    auto out = av_get_channel_layout_nb_channels(dstLayout);
+    std::vector<double> matrix(in * out);
+    if(!config.channelMap.empty()){
+        auto map = ChannelMapper::toMatrix(config.channelMap[0],in);
+        std::copy(map.begin(),map.end(),matrix.begin());
+    }
+    else if(!config.matrix.empty()){
+        if((int)config.matrix.size() != in * out){
+            _message(format("matrix size %d does not match %dx%d channels",(int)config.matrix.size(),out,in));
+            return false;
+        }
+        matrix = config.matrix;
+    }
+    else{
+        double maxval = av_get_packed_sample_fmt(dstSampleFormat) < AV_SAMPLE_FMT_FLT ? 1.0 : INT_MAX;
+        if(swr_build_matrix(srcLayout,dstLayout,M_SQRT1_2,M_SQRT1_2,0.0,maxval,1.0,
+                            matrix.data(),in,AV_MATRIX_ENCODING_NONE,nullptr) < 0)
+            return false;
+    }
+    result.resize(matrix.size());
+    for(size_t i = 0;i < matrix.size();++i)
+        result[i] = matrix[i] * gain;
+    return true;
+}
+
+uint32_t Converter::_overviewTag() const
+{
+    /*源参数改变后，旧的旁路文件就不能再用了*/
+    return ((uint32_t)srcSampleRate ^ (uint32_t)srcCoding << 19)
+            | ((uint32_t)srcSampleFormat & 0x0F) << 20
+            | ((uint32_t)av_get_channel_layout_nb_channels(srcLayout) & 0xFF) << 24;
+}
+
+bool Converter::_checkpointEnabled() const
+{
+    /*静音裁剪的状态和位置有关，无法从中间继续；分段转换本身就是可以单独重做的小块；
+      相位不精确时预读恢复不了相位累加的误差，续转的结果和不中断时不同*/
+    return checkpoint.isEnabled() && config.checkpointInterval > 0 && !config.trimSilence && !_segmented()
+            && exactPhases();
+}
+
+bool Converter::_segmented() const
+{
+    return config.segmentStart > 0 || config.segmentEnd >= 0;
+}
+
+bool Converter::_segmentRange(int64_t *begin, int64_t *end)
+{
+    int64_t total = sourceFrames();
+    *begin = 0;
+    *end = total;
+    segmentSkip = 0;
+    segmentOutput = -1;
+    segmentTail = true;
+    if(!_segmented())
+        return true;
+    /*段的两端落在两个采样率的公共周期上，段内第一个输出帧和整个文件转换时的相位相同*/
+    int g = gcd(srcSampleRate,dstSampleRate);
+    int64_t inAlign = srcSampleRate / g, outAlign = dstSampleRate / g;
+    if(config.segmentStart < 0 || config.segmentStart >= total || config.segmentStart % inAlign
+            || (config.segmentEnd >= 0 && (config.segmentEnd <= config.segmentStart || config.segmentEnd % inAlign)))
+        return false;
+    /*采样率不同时两端多读一段，滤波器的历史和往后看的输入都和整个文件转换时相同*/
+    int64_t overlap = srcSampleRate != dstSampleRate ? (segmentOverlapFrames + inAlign - 1) / inAlign * inAlign : 0;
+    *begin = std::max<int64_t>(0,config.segmentStart - overlap);
+    *end = config.segmentEnd < 0 ? total : std::min(total,config.segmentEnd + overlap);
+    segmentSkip = (config.segmentStart - *begin) / inAlign * outAlign;
+    segmentTail = *end == total;
+    if(config.segmentEnd >= 0 && config.segmentEnd < total)
+        segmentOutput = (config.segmentEnd - config.segmentStart) / inAlign * outAlign;
+    return true;
+}
+
+uint64_t Converter::_configTag() const
+{
+    /*影响输出内容的参数，任何一个改变后旧的断点都不能再用；FNV-1a*/
+    std::string text = format("%" PRId64 " %d %d %d %" PRId64 " %d %d %d %d %d %d %.17g %d %.17g %.17g",
+                              srcLayout,(int)srcSampleFormat,srcSampleRate,(int)srcCoding,
+                              dstLayout,(int)dstSampleFormat,dstSampleRate,(int)dstCoding,
+                              (int)config.quality,(int)config.backend,(int)config.ditherMethod,config.ditherScale,
+                              (int)config.normalize,config.targetLoudness,config.truePeakCeiling);
+    for(double v : config.matrix)
+        text += format(" %.17g",v);
+    for(auto &output : config.channelMap)
+        for(auto &channel : output)
+            for(auto &term : channel)
+                text += format(" %d:%.17g",term.channel,term.gain);
+    uint64_t hash = 1469598103934665603ULL;
+    for(unsigned char c : text){
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+Checkpoint::State Converter::_checkpointState() const
+{
+    Checkpoint::State state = {};
+    struct stat st;
+    if(stat(srcPath.c_str(),&st) == 0){
+        state.sourceSize = st.st_size;
+        state.sourceTime = st.st_mtime;
+    }
+    state.configTag = _configTag();
+    return state;
+}
+
+bool Converter::_resumeCheckpoint(int64_t *startFrame, int64_t *skipBytes)
+{
+    *startFrame = 0;
+    *skipBytes = 0;
+    if(!_checkpointEnabled())
+        return false;
+    Checkpoint::State state;
+    std::vector<uint8_t> data;
+    if(!checkpoint.load(_checkpointState(),state,data))
+        return false;
+    /*输入和输出位置都要落在两个采样率的公共周期上，输出帧才和不中断时一一对应*/
+    int g = gcd(srcSampleRate,dstSampleRate);
+    int64_t inAlign = srcSampleRate / g, outAlign = dstSampleRate / g;
+    int64_t dstFrameSize = av_get_bytes_per_sample(dstSampleFormat) * av_get_channel_layout_nb_channels(dstLayout);
+    int64_t outFrames = state.outputBytes / dstFrameSize;
+    if(state.outputBytes % dstFrameSize || outFrames % outAlign || state.inputFrames != outFrames / outAlign * inAlign)
+        return false;
+    /*从断点之前预读一段，让滤波器的历史和不中断时相同，预读部分的输出丢掉*/
+    int64_t preroll = std::max<int64_t>(8192,4 * state.delay);
+    preroll = (preroll + inAlign - 1) / inAlign * inAlign;
+    *startFrame = std::max<int64_t>(0,state.inputFrames - preroll);
+    *skipBytes = (outFrames - *startFrame / inAlign * outAlign) * dstFrameSize;
+    dstData.swap(data);
+    resumedFrames = state.inputFrames;
+    _message(format("resume from checkpoint at %.1f s",(double)state.inputFrames / srcSampleRate));
+    return true;
+}
+
+void Converter::_commitCheckpoint(int64_t delay)
+{
+    int g = gcd(srcSampleRate,dstSampleRate);
+    int64_t inAlign = srcSampleRate / g, outAlign = dstSampleRate / g;
+    int64_t dstFrameSize = av_get_bytes_per_sample(dstSampleFormat) * av_get_channel_layout_nb_channels(dstLayout);
+    int64_t frames = (int64_t)dstData.size() / dstFrameSize / outAlign * outAlign;
+    auto state = _checkpointState();
+    state.inputFrames = frames / outAlign * inAlign;
+    state.outputBytes = frames * dstFrameSize;
+    state.delay = delay;
+    if(!checkpoint.commit(state,dstData))
+        _message("checkpoint write error");
+}
+
+bool Converter::save(const std::string &baseName)
+{
+    if(mappedData.size() > 1){
+        bool ok = true;
+        for(int k = 0;k < (int)mappedData.size();++k)
+            ok = _saveData(mappedData[k],av_get_default_channel_layout(mapper.outputChannels(k)),
+                           baseName + format("_%d",k + 1)) && ok;
+        return ok;
+    }
+    return _saveData(dstData,dstLayout,baseName);
+}
+
+bool Converter::writeSegment(AudioWriter &writer, const std::string &path)
+{
+    auto encoded = _encodeDst(dstData);
+    if(!writer.isOpen() && !writer.open(path,_outputFormat(dstLayout)))
+        return false;
+    /*各段的输出长度由段的源帧数决定，位置不用等前面的段完成*/
+    int g = gcd(srcSampleRate,dstSampleRate);
+    int64_t frameBytes = (int64_t)SampleCodec::codedBytes(dstCoding,dstSampleFormat) * av_get_channel_layout_nb_channels(dstLayout);
+    int64_t offset = config.segmentStart / (srcSampleRate / g) * (dstSampleRate / g) * frameBytes;
+    return writer.writeAt(offset,encoded.data(),encoded.size());
+}
+
+WavFormat Converter::_outputFormat(int64_t layout) const
+{
+    /*浮点写格式标签3，多声道或高位深使用WAVE_FORMAT_EXTENSIBLE并带上声道掩码，其它封装按同样的参数写*/
+    auto wavFormat = WavFormat::fromSampleFormat(dstSampleFormat,layout,dstSampleRate);
+    if(dstCoding == SampleCodec::Packed24)
+        wavFormat.bitsPerSample = wavFormat.validBits = 24;
+    return wavFormat;
+}
+
+bool Converter::_saveData(const std::vector<uint8_t> &data, int64_t layout, const std::string &name)
+{
+    auto encoded = _encodeDst(data);
+    auto path = name + "." + AudioContainer::extension(config.container);
+    auto writer = AudioWriter::create(config.container);
+    bool ok = writer->open(path,_outputFormat(layout))
+            && writer->write(encoded.data(),encoded.size());
+    ok = writer->close() && ok;
+    if(ok)
+        _message("write file success");
+    else
+        _message("write file error");
+    return ok;
+}
+
+std::vector<uint8_t> Converter::_encodeDst(const std::vector<uint8_t> &data)
+{
+    if(dstCoding == SampleCodec::Native)
+        return data;
+    auto start = std::chrono::steady_clock::now();
+    int64_t count = data.size() / av_get_bytes_per_sample(dstSampleFormat);
+    std::vector<uint8_t> encoded(count * SampleCodec::codedBytes(dstCoding,dstSampleFormat));
+    uint32_t seed = 0;
+    SampleCodec::encode(dstCoding,dstSampleFormat,data.data(),count,encoded.data(),
+                        config.dither && !exactCopy,&seed);
+    auto ns = elapsedNs(start);
+    _message(format("encode %.1f MB in %.1f ms (%.0f MB/s)",
+                    encoded.size() / 1e6,ns / 1e6,ns > 0 ? encoded.size() * 1e3 / ns : 0.0));
+    return encoded;
+}
+
+void Converter::getProgress(int64_t *done, int64_t *total) const
+{
+    *total = progressTotal.load(std::memory_order_relaxed);
+    *done = progressDone.load(std::memory_order_relaxed);
+}
+
+void Converter::_message(const std::string &msg)
+{
+    if(callbacks.message)
+        callbacks.message(msg);
+}
+
+void Converter::_progress(int64_t done, int64_t total)
+{
+    progressTotal.store(total,std::memory_order_relaxed);
+    progressDone.store(done,std::memory_order_relaxed);
+    if(callbacks.progress)
+        callbacks.progress(done,total);
+}
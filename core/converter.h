@@ -0,0 +1,215 @@
+#ifndef CONVERTER_H
+#define CONVERTER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include "waveformoverview.h"
+#include "audioanalyzer.h"
+#include "loudnessmeter.h"
+#include "silencetrimmer.h"
+#include "channelmapper.h"
+#include "samplecodec.h"
+#include "audioreader.h"
+#include "audiowriter.h"
+#include "resampleroptions.h"
+#include "polyphaseresampler.h"
+#include "streamconverter.h"
+#include "checkpoint.h"
+#include "conversionconfig.h"
+extern "C"{
+#include "libavutil/channel_layout.h"
+#include "libavutil/samplefmt.h"
+#include "libswresample/swresample.h"
+}
+
+/**
+ * @brief 转换引擎，不依赖Qt
+ * 读入源文件，按设置做声道、格式和采样率转换，同时做分析和响度测量，
+ * 结果留在内存中，由save按输出封装写成文件。
+ * 界面、命令行和基准测试共用，调用方通过Callbacks取得消息和进度。
+ * 参数由ConversionConfig一次给定；一个Converter同时只在一个线程里使用，
+ * 只有stop和getProgress可以从其它线程调用
+ */
+class Converter
+{
+public:
+    struct Callbacks{
+        std::function<void(const std::string &msg)> message;
+        std::function<void(int64_t done, int64_t total)> progress;
+        std::function<void()> overviewReady;
+    };
+
+    /**
+     * @brief run的结果，Cancelled时输出不完整，不应该保存
+     */
+    enum Status{
+        Finished = 0,
+        Cancelled,
+        Failed
+    };
+
+public:
+    Converter();
+
+    void setCallbacks(const Callbacks &callbacks);
+    /**
+     * @brief 在open和run之前调用，run期间不能改变；
+     * 同时开始一个新任务，撤销之前的stop
+     */
+    void setConfig(const ConversionConfig &config);
+    const ConversionConfig &getConfig() const;
+
+    /**
+     * @brief 打开源文件，封装格式读出文件头，其它按裸PCM处理
+     * 文件头损坏或不支持时返回false
+     */
+    bool open(const std::string &path);
+    /**
+     * @brief 把源文件的音频数据读入内存，不是Native的编码在这里解码，
+     * 之后源格式为解码后的格式
+     */
+    bool load();
+    /**
+     * @brief 完整的一次转换：读入、分析、转换，结果可以用outputData取得或用save写出
+     * 设置了断点时从上次中断的位置继续，完成后删除断点
+     */
+    Status run();
+    /**
+     * @brief 在其它线程调用，run在处理完当前块后提交断点并返回Cancelled；
+     * 在setConfig之后、run开始之前调用时run直接返回Cancelled
+     */
+    void stop();
+    /**
+     * @brief 可以在其它线程调用，读取当前的进度，单位为源数据字节
+     */
+    void getProgress(int64_t *done,int64_t *total) const;
+    /**
+     * @brief 写出转换结果，baseName不带扩展名，多个输出时加上_1、_2…
+     */
+    bool save(const std::string &baseName);
+    /**
+     * @brief 分段转换时写出这一段：writer没有打开时先按输出格式打开path，再写在这一段对应的位置；
+     * 同一个文件的各段共用writer，调用方保证不会同时写
+     */
+    bool writeSegment(AudioWriter &writer, const std::string &path);
+
+    /**
+     * @brief 读入config.overviewPath里的概览，为空或已过期时返回false
+     */
+    bool loadOverview();
+
+    const AudioReader::Info &sourceInfo() const;
+    bool isRaw() const;
+    /**
+     * @brief 播放用的源参数，封装格式时为文件头里的参数
+     */
+    int sourceRate() const;
+    AVSampleFormat sourceFormat() const;
+    int sourceChannels() const;
+    /**
+     * @brief open之后可用，源文件的帧数
+     */
+    int64_t sourceFrames() const;
+    /**
+     * @brief open之后可用：按当前设置重采样时相位是否精确，
+     * 精确时断点续转和分段转换的输出和一次转换逐位相同，不精确时这两种方式不可用
+     */
+    bool exactPhases() const;
+    const std::vector<uint8_t> &sourceData() const;
+    const std::vector<uint8_t> &outputData() const;
+    const WaveformOverview &getOverview() const;
+    const std::string &report() const;
+
+private:
+    bool _resample();
+    bool _resamplePolyphase();
+    bool _polyphaseUsable(int srcRate,int64_t srcLayout,AVSampleFormat srcFormat) const;
+    bool _passthrough();
+    bool _channelMap();
+    bool _inspectSrc(const uint8_t *data,int frames);
+    bool _inspectDst(const uint8_t *data,int frames);
+    void _emitDst(const uint8_t *data,int frames,int bytes);
+    void _writeDst(const uint8_t *data,int bytes);
+    void _buildReport(int64_t totalTime);
+    bool _loudnessEnabled() const;
+    void _measureLoudness();
+    bool _buildMatrix(double gain,std::vector<double> &result);
+    void _finishOverview();
+    uint32_t _overviewTag() const;
+    void _applySrcInfo();
+    bool _saveData(const std::vector<uint8_t> &data,int64_t layout,const std::string &name);
+    WavFormat _outputFormat(int64_t layout) const;
+    bool _segmented() const;
+    bool _segmentRange(int64_t *begin,int64_t *end);
+    std::vector<uint8_t> _encodeDst(const std::vector<uint8_t> &data);
+    bool _checkpointEnabled() const;
+    uint64_t _configTag() const;
+    Checkpoint::State _checkpointState() const;
+    bool _resumeCheckpoint(int64_t *startFrame,int64_t *skipBytes);
+    void _commitCheckpoint(int64_t delay);
+    void _message(const std::string &msg);
+    void _progress(int64_t done,int64_t total);
+private:
+    Callbacks callbacks;
+    int64_t srcLayout;
+    int64_t dstLayout;
+    AVSampleFormat srcSampleFormat;
+    AVSampleFormat dstSampleFormat;
+    int srcSampleRate;
+    int dstSampleRate;
+    std::string srcPath;
+    /*封装格式的文件头信息，container为Raw时按裸PCM处理*/
+    AudioReader::Info srcInfo;
+    /*文件中样本的存放方式，不是Native时读入后解码，写出前编码*/
+    SampleCodec::Coding srcCoding;
+    SampleCodec::Coding dstCoding;
+    /*输出和源数据的样本逐位相同，此时编码不需要抖动*/
+    bool exactCopy;
+    std::vector<uint8_t> srcData;
+    std::vector<uint8_t> dstData;
+    WaveformOverview overview;
+    std::vector<float> floatBuffer;
+    AudioAnalyzer srcAnalyzer;
+    AudioAnalyzer dstAnalyzer;
+    int64_t analysisTime;
+    LoudnessMeter srcMeter;
+    LoudnessMeter dstMeter;
+    bool loudnessMeasured;
+    double normalizeGain;
+    StreamConverter stream;
+    PolyphaseResampler polyphase;
+    /*多相重采样的输出，按声道分开*/
+    std::vector<float> resampledBuffer;
+    ChannelMapper mapper;
+    std::vector<std::vector<uint8_t>> mappedData;
+    SilenceTrimmer trimmer;
+    std::string lastReport;
+    Checkpoint checkpoint;
+    /*从断点恢复时断点的输入位置*/
+    int64_t resumedFrames;
+    /*分段转换：要丢掉的预读部分的输出帧数，要保留的输出帧数（-1为全部），读入的数据是否到文件结尾*/
+    int64_t segmentSkip;
+    int64_t segmentOutput;
+    bool segmentTail;
+
+    ConversionConfig config;
+    /*stop和getProgress会在其它线程访问*/
+    std::atomic<bool> changeFlag;
+    std::atomic<int64_t> progressDone;
+    std::atomic<int64_t> progressTotal;
+};
+
+inline void Converter::setCallbacks(const Callbacks &callbacks)                 {   this->callbacks = callbacks;}
+inline void Converter::setConfig(const ConversionConfig &config)                {   this->config = config;changeFlag = true;}
+inline const ConversionConfig &Converter::getConfig() const                     {   return config;}
+inline void Converter::stop()                                                   {   changeFlag = false;}
+inline const AudioReader::Info &Converter::sourceInfo() const                   {   return srcInfo;}
+inline bool Converter::isRaw() const                                            {   return srcInfo.container == AudioContainer::Raw;}
+inline const std::vector<uint8_t> &Converter::sourceData() const                {   return srcData;}
+inline const std::vector<uint8_t> &Converter::outputData() const                {   return dstData;}
+inline const WaveformOverview &Converter::getOverview() const                   {   return overview;}
+inline const std::string &Converter::report() const                             {   return lastReport;}
+#endif // CONVERTER_H
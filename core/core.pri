@@ -0,0 +1,17 @@
+# 使用转换引擎的工程include这个文件，链接静态库和ffmpeg
+
+INCLUDEPATH += $$PWD $$PWD/../include
+DEPENDPATH += $$PWD $$PWD/../include
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../core/release/ -lpcm2wavcore
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../core/debug/ -lpcm2wavcore
+else:unix: LIBS += -L$$OUT_PWD/../core/ -lpcm2wavcore
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../core/release/libpcm2wavcore.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../core/debug/libpcm2wavcore.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../core/release/pcm2wavcore.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../core/debug/pcm2wavcore.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/../core/libpcm2wavcore.a
+
+LIBS += -L$$PWD/../lib/ -lavutil-56 \
+        -L$$PWD/../lib/ -lswresample-3
@@ -0,0 +1,65 @@
+#-------------------------------------------------
+#
+# 转换引擎，只依赖C++标准库和ffmpeg
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = pcm2wavcore
+TEMPLATE = lib
+CONFIG += staticlib c++11
+CONFIG -= qt
+
+SOURCES += \
+        audiokernels.cpp \
+        waveformoverview.cpp \
+        audioanalyzer.cpp \
+        loudnessmeter.cpp \
+        silencetrimmer.cpp \
+        formatdetector.cpp \
+        wavheader.cpp \
+        channelmapper.cpp \
+        samplecodec.cpp \
+        audiowriter.cpp \
+        audioreader.cpp \
+        resampleroptions.cpp \
+        swrpool.cpp \
+        polyphaseresampler.cpp \
+        ringbuffer.cpp \
+        recorder.cpp \
+        jobqueue.cpp \
+        taskscheduler.cpp \
+        streamconverter.cpp \
+        checkpoint.cpp \
+        conversionconfig.cpp \
+        conversioncache.cpp \
+        converter.cpp
+
+HEADERS += \
+        audiokernels.h \
+        waveformoverview.h \
+        audioanalyzer.h \
+        loudnessmeter.h \
+        silencetrimmer.h \
+        formatdetector.h \
+        wavheader.h \
+        channelmapper.h \
+        samplecodec.h \
+        audiowriter.h \
+        audioreader.h \
+        resampleroptions.h \
+        swrpool.h \
+        polyphaseresampler.h \
+        ringbuffer.h \
+        recorder.h \
+        jobqueue.h \
+        taskscheduler.h \
+        streamconverter.h \
+        checkpoint.h \
+        conversionconfig.h \
+        conversioncache.h \
+        converter.h
+
+INCLUDEPATH += $$PWD/../include
+DEPENDPATH += $$PWD/../include
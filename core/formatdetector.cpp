@@ -0,0 +1,211 @@
+#include "formatdetector.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+namespace {
+
+/*按候选格式读出第i个样本，整数归一化到[-1,1)*/
+double sampleAt(const uint8_t *p, AVSampleFormat format, bool bigEndian)
+{
+    uint8_t b[8];
+    int size = av_get_bytes_per_sample(format);
+    if(bigEndian){
+        for(int i = 0; i < size; ++i)
+            b[i] = p[size - 1 - i];
+    }
+    else
+        memcpy(b, p, size);
+    switch(format){
+    case AV_SAMPLE_FMT_U8:
+        return (b[0] - 128) / 128.0;
+    case AV_SAMPLE_FMT_S16:{
+        int16_t v;
+        memcpy(&v, b, 2);
+        return v / 32768.0;
+    }
+    case AV_SAMPLE_FMT_S32:{
+        int32_t v;
+        memcpy(&v, b, 4);
+        return v / 2147483648.0;
+    }
+    case AV_SAMPLE_FMT_FLT:{
+        float v;
+        memcpy(&v, b, 4);
+        return v;
+    }
+    case AV_SAMPLE_FMT_DBL:{
+        double v;
+        memcpy(&v, b, 8);
+        return v;
+    }
+    default:
+        return 0;
+    }
+}
+
+/*真实的浮点音频基本都在±16以内，并且不会出现大量极小的非零值*/
+bool plausibleFloat(double v)
+{
+    double a = fabs(v);
+    return v == v && a <= 16.0 && (a == 0 || a >= 1e-20);
+}
+
+}
+
+FormatDetector::FormatDetector()
+{
+}
+
+void FormatDetector::clear()
+{
+    blocks.clear();
+}
+
+void FormatDetector::addBlock(const uint8_t *data, int size)
+{
+    /*截成16字节的整数倍，所有候选格式都能整帧解释*/
+    size -= size % 16;
+    if(size > 0)
+        blocks.emplace_back(data, data + size);
+}
+
+std::vector<FormatDetector::Guess> FormatDetector::rank() const
+{
+    static const AVSampleFormat formats[] = {
+        AV_SAMPLE_FMT_U8, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_DBL
+    };
+    std::vector<Guess> guesses;
+    for(auto format : formats){
+        for(int endian = 0; endian < (format == AV_SAMPLE_FMT_U8 ? 1 : 2); ++endian){
+            for(int channels = 1; channels <= 2; ++channels){
+                Guess g;
+                g.format = format;
+                g.bigEndian = endian == 1;
+                g.channels = channels;
+                g.score = _score(format, g.bigEndian, channels);
+                guesses.push_back(g);
+            }
+        }
+    }
+    std::stable_sort(guesses.begin(), guesses.end(), [](const Guess &a, const Guess &b){
+        return a.score > b.score;
+    });
+    return guesses;
+}
+
+std::string FormatDetector::describe(const Guess &guess)
+{
+    std::string text = av_get_sample_fmt_name(guess.format);
+    if(guess.format != AV_SAMPLE_FMT_U8)
+        text += guess.bigEndian ? "be" : "le";
+    text += guess.channels == 1 ? " mono" : " stereo";
+    char score[32];
+    snprintf(score, sizeof(score), " (%.3f)", guess.score);
+    return text + score;
+}
+
+double FormatDetector::_score(AVSampleFormat format, bool bigEndian, int channels) const
+{
+    int size = av_get_bytes_per_sample(format);
+    bool isFloat = format == AV_SAMPLE_FMT_FLT || format == AV_SAMPLE_FMT_DBL;
+    double total = 0, weight = 0;
+    int64_t samples = 0, valid = 0, frames = 0, equal = 0;
+    double evenDiff = 0, oddDiff = 0;
+    std::vector<double> x;
+    for(const auto &block : blocks){
+        int n = (int)block.size() / size;
+        x.resize(n);
+        for(int i = 0; i < n; ++i){
+            x[i] = sampleAt(block.data() + i * size, format, bigEndian);
+            if(isFloat){
+                if(plausibleFloat(x[i]))
+                    ++valid;
+                else
+                    x[i] = 0;
+            }
+        }
+        samples += n;
+        for(int i = 1; i < n && channels == 1; ++i){
+            double d = x[i] - x[i - 1];
+            if(i & 1)
+                oddDiff += d * d;
+            else
+                evenDiff += d * d;
+        }
+        for(int i = 0; i + 1 < n && channels == 2; i += 2){
+            if(memcmp(block.data() + i * size, block.data() + (i + 1) * size, size) == 0)
+                ++equal;
+            ++frames;
+        }
+
+        /*每个声道相邻帧的滞后1自相关，全静音的块不参与打分*/
+        for(int c = 0; c < channels; ++c){
+            double sum = 0, sq = 0, lag = 0;
+            int m = 0;
+            for(int i = c; i < n; i += channels, ++m){
+                sum += x[i];
+                sq += x[i] * x[i];
+                if(i >= channels)
+                    lag += x[i] * x[i - channels];
+            }
+            if(m < 2)
+                continue;
+            double mean = sum / m;
+            double var = sq / m - mean * mean;
+            if(var <= 1e-12)
+                continue;
+            double cov = lag / (m - 1) - mean * mean;
+            total += std::max(-1.0, std::min(1.0, cov / var));
+            weight += 1;
+        }
+    }
+    if(weight == 0)
+        return 0;
+    double score = total / weight;
+    if(isFloat)
+        score *= pow((double)valid / std::max<int64_t>(samples, 1), 4);
+    /*
+     * 双声道数据按单声道读时，奇偶位置的差分分别是"声道间"和"帧间"的变化，
+     * 统计上明显不同；真正的单声道两者一致
+     */
+    if(channels == 1 && evenDiff + oddDiff > 0){
+        double asym = fabs(evenDiff - oddDiff) / (evenDiff + oddDiff);
+        if(asym > 0.2)
+            score -= asym * 0.5;
+    }
+    /*两个声道逐个样本完全相同，单声道数据几乎不可能出现*/
+    if(channels == 2 && frames > 0 && equal > frames * 9 / 10)
+        score += 0.05;
+    /*
+     * 把16位双声道当作32位读时，高半字仍然是平滑的音频，分数会和正确解释接近；
+     * 这种情况下低半字同样平滑，而真实32位数据的低半字接近噪声，据此降低分数
+     */
+    if(format == AV_SAMPLE_FMT_S32){
+        double low = 0, lowWeight = 0;
+        for(const auto &block : blocks){
+            int n = (int)block.size() / 4;
+            double sum = 0, sq = 0, lag = 0, prev = 0;
+            for(int i = 0; i < n; ++i){
+                const uint8_t *p = block.data() + i * 4 + (bigEndian ? 2 : 0);
+                int16_t v = bigEndian ? (int16_t)(p[0] << 8 | p[1]) : (int16_t)(p[1] << 8 | p[0]);
+                double d = v / 32768.0;
+                sum += d;
+                sq += d * d;
+                if(i > 0)
+                    lag += d * prev;
+                prev = d;
+            }
+            if(n < 2)
+                continue;
+            double mean = sum / n, var = sq / n - mean * mean;
+            if(var <= 1e-12)
+                continue;
+            low += (lag / (n - 1) - mean * mean) / var;
+            lowWeight += 1;
+        }
+        if(lowWeight > 0 && low / lowWeight > 0.3)
+            score -= 0.5 * (low / lowWeight);
+    }
+    return score;
+}
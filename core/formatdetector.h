@@ -0,0 +1,47 @@
+#ifndef FORMATDETECTOR_H
+#define FORMATDETECTOR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+extern "C"{
+#include "libavutil/samplefmt.h"
+}
+
+/**
+ * @brief 裸PCM参数的启发式检测
+ * 从文件中取几块数据，按每种候选格式（U8/S16/S32/FLT/DBL、大小端、单/双声道）解释，
+ * 用相邻样本的相关性（真实音频是平滑的，解释错误时接近噪声）、声道间关系
+ * 和浮点数是否合理来打分，返回按分数从高到低排好的候选。采样率无法从数据中判断
+ */
+class FormatDetector
+{
+public:
+    struct Guess{
+        AVSampleFormat format;
+        bool bigEndian;
+        int channels;
+        double score;
+    };
+
+public:
+    FormatDetector();
+
+    void clear();
+    /**
+     * @brief 加入一块数据，块的起始位置需要和样本边界对齐（取16字节的倍数即可）
+     */
+    void addBlock(const uint8_t *data, int size);
+    int blockCount() const;
+
+    std::vector<Guess> rank() const;
+    static std::string describe(const Guess &guess);
+
+private:
+    double _score(AVSampleFormat format, bool bigEndian, int channels) const;
+private:
+    std::vector<std::vector<uint8_t>> blocks;
+};
+
+inline int FormatDetector::blockCount() const                                   {   return (int)blocks.size();}
+#endif // FORMATDETECTOR_H
@@ -0,0 +1,105 @@
+#include "jobqueue.h"
+#include <algorithm>
+
+JobQueue::JobQueue(int workers) :
+    nextId(1),
+    active(0),
+    stopping(false)
+{
+    if(workers <= 0)
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    for(int i = 0; i < workers; ++i)
+        threads.emplace_back(&JobQueue::_run, this, i);
+}
+
+JobQueue::~JobQueue()
+{
+    stop();
+}
+
+int64_t JobQueue::submit(int priority, const Task &task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(stopping)
+        return -1;
+    int64_t id = nextId++;
+    queue[{-priority, id}] = task;
+    wake.notify_one();
+    return id;
+}
+
+bool JobQueue::cancel(int64_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for(auto it = queue.begin(); it != queue.end(); ++it){
+        if(it->first.second == id){
+            queue.erase(it);
+            if(queue.empty() && active == 0)
+                idle.notify_all();
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobQueue::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this](){ return queue.empty() && active == 0;});
+}
+
+void JobQueue::stop()
+{
+    std::map<std::pair<int, int64_t>, Task> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(stopping && threads.empty())
+            return;
+        stopping = true;
+        dropped.swap(queue);
+        wake.notify_all();
+    }
+    /*在锁外通知，任务里可以安全地做网络或文件操作*/
+    for(auto &job : dropped)
+        job.second(-1);
+    for(auto &thread : threads)
+        thread.join();
+    threads.clear();
+}
+
+int JobQueue::ahead(int priority)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return (int)std::distance(queue.begin(), queue.upper_bound({-priority, nextId}));
+}
+
+int JobQueue::pending()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return (int)queue.size();
+}
+
+int JobQueue::running()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return active;
+}
+
+void JobQueue::_run(int worker)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for(;;){
+        wake.wait(lock, [this](){ return stopping || !queue.empty();});
+        if(queue.empty())
+            return;
+        auto task = std::move(queue.begin()->second);
+        queue.erase(queue.begin());
+        ++active;
+        lock.unlock();
+        task(worker);
+        lock.lock();
+        --active;
+        if(queue.empty() && active == 0)
+            idle.notify_all();
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef JOBQUEUE_H
+#define JOBQUEUE_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 带优先级的任务队列和固定数量的工作线程
+ * 优先级高的先执行，相同优先级按提交顺序。任务收到执行它的工作线程序号，
+ * 调用方可以按序号为每个线程保留Converter等对象，在任务之间复用缓冲
+ */
+class JobQueue
+{
+public:
+    /**
+     * @brief worker为工作线程序号；stop时还没开始的任务以-1调用一次，用来通知提交方
+     */
+    typedef std::function<void(int worker)> Task;
+
+public:
+    /**
+     * @brief workers为0时取硬件线程数
+     */
+    explicit JobQueue(int workers = 0);
+    ~JobQueue();
+
+    /**
+     * @brief 返回任务编号，队列已停止时返回-1
+     */
+    int64_t submit(int priority, const Task &task);
+    /**
+     * @brief 取消还没开始的任务，任务不会被调用
+     */
+    bool cancel(int64_t id);
+    /**
+     * @brief 等待已提交的任务全部完成
+     */
+    void wait();
+    /**
+     * @brief 不再接受任务，通知还没开始的任务，等待正在执行的任务结束
+     */
+    void stop();
+
+    int workers() const;
+    /**
+     * @brief 现在以priority提交时，排在它前面、还没开始的任务数
+     */
+    int ahead(int priority);
+    int pending();
+    int running();
+
+private:
+    void _run(int worker);
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    /*按(-priority, id)排序，第一个就是下一个要执行的任务*/
+    std::map<std::pair<int, int64_t>, Task> queue;
+    int64_t nextId;
+    int active;
+    bool stopping;
+};
+
+inline int JobQueue::workers() const                                            {   return (int)threads.size();}
+#endif // JOBQUEUE_H
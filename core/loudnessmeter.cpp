@@ -0,0 +1,287 @@
+#include "loudnessmeter.h"
+#include <math.h>
+#include <algorithm>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LOUDNESSMETER_SSE2
+#endif
+extern "C"{
+#include "libavutil/channel_layout.h"
+}
+
+namespace {
+const double absoluteGate = -70.0;
+const double relativeGate = -10.0;
+
+double energyToLoudness(double energy)
+{
+    return energy > 0 ? -0.691 + 10 * log10(energy) : -INFINITY;
+}
+
+double loudnessToEnergy(double lufs)
+{
+    return pow(10.0, (lufs + 0.691) / 10);
+}
+
+/*第一类零阶修正贝塞尔函数，Kaiser窗用*/
+double besselI0(double x)
+{
+    double sum = 1, term = 1;
+    for(int k = 1; k < 50; ++k){
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if(term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+}
+
+LoudnessMeter::LoudnessMeter(int channels, int rate, uint64_t layout)
+{
+    reset(channels, rate, layout);
+}
+
+void LoudnessMeter::reset(int channels, int rate, uint64_t layout)
+{
+    nbChannels = std::max(channels, 1);
+    sampleRate = std::max(rate, 1);
+    totalFrames = 0;
+    state.assign(nbChannels, ChannelState());
+
+    /*按声道在layout中的顺序确定权重*/
+    int c = 0;
+    for(int bit = 0; bit < 64 && c < nbChannels && layout != 0; ++bit){
+        uint64_t ch = 1ULL << bit;
+        if(!(layout & ch))
+            continue;
+        double w = 1.0;
+        if(ch == AV_CH_LOW_FREQUENCY || ch == AV_CH_LOW_FREQUENCY_2)
+            w = 0.0;
+        else if(ch == AV_CH_SIDE_LEFT || ch == AV_CH_SIDE_RIGHT
+                || ch == AV_CH_BACK_LEFT || ch == AV_CH_BACK_RIGHT)
+            w = 1.41;
+        state[c++].weight = w;
+    }
+    for(; c < nbChannels; ++c)
+        state[c].weight = 1.0;
+
+    subBlockFrames = std::max(sampleRate / 10, 1);
+    pendingFrames = 0;
+    pendingEnergy = 0;
+    subBlockCount = 0;
+    blocks.clear();
+    _designFilters();
+    _designOversampler();
+    for(auto &s : state){
+        s.z1[0] = s.z1[1] = s.z2[0] = s.z2[1] = 0;
+        s.history.assign(phaseTaps - 1, 0.0f);
+        s.samplePeak = 0;
+        s.truePeak = 0;
+    }
+}
+
+void LoudnessMeter::addBlock(const float *planar, int frames)
+{
+    int offset = 0;
+    while(offset < frames){
+        int n = std::min(frames - offset, subBlockFrames - pendingFrames);
+        for(int c = 0; c < nbChannels; ++c){
+            const float *src = planar + (int64_t)c * frames + offset;
+            double sq = _filterSegment(state[c], src, n);
+            pendingEnergy += state[c].weight * sq;
+            _truePeakSegment(state[c], src, n);
+        }
+        pendingFrames += n;
+        offset += n;
+        if(pendingFrames == subBlockFrames)
+            _pushSubBlock();
+    }
+    totalFrames += frames;
+}
+
+double LoudnessMeter::integrated() const
+{
+    double absThreshold = loudnessToEnergy(absoluteGate);
+    double sum = 0;
+    int64_t n = 0;
+    for(double e : blocks){
+        if(e > absThreshold){
+            sum += e;
+            ++n;
+        }
+    }
+    if(n == 0)
+        return -INFINITY;
+    double relThreshold = sum / n * pow(10.0, relativeGate / 10);
+    double gated = 0;
+    int64_t m = 0;
+    for(double e : blocks){
+        if(e > absThreshold && e > relThreshold){
+            gated += e;
+            ++m;
+        }
+    }
+    return m > 0 ? energyToLoudness(gated / m) : -INFINITY;
+}
+
+double LoudnessMeter::truePeak() const
+{
+    float peak = 0;
+    for(const auto &s : state)
+        peak = std::max(peak, std::max(s.truePeak, s.samplePeak));
+    return peak > 0 ? 20 * log10(peak) : -INFINITY;
+}
+
+double LoudnessMeter::samplePeak() const
+{
+    float peak = 0;
+    for(const auto &s : state)
+        peak = std::max(peak, s.samplePeak);
+    return peak > 0 ? 20 * log10(peak) : -INFINITY;
+}
+
+void LoudnessMeter::_designFilters()
+{
+    /*BS.1770的两级K加权滤波器，按实际采样率重新计算系数（与libebur128相同的方法）*/
+    double f0 = 1681.974450955533;
+    double G = 3.999843853973347;
+    double Q = 0.7071752369554196;
+    double K = tan(M_PI * f0 / sampleRate);
+    double Vh = pow(10.0, G / 20);
+    double Vb = pow(Vh, 0.4996667741545416);
+    double a0 = 1 + K / Q + K * K;
+    stage[0].b0 = (Vh + Vb * K / Q + K * K) / a0;
+    stage[0].b1 = 2 * (K * K - Vh) / a0;
+    stage[0].b2 = (Vh - Vb * K / Q + K * K) / a0;
+    stage[0].a1 = 2 * (K * K - 1) / a0;
+    stage[0].a2 = (1 - K / Q + K * K) / a0;
+
+    f0 = 38.13547087602444;
+    Q = 0.5003270373238773;
+    K = tan(M_PI * f0 / sampleRate);
+    a0 = 1 + K / Q + K * K;
+    stage[1].b0 = 1.0;
+    stage[1].b1 = -2.0;
+    stage[1].b2 = 1.0;
+    stage[1].a1 = 2 * (K * K - 1) / a0;
+    stage[1].a2 = (1 - K / Q + K * K) / a0;
+}
+
+void LoudnessMeter::_designOversampler()
+{
+    if(sampleRate < 96000)
+        oversample = 4;
+    else if(sampleRate < 192000)
+        oversample = 2;
+    else
+        oversample = 1;
+    phaseTaps = oversample > 1 ? 12 : 1;
+    int length = oversample * phaseTaps;
+    phaseCoeffs.assign(length, 0.0f);
+    if(oversample == 1){
+        phaseCoeffs[0] = 1.0f;
+        return;
+    }
+    /*Kaiser窗sinc低通，按抽头重排成 tap * oversample + phase，
+      同一个抽头的各相位系数相邻，可以一次算出全部相位；每个相位单独归一化*/
+    const double beta = 8.0;
+    double center = (length - 1) / 2.0;
+    std::vector<double> h(length);
+    for(int i = 0; i < length; ++i){
+        double x = (i - center) / oversample;
+        double sinc = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+        double r = (i - center) / (center + 0.5);
+        double w = besselI0(beta * sqrt(std::max(0.0, 1 - r * r))) / besselI0(beta);
+        h[i] = sinc * w;
+    }
+    for(int p = 0; p < oversample; ++p){
+        double sum = 0;
+        for(int t = 0; t < phaseTaps; ++t)
+            sum += h[p + t * oversample];
+        for(int t = 0; t < phaseTaps; ++t)
+            phaseCoeffs[t * oversample + p] = (float)(h[p + t * oversample] / sum);
+    }
+}
+
+double LoudnessMeter::_filterSegment(ChannelState &s, const float *src, int count)
+{
+    if(s.weight == 0.0)
+        return 0;
+    const Biquad &f1 = stage[0];
+    const Biquad &f2 = stage[1];
+    double a1 = s.z1[0], a2 = s.z1[1];
+    double b1 = s.z2[0], b2 = s.z2[1];
+    double sq = 0;
+    for(int i = 0; i < count; ++i){
+        double x = src[i];
+        double y = f1.b0 * x + a1;
+        a1 = f1.b1 * x - f1.a1 * y + a2;
+        a2 = f1.b2 * x - f1.a2 * y;
+        double z = f2.b0 * y + b1;
+        b1 = f2.b1 * y - f2.a1 * z + b2;
+        b2 = f2.b2 * y - f2.a2 * z;
+        sq += z * z;
+    }
+    s.z1[0] = a1;
+    s.z1[1] = a2;
+    s.z2[0] = b1;
+    s.z2[1] = b2;
+    return sq;
+}
+
+void LoudnessMeter::_truePeakSegment(ChannelState &s, const float *src, int count)
+{
+    float peak = s.samplePeak;
+    for(int i = 0; i < count; ++i)
+        peak = std::max(peak, fabsf(src[i]));
+    s.samplePeak = peak;
+    if(oversample == 1)
+        return;
+
+    /*历史样本和本段拼成连续数组，内层循环是定长的点积，便于向量化*/
+    int history = phaseTaps - 1;
+    scratch.resize(history + count);
+    std::copy(s.history.begin(), s.history.end(), scratch.begin());
+    std::copy(src, src + count, scratch.begin() + history);
+    float tp = s.truePeak;
+    const float *coeffs = phaseCoeffs.data();
+    int i = 0;
+#ifdef LOUDNESSMETER_SSE2
+    if(oversample == 4){
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        __m128 vpeak = _mm_set1_ps(tp);
+        for(; i < count; ++i){
+            const float *x = scratch.data() + i + phaseTaps - 1;
+            __m128 acc = _mm_setzero_ps();
+            for(int t = 0; t < phaseTaps; ++t)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(coeffs + t * 4), _mm_set1_ps(x[-t])));
+            vpeak = _mm_max_ps(vpeak, _mm_and_ps(acc, absMask));
+        }
+        float peaks[4];
+        _mm_storeu_ps(peaks, vpeak);
+        tp = std::max(std::max(peaks[0], peaks[1]), std::max(peaks[2], peaks[3]));
+    }
+#endif
+    for(; i < count; ++i){
+        const float *x = scratch.data() + i + phaseTaps - 1;
+        for(int p = 0; p < oversample; ++p){
+            float acc = 0;
+            for(int t = 0; t < phaseTaps; ++t)
+                acc += coeffs[t * oversample + p] * x[-t];
+            tp = std::max(tp, fabsf(acc));
+        }
+    }
+    s.truePeak = tp;
+    std::copy(scratch.end() - history, scratch.end(), s.history.begin());
+}
+
+void LoudnessMeter::_pushSubBlock()
+{
+    subBlocks[subBlockCount % 4] = pendingEnergy / subBlockFrames;
+    ++subBlockCount;
+    pendingEnergy = 0;
+    pendingFrames = 0;
+    if(subBlockCount >= 4)
+        blocks.push_back((subBlocks[0] + subBlocks[1] + subBlocks[2] + subBlocks[3]) / 4);
+}
@@ -0,0 +1,79 @@
+#ifndef LOUDNESSMETER_H
+#define LOUDNESSMETER_H
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief ITU-R BS.1770-4 / EBU R128 响度测量
+ * K加权滤波后按400ms块（75%重叠）计算能量，经过-70LUFS绝对门限
+ * 和-10LU相对门限得到综合响度；真峰值通过4倍（高采样率时2倍）
+ * 多相插值得到。输入为按声道分开的float数据，可以分块流式送入
+ */
+class LoudnessMeter
+{
+public:
+    explicit LoudnessMeter(int channels = 2, int rate = 48000, uint64_t layout = 0);
+
+    /**
+     * @brief layout用来确定声道权重（LFE为0，环绕声道为1.41），为0时全部按1处理
+     */
+    void reset(int channels, int rate, uint64_t layout);
+    void addBlock(const float *planar, int frames);
+
+    int channels() const;
+    int64_t frames() const;
+    /**
+     * @brief 综合响度，单位LUFS，数据不足400ms时为-inf
+     */
+    double integrated() const;
+    /**
+     * @brief 真峰值，单位dBTP
+     */
+    double truePeak() const;
+    double samplePeak() const;
+
+private:
+    struct Biquad{
+        double b0, b1, b2, a1, a2;
+    };
+    struct ChannelState{
+        double weight;
+        /*两级K加权滤波器的状态，直接II型转置结构*/
+        double z1[2];
+        double z2[2];
+        /*真峰值插值用的历史样本*/
+        std::vector<float> history;
+        float samplePeak;
+        float truePeak;
+    };
+
+    void _designFilters();
+    void _designOversampler();
+    double _filterSegment(ChannelState &state, const float *src, int count);
+    void _truePeakSegment(ChannelState &state, const float *src, int count);
+    void _pushSubBlock();
+private:
+    int nbChannels;
+    int sampleRate;
+    int64_t totalFrames;
+    Biquad stage[2];
+    std::vector<ChannelState> state;
+
+    int subBlockFrames;
+    int pendingFrames;
+    double pendingEnergy;
+    /*最近4个100ms子块的加权能量，组成一个400ms门限块*/
+    double subBlocks[4];
+    int64_t subBlockCount;
+    std::vector<double> blocks;
+
+    int oversample;
+    int phaseTaps;
+    std::vector<float> phaseCoeffs;
+    std::vector<float> scratch;
+};
+
+inline int LoudnessMeter::channels() const                                      {   return nbChannels;}
+inline int64_t LoudnessMeter::frames() const                                    {   return totalFrames;}
+#endif // LOUDNESSMETER_H
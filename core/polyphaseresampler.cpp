@@ -0,0 +1,414 @@
+#include "polyphaseresampler.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#include <immintrin.h>
+#define POLYPHASE_SSE2
+#endif
+#if defined(POLYPHASE_SSE2) && defined(__GNUC__)
+#define POLYPHASE_AVX __attribute__((target("avx")))
+#elif defined(POLYPHASE_SSE2) && defined(_MSC_VER)
+#include <intrin.h>
+#define POLYPHASE_AVX
+#endif
+
+class PolyphaseResampler::Engine
+{
+public:
+    virtual ~Engine() {}
+    virtual int ratioL() const = 0;
+    virtual int ratioM() const = 0;
+    virtual int taps() const = 0;
+    virtual int process(const float *in, int frames, float *out, int outStride) = 0;
+    virtual int flush(float *out, int outStride) = 0;
+    virtual bool setPath(PolyphaseResampler::Path path) = 0;
+};
+
+namespace {
+
+/*AVX除了CPU支持，还要求系统保存ymm寄存器，运行时检查一次*/
+bool hasAvx()
+{
+#if defined(POLYPHASE_AVX) && defined(__GNUC__)
+    static const bool supported = __builtin_cpu_supports("avx");
+    return supported;
+#elif defined(POLYPHASE_AVX)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+    return false;
+#endif
+}
+
+double besselI0(double x)
+{
+    double sum = 1, term = 1;
+    for(int k = 1; k < 50; ++k){
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if(term < 1e-12 * sum)
+            break;
+    }
+    return sum;
+}
+
+/*
+ * 原型低通滤波器工作在L倍的采样率上，截止频率为输入和输出中较低的奈奎斯特频率的95%，
+ * 长度为L * taps，中心取整数位置，分成L相，每相的系数倒序存放以便和输入顺序相乘
+ */
+void designFilter(int L, int M, int taps, float *coef)
+{
+    const double beta = 9.0;
+    int length = L * taps;
+    int center = (length - 1) / 2;
+    double cutoff = 0.95 / std::max(L, M);
+    std::vector<double> h(length, 0.0);
+    for(int i = 0; i <= 2 * center && i < length; ++i){
+        double x = i - center;
+        double sinc = x == 0 ? 1.0 : sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+        double r = x / (center + 1);
+        double window = besselI0(beta * sqrt(std::max(0.0, 1 - r * r))) / besselI0(beta);
+        h[i] = cutoff * sinc * window * L;
+    }
+    for(int p = 0; p < L; ++p){
+        for(int j = 0; j < taps; ++j)
+            coef[(size_t)p * taps + j] = (float)h[p + (taps - 1 - j) * L];
+    }
+}
+
+/*
+ * 点积按16路累加：第k路累加下标为k (mod 16)的乘积，之后依次合并
+ * k与k + 8、k与k + 4、k与k + 2，最后两路相加。
+ * AVX的两个256位累加器、SSE的四个128位累加器都正好是这个顺序，
+ * 标量实现也照做，三者的结果逐位相同
+ */
+template<int Taps>
+float dotReference(const float *x, const float *c)
+{
+    float lane[16] = {0};
+    for(int j = 0; j < Taps; j += 16){
+        for(int k = 0; k < 16; ++k)
+            lane[k] += x[j + k] * c[j + k];
+    }
+    for(int k = 0; k < 8; ++k)
+        lane[k] += lane[k + 8];
+    for(int k = 0; k < 4; ++k)
+        lane[k] += lane[k + 4];
+    return (lane[0] + lane[2]) + (lane[1] + lane[3]);
+}
+
+/*
+ * 一次处理Channels个声道：相位和窗口位置相同，系数只读一次，
+ * 每个声道的运算顺序不变，所以结果与逐个声道处理相同
+ */
+template<int L, int M, int Taps, int Channels>
+void runReference(const float *const *h, const float *coef, int pos, int phase, int n, float *const *out)
+{
+    for(int i = 0; i < n; ++i){
+        for(int ch = 0; ch < Channels; ++ch)
+            out[ch][i] = dotReference<Taps>(h[ch] + pos, coef + (size_t)phase * Taps);
+        phase += M;
+        pos += phase / L;
+        phase %= L;
+    }
+}
+
+#ifdef POLYPHASE_SSE2
+inline float horizontalSum(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+template<int L, int M, int Taps, int Channels>
+void runSse2(const float *const *h, const float *coef, int pos, int phase, int n, float *const *out)
+{
+    for(int i = 0; i < n; ++i){
+        const float *c = coef + (size_t)phase * Taps;
+        __m128 a[Channels][4];
+        for(int ch = 0; ch < Channels; ++ch){
+            for(int k = 0; k < 4; ++k)
+                a[ch][k] = _mm_setzero_ps();
+        }
+        for(int j = 0; j < Taps; j += 16){
+            for(int k = 0; k < 4; ++k){
+                __m128 ck = _mm_load_ps(c + j + 4 * k);
+                for(int ch = 0; ch < Channels; ++ch)
+                    a[ch][k] = _mm_add_ps(a[ch][k], _mm_mul_ps(_mm_loadu_ps(h[ch] + pos + j + 4 * k), ck));
+            }
+        }
+        for(int ch = 0; ch < Channels; ++ch)
+            out[ch][i] = horizontalSum(_mm_add_ps(_mm_add_ps(a[ch][0], a[ch][2]), _mm_add_ps(a[ch][1], a[ch][3])));
+        phase += M;
+        pos += phase / L;
+        phase %= L;
+    }
+}
+#endif
+
+#ifdef POLYPHASE_AVX
+template<int L, int M, int Taps, int Channels>
+POLYPHASE_AVX void runAvx(const float *const *h, const float *coef, int pos, int phase, int n, float *const *out)
+{
+    for(int i = 0; i < n; ++i){
+        const float *c = coef + (size_t)phase * Taps;
+        __m256 a[Channels], b[Channels];
+        for(int ch = 0; ch < Channels; ++ch)
+            a[ch] = b[ch] = _mm256_setzero_ps();
+        for(int j = 0; j < Taps; j += 16){
+            __m256 c0 = _mm256_load_ps(c + j), c1 = _mm256_load_ps(c + j + 8);
+            for(int ch = 0; ch < Channels; ++ch){
+                const float *x = h[ch] + pos + j;
+                a[ch] = _mm256_add_ps(a[ch], _mm256_mul_ps(_mm256_loadu_ps(x), c0));
+                b[ch] = _mm256_add_ps(b[ch], _mm256_mul_ps(_mm256_loadu_ps(x + 8), c1));
+            }
+        }
+        for(int ch = 0; ch < Channels; ++ch){
+            __m256 s = _mm256_add_ps(a[ch], b[ch]);
+            __m128 v = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+            v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+            v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+            out[ch][i] = _mm_cvtss_f32(v);
+        }
+        phase += M;
+        pos += phase / L;
+        phase %= L;
+    }
+    _mm256_zeroupper();
+}
+#endif
+
+template<int L, int M, int Taps>
+class Kernel : public PolyphaseResampler::Engine
+{
+    static_assert(Taps % 16 == 0, "taps must be a multiple of 16");
+public:
+    explicit Kernel(int channels) :
+        nbChannels(channels),
+        coefStore((size_t)L * Taps + 8),
+        history(channels),
+        consumed(0),
+        produced(0)
+    {
+        /*系数按32字节对齐，每相长度是16的倍数，所以每相的起点也对齐*/
+        coef = coefStore.data();
+        while(((uintptr_t)coef & 31) != 0)
+            ++coef;
+        designFilter(L, M, Taps, coef);
+        setPath(PolyphaseResampler::Fastest);
+        /*延迟补偿：第0个输出对应原型滤波器的中心*/
+        int center = (L * Taps - 1) / 2;
+        phase = center % L;
+        cursor = Taps - 1 + center / L;
+        for(auto &h : history)
+            h.assign(Taps - 1, 0.0f);
+        avail = Taps - 1;
+    }
+
+    int ratioL() const override { return L; }
+    int ratioM() const override { return M; }
+    int taps() const override { return Taps; }
+
+    bool setPath(PolyphaseResampler::Path path) override
+    {
+#ifdef POLYPHASE_AVX
+        if((path == PolyphaseResampler::Fastest || path == PolyphaseResampler::Avx) && hasAvx()){
+            run1 = runAvx<L, M, Taps, 1>;
+            run2 = runAvx<L, M, Taps, 2>;
+            return true;
+        }
+#endif
+        if(path == PolyphaseResampler::Avx)
+            return false;
+#ifdef POLYPHASE_SSE2
+        if(path != PolyphaseResampler::Reference){
+            run1 = runSse2<L, M, Taps, 1>;
+            run2 = runSse2<L, M, Taps, 2>;
+            return true;
+        }
+#endif
+        if(path == PolyphaseResampler::Sse2)
+            return false;
+        run1 = runReference<L, M, Taps, 1>;
+        run2 = runReference<L, M, Taps, 2>;
+        return true;
+    }
+
+    int process(const float *in, int frames, float *out, int outStride) override
+    {
+        consumed += frames;
+        return _run(in, frames, out, outStride);
+    }
+
+    int flush(float *out, int outStride) override
+    {
+        int64_t need = (consumed * L + M - 1) / M - produced;
+        if(need <= 0)
+            return 0;
+        /*用0把剩下的输出推出来，最多需要半个滤波器长度的输入*/
+        int zeros = (int)((need * M) / L) + Taps;
+        std::vector<float> pad((size_t)zeros * nbChannels, 0.0f);
+        return _run(pad.data(), zeros, out, outStride, (int)need);
+    }
+
+private:
+    int _run(const float *in, int frames, float *out, int outStride, int limit = -1)
+    {
+        for(int c = 0; c < nbChannels; ++c){
+            auto &h = history[c];
+            h.resize(avail + frames);
+            memcpy(h.data() + avail, in + (size_t)c * frames, frames * sizeof(float));
+        }
+        int total = avail + frames;
+        /*
+         * 第k个输出的窗口末尾在cursor + (phase + k * M) / L，
+         * 小于total的输出都可以在本块算出
+         */
+        int64_t n = ((int64_t)(total - cursor) * L - phase + M - 1) / M;
+        n = std::max<int64_t>(n, 0);
+        if(limit >= 0)
+            n = std::min<int64_t>(n, limit);
+        int start = (int)cursor - (Taps - 1);
+        /*声道两两一组，单数的最后一个声道单独处理*/
+        int c = 0;
+        for(; c + 2 <= nbChannels; c += 2){
+            const float *h[2] = {history[c].data(), history[c + 1].data()};
+            float *o[2] = {out + (size_t)c * outStride, out + (size_t)(c + 1) * outStride};
+            run2(h, coef, start, phase, (int)n, o);
+        }
+        if(c < nbChannels){
+            const float *h[1] = {history[c].data()};
+            float *o[1] = {out + (size_t)c * outStride};
+            run1(h, coef, start, phase, (int)n, o);
+        }
+        int64_t t = phase + n * M;
+        int64_t pos = cursor + t / L;
+        /*只保留下一个输出需要的Taps - 1个历史样本*/
+        int64_t keepFrom = std::min<int64_t>(pos - (Taps - 1), total);
+        for(auto &h : history)
+            h.erase(h.begin(), h.begin() + keepFrom);
+        avail = (int)(total - keepFrom);
+        cursor = pos - keepFrom;
+        phase = (int)(t % L);
+        produced += n;
+        return (int)n;
+    }
+
+    int nbChannels;
+    std::vector<float> coefStore;
+    float *coef;
+    std::vector<std::vector<float>> history;
+    typedef void (*Run)(const float *const *, const float *, int, int, int, float *const *);
+    Run run1;
+    Run run2;
+    int phase;
+    int64_t cursor;
+    int avail;
+    int64_t consumed;
+    int64_t produced;
+};
+
+struct Ratio{
+    int L;
+    int M;
+    PolyphaseResampler::Engine *(*create)(int channels);
+};
+
+template<int L, int M, int Taps>
+PolyphaseResampler::Engine *createEngine(int channels)
+{
+    return new Kernel<L, M, Taps>(channels);
+}
+
+/*抽取时截止频率降低，每相的抽头数随M / L增加，保持过渡带宽度相近*/
+const Ratio ratios[] = {
+    {147, 160, createEngine<147, 160, 48>},     /*48000 -> 44100*/
+    {160, 147, createEngine<160, 147, 32>},     /*44100 -> 48000*/
+    {147, 320, createEngine<147, 320, 80>},     /*48000 -> 22050*/
+    {320, 147, createEngine<320, 147, 32>},     /*22050 -> 48000*/
+    {1, 2, createEngine<1, 2, 64>},             /*44100 -> 22050*/
+    {2, 1, createEngine<2, 1, 32>},             /*22050 -> 44100*/
+    {1, 3, createEngine<1, 3, 96>},             /*48000 -> 16000*/
+    {3, 1, createEngine<3, 1, 32>}              /*16000 -> 48000*/
+};
+
+int gcd(int a, int b)
+{
+    while(b != 0){
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+const Ratio *findRatio(int inRate, int outRate)
+{
+    if(inRate <= 0 || outRate <= 0)
+        return nullptr;
+    int g = gcd(inRate, outRate);
+    int L = outRate / g, M = inRate / g;
+    for(const auto &r : ratios){
+        if(r.L == L && r.M == M)
+            return &r;
+    }
+    return nullptr;
+}
+
+}
+
+PolyphaseResampler::PolyphaseResampler()
+{
+}
+
+PolyphaseResampler::~PolyphaseResampler()
+{
+}
+
+bool PolyphaseResampler::supports(int inRate, int outRate)
+{
+    return findRatio(inRate, outRate) != nullptr;
+}
+
+bool PolyphaseResampler::init(int inRate, int outRate, int channels)
+{
+    engine.reset();
+    auto r = findRatio(inRate, outRate);
+    if(r == nullptr || channels <= 0)
+        return false;
+    engine.reset(r->create(channels));
+    return true;
+}
+
+bool PolyphaseResampler::isValid() const
+{
+    return engine != nullptr;
+}
+
+int PolyphaseResampler::maxOutput(int frames) const
+{
+    if(!engine)
+        return 0;
+    return (int)(((int64_t)frames + engine->taps()) * engine->ratioL() / engine->ratioM()) + 2;
+}
+
+int PolyphaseResampler::process(const float *in, int frames, float *out, int outStride)
+{
+    return engine ? engine->process(in, frames, out, outStride) : 0;
+}
+
+int PolyphaseResampler::flush(float *out, int outStride)
+{
+    return engine ? engine->flush(out, outStride) : 0;
+}
+
+bool PolyphaseResampler::setPath(Path path)
+{
+    return engine && engine->setPath(path);
+}
@@ -0,0 +1,60 @@
+#ifndef POLYPHASERESAMPLER_H
+#define POLYPHASERESAMPLER_H
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief 固定比例的多相重采样器
+ * 只支持界面上常用的几种采样率组合，插值倍数L、抽取倍数M和每相的抽头数都是模板参数，
+ * 内层点积在编译期完全展开；数据按声道分开处理，所以声道数不需要特化。
+ * 输入输出都是按声道分开的float，输出第n帧对应输入的n * M / L帧，滤波器的延迟已经补偿
+ */
+class PolyphaseResampler
+{
+public:
+    /*按比例特化的实现，定义在cpp中*/
+    class Engine;
+
+    /**
+     * @brief 内层循环的实现，Fastest为运行时能用的最快实现；三种实现的累加顺序相同，结果逐位相同
+     */
+    enum Path{
+        Fastest = 0,
+        Avx,
+        Sse2,
+        Reference   /*标量实现*/
+    };
+
+public:
+    PolyphaseResampler();
+    ~PolyphaseResampler();
+
+    static bool supports(int inRate, int outRate);
+    bool init(int inRate, int outRate, int channels);
+    bool isValid() const;
+
+    /**
+     * @brief 输出帧数的上限，用来分配输出缓冲
+     */
+    int maxOutput(int frames) const;
+    /**
+     * @brief in的第c个声道从in + c * frames开始，out的第c个声道从out + c * outStride开始，返回输出帧数
+     */
+    int process(const float *in, int frames, float *out, int outStride);
+    /**
+     * @brief 输入结束后取出滤波器里剩下的部分，使总输出为ceil(总输入 * L / M)帧
+     */
+    int flush(float *out, int outStride);
+
+    /**
+     * @brief 指定内层循环的实现，用于核对各实现的结果逐位相同；编译器或CPU不支持时返回false，实现不变
+     */
+    bool setPath(Path path);
+
+private:
+    std::unique_ptr<Engine> engine;
+};
+
+#endif // POLYPHASERESAMPLER_H
@@ -0,0 +1,175 @@
+#include "recorder.h"
+#include <algorithm>
+#include <chrono>
+#include "wavheader.h"
+
+namespace {
+
+/*写盘线程没有数据时的等待时间，也是数据在缓冲里停留的最长时间*/
+const std::chrono::milliseconds pollInterval(10);
+const int readBlockBytes = 64 * 1024;
+
+}
+
+Recorder::Recorder() :
+    inFormat{AV_SAMPLE_FMT_S16, AV_CH_LAYOUT_STEREO, 48000},
+    outFormat{AV_SAMPLE_FMT_S16, AV_CH_LAYOUT_STEREO, 48000},
+    outCoding(SampleCodec::Native),
+    container(AudioContainer::RF64),
+    bufferDuration(2.0),
+    syncInterval(1.0),
+    running(false),
+    captured(0),
+    dropped(0),
+    overruns(0),
+    maxFill(0),
+    written(0),
+    failed(false),
+    pendingSilence(0),
+    silenceByte(0),
+    ditherSeed(0)
+{
+}
+
+Recorder::~Recorder()
+{
+    stop();
+}
+
+void Recorder::setOutputFormat(const StreamConverter::Format &format, SampleCodec::Coding coding)
+{
+    outFormat = format;
+    outCoding = coding;
+}
+
+bool Recorder::start(const std::string &path)
+{
+    stop();
+    StreamConverter::Format target = outFormat;
+    target.format = SampleCodec::decodedFormat(outCoding, av_get_packed_sample_fmt(outFormat.format));
+    if(!stream.open(inFormat, target))
+        return false;
+    auto wavFormat = WavFormat::fromSampleFormat(target.format, target.layout, target.rate);
+    if(outCoding == SampleCodec::Packed24)
+        wavFormat.bitsPerSample = wavFormat.validBits = 24;
+    writer = AudioWriter::create(container);
+    /*出错时保留最后一次重写文件头之前的内容*/
+    writer->setRemoveOnError(false);
+    if(!writer->open(path, wavFormat)){
+        stream.close();
+        writer.reset();
+        return false;
+    }
+
+    /*缓冲按整帧的倍数分配，丢弃时也总是整块*/
+    ring.reset((int64_t)(bufferDuration * inFormat.rate) * inFormat.frameBytes());
+    captured = 0;
+    dropped = 0;
+    overruns = 0;
+    maxFill = 0;
+    written = 0;
+    failed = false;
+    pendingSilence = 0;
+    silenceByte = av_get_packed_sample_fmt(inFormat.format) == AV_SAMPLE_FMT_U8 ? 0x80 : 0;
+    running = true;
+    thread = std::thread(&Recorder::_run, this);
+    return true;
+}
+
+bool Recorder::push(const uint8_t *data, int64_t bytes)
+{
+    captured.fetch_add(bytes, std::memory_order_relaxed);
+    int64_t free = ring.writable();
+    int64_t fill = ring.capacity() - free;
+    /*先补上之前丢掉的部分，保持后面数据的时间位置*/
+    if(pendingSilence > 0){
+        int64_t frameBytes = inFormat.frameBytes();
+        int64_t n = ring.fill(silenceByte, std::min(pendingSilence, free - free % frameBytes));
+        pendingSilence -= n;
+        free -= n;
+    }
+    if(pendingSilence > 0 || bytes > free){
+        pendingSilence += bytes - bytes % inFormat.frameBytes();
+        dropped.fetch_add(bytes, std::memory_order_relaxed);
+        overruns.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    ring.write(data, bytes);
+    fill += bytes;
+    if(fill > maxFill.load(std::memory_order_relaxed))
+        maxFill.store(fill, std::memory_order_relaxed);
+    return true;
+}
+
+bool Recorder::stop()
+{
+    if(!thread.joinable())
+        return !failed;
+    running.store(false, std::memory_order_release);
+    thread.join();
+    bool ok = !failed;
+    ok = stream.finish() && _drain() && ok;
+    stream.close();
+    ok = writer->close() && ok;
+    writer.reset();
+    failed = !ok;
+    return ok;
+}
+
+Recorder::Stats Recorder::stats() const
+{
+    Stats s;
+    s.capturedBytes = captured.load(std::memory_order_relaxed);
+    s.droppedBytes = dropped.load(std::memory_order_relaxed);
+    s.overruns = overruns.load(std::memory_order_relaxed);
+    s.maxFill = maxFill.load(std::memory_order_relaxed);
+    s.writtenBytes = written.load(std::memory_order_relaxed);
+    s.writeError = failed.load(std::memory_order_relaxed);
+    return s;
+}
+
+void Recorder::_run()
+{
+    std::vector<uint8_t> block(readBlockBytes);
+    auto lastSync = std::chrono::steady_clock::now();
+    while(!failed){
+        /*先看是否停止，再读缓冲，停止前写入的数据都能读到*/
+        bool stopping = !running.load(std::memory_order_acquire);
+        bool ok = true;
+        int64_t n = ring.read(block.data(), block.size());
+        if(n > 0)
+            ok = stream.push(block.data(), n) && _drain();
+        auto now = std::chrono::steady_clock::now();
+        if(std::chrono::duration<double>(now - lastSync).count() >= syncInterval){
+            ok = writer->sync() && ok;
+            lastSync = now;
+        }
+        if(!ok)
+            failed = true;
+        else if(n == 0 && stopping)
+            break;
+        else if(n == 0)
+            std::this_thread::sleep_for(pollInterval);
+    }
+}
+
+bool Recorder::_drain()
+{
+    int64_t bytes;
+    auto data = stream.peek(&bytes);
+    if(bytes == 0)
+        return true;
+    bool ok;
+    if(outCoding == SampleCodec::Native)
+        ok = writer->write(data, bytes);
+    else{
+        auto format = stream.outputFormat().format;
+        int64_t count = bytes / av_get_bytes_per_sample(format);
+        encoded.resize(count * SampleCodec::codedBytes(outCoding, format));
+        ok = SampleCodec::encode(outCoding, format, data, count, encoded.data(), false, &ditherSeed)
+                && writer->write(encoded.data(), encoded.size());
+    }
+    stream.consume(bytes);
+    written.store(writer->dataBytes(), std::memory_order_relaxed);
+    return ok;
+}
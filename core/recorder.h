@@ -0,0 +1,106 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ringbuffer.h"
+#include "streamconverter.h"
+#include "samplecodec.h"
+#include "audiowriter.h"
+
+/**
+ * @brief 录音到文件
+ * 采集回调调用push，只把数据拷进无锁环形缓冲；写盘线程定时取出，经StreamConverter转换后写文件，
+ * 并每隔syncInterval按已写长度重写文件头，程序中断时最多丢失这段时间的数据。
+ * 缓冲满时整块丢弃并计数，之后有空间时先在缓冲里补上同样长度的静音，录音时长和实际时间一致
+ */
+class Recorder
+{
+public:
+    struct Stats{
+        int64_t capturedBytes;
+        /*缓冲满时丢弃的字节数和次数*/
+        int64_t droppedBytes;
+        int64_t overruns;
+        /*缓冲的最高占用，可以用来调整缓冲长度*/
+        int64_t maxFill;
+        int64_t writtenBytes;
+        bool writeError;
+    };
+
+public:
+    Recorder();
+    ~Recorder();
+
+    /**
+     * @brief 以下设置在start之前调用，输入为交错格式
+     */
+    void setInputFormat(const StreamConverter::Format &format);
+    void setOutputFormat(const StreamConverter::Format &format, SampleCodec::Coding coding);
+    void setContainer(const AudioContainer::Type &container);
+    void setQuality(const ResamplerOptions::Quality &quality);
+    void setDither(const ResamplerOptions::Dither &method, const double &scale);
+    /**
+     * @brief 环形缓冲能存放的输入时长，写盘停顿超过这个时间才会丢数据
+     */
+    void setBufferDuration(const double &seconds);
+    /**
+     * @brief 重写文件头的间隔
+     */
+    void setSyncInterval(const double &seconds);
+
+    bool start(const std::string &path);
+    /**
+     * @brief 采集线程调用，不加锁、不分配内存；放不下时整块丢弃，返回false
+     */
+    bool push(const uint8_t *data, int64_t bytes);
+    /**
+     * @brief 调用前先停止采集，写完缓冲里剩下的数据后关闭文件，写文件出错时返回false
+     */
+    bool stop();
+    bool isRecording() const;
+    const StreamConverter::Format &inputFormat() const;
+    Stats stats() const;
+
+private:
+    void _run();
+    bool _drain();
+private:
+    StreamConverter::Format inFormat;
+    StreamConverter::Format outFormat;
+    SampleCodec::Coding outCoding;
+    AudioContainer::Type container;
+    double bufferDuration;
+    double syncInterval;
+    RingBuffer ring;
+    StreamConverter stream;
+    std::unique_ptr<AudioWriter> writer;
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<int64_t> captured;
+    std::atomic<int64_t> dropped;
+    std::atomic<int64_t> overruns;
+    std::atomic<int64_t> maxFill;
+    std::atomic<int64_t> written;
+    std::atomic<bool> failed;
+    /*以下只在采集线程使用：还没补上的静音字节数和静音的样本值*/
+    int64_t pendingSilence;
+    uint8_t silenceByte;
+    /*以下只在写盘线程使用*/
+    std::vector<uint8_t> encoded;
+    uint32_t ditherSeed;
+};
+
+inline void Recorder::setInputFormat(const StreamConverter::Format &format)     {   inFormat = format;}
+inline void Recorder::setContainer(const AudioContainer::Type &container)       {   this->container = container;}
+inline void Recorder::setQuality(const ResamplerOptions::Quality &quality)      {   stream.setQuality(quality);}
+inline void Recorder::setDither(const ResamplerOptions::Dither &method, const double &scale)    {   stream.setDither(method, scale);}
+inline void Recorder::setBufferDuration(const double &seconds)                  {   bufferDuration = seconds;}
+inline void Recorder::setSyncInterval(const double &seconds)                    {   syncInterval = seconds;}
+inline bool Recorder::isRecording() const                                       {   return thread.joinable();}
+inline const StreamConverter::Format &Recorder::inputFormat() const             {   return inFormat;}
+#endif // RECORDER_H
@@ -0,0 +1,135 @@
+#include "resampleroptions.h"
+#include <string.h>
+extern "C"{
+#include "libavutil/opt.h"
+}
+
+namespace {
+
+struct Preset{
+    int filterSize;
+    int phaseShift;
+    int linearInterp;
+    double cutoff;
+    int exactRational;
+    double kaiserBeta;
+};
+
+/*
+ * 滤波器长度决定每个输出样本的乘加次数，phase_shift决定非整数比时的相位表大小，
+ * 整数比的转换由exact_rational使用精确的相位数
+ */
+const Preset presets[] = {
+    {8, 6, 1, 0.90, 1, 7.0},
+    {32, 10, 0, 0.97, 1, 9.0},
+    {64, 12, 0, 0.98, 1, 10.0},
+    {128, 14, 0, 0.99, 1, 12.0}
+};
+
+int gcd(int a, int b)
+{
+    while(b != 0){
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+}
+
+const char *ResamplerOptions::name(Quality quality)
+{
+    switch(quality){
+    case Fast:
+        return "fast";
+    case High:
+        return "high";
+    case Best:
+        return "best";
+    case Normal:
+    default:
+        return "normal";
+    }
+}
+
+const char *ResamplerOptions::backendName(Backend backend)
+{
+    return backend == Polyphase ? "polyphase" : "swresample";
+}
+
+bool ResamplerOptions::soxrAvailable()
+{
+    return strstr(swresample_configuration(), "--enable-libsoxr") != nullptr;
+}
+
+bool ResamplerOptions::apply(SwrContext *ctx, Quality quality)
+{
+    if(quality < Fast || quality > Best)
+        quality = Normal;
+    if(quality == Best && soxrAvailable()){
+        /*soxr的precision为位数，28位为其最高质量档*/
+        return av_opt_set_int(ctx, "resampler", SWR_ENGINE_SOXR, 0) >= 0
+                && av_opt_set_double(ctx, "precision", 28.0, 0) >= 0
+                && av_opt_set_double(ctx, "cutoff", 0.99, 0) >= 0;
+    }
+    const Preset &p = presets[quality];
+    return av_opt_set_int(ctx, "resampler", SWR_ENGINE_SWR, 0) >= 0
+            && av_opt_set_int(ctx, "filter_size", p.filterSize, 0) >= 0
+            && av_opt_set_int(ctx, "phase_shift", p.phaseShift, 0) >= 0
+            && av_opt_set_int(ctx, "linear_interp", p.linearInterp, 0) >= 0
+            && av_opt_set_double(ctx, "cutoff", p.cutoff, 0) >= 0
+            && av_opt_set_int(ctx, "exact_rational", p.exactRational, 0) >= 0
+            && av_opt_set_int(ctx, "filter_type", SWR_FILTER_TYPE_KAISER, 0) >= 0
+            && av_opt_set_double(ctx, "kaiser_beta", p.kaiserBeta, 0) >= 0;
+}
+
+bool ResamplerOptions::hasExactPhases(Quality quality, int inRate, int outRate)
+{
+    if(inRate == outRate)
+        return true;
+    if(inRate <= 0 || outRate <= 0)
+        return false;
+    if(quality < Fast || quality > Best)
+        quality = Normal;
+    if(quality == Best && soxrAvailable())
+        return false;
+    /*swresample的exact_rational只在约分后的输出相位数不超过2^phase_shift时生效*/
+    const Preset &p = presets[quality];
+    return p.exactRational && !p.linearInterp && outRate / gcd(inRate, outRate) <= (1 << p.phaseShift);
+}
+
+const char *ResamplerOptions::ditherName(Dither dither)
+{
+    switch(dither){
+    case Rectangular:
+        return "rectangular";
+    case Triangular:
+        return "triangular";
+    case TriangularHighpass:
+        return "triangular high-pass";
+    case Lipshitz:
+        return "lipshitz";
+    case FWeighted:
+        return "f-weighted";
+    case ModifiedEWeighted:
+        return "modified e-weighted";
+    case ImprovedEWeighted:
+        return "improved e-weighted";
+    case Shibata:
+        return "shibata";
+    case LowShibata:
+        return "low shibata";
+    case HighShibata:
+        return "high shibata";
+    case NoDither:
+    default:
+        return "none";
+    }
+}
+
+bool ResamplerOptions::applyDither(SwrContext *ctx, Dither dither, double scale)
+{
+    return av_opt_set_int(ctx, "dither_method", dither, 0) >= 0
+            && av_opt_set_double(ctx, "dither_scale", scale, 0) >= 0;
+}
@@ -0,0 +1,70 @@
+#ifndef RESAMPLEROPTIONS_H
+#define RESAMPLEROPTIONS_H
+
+extern "C"{
+#include "libswresample/swresample.h"
+}
+
+/**
+ * @brief SwrContext的滤波器和抖动设置
+ * 预设对应swresample的filter_size、phase_shift、linear_interp、cutoff、exact_rational，
+ * 编译了libsoxr时Best使用soxr引擎，没有时退回高阶的内置滤波器
+ */
+namespace ResamplerOptions {
+
+enum Quality{
+    Fast = 0,   /*短滤波器加线性插值，批量处理用*/
+    Normal,     /*swresample的默认值*/
+    High,
+    Best        /*母带处理用*/
+};
+
+/**
+ * @brief 降低位深时的抖动方法，对应SwrDitherType
+ * 噪声整形只对44.1kHz和48kHz附近的输出采样率有滤波器，其它采样率swresample会退回三角分布
+ */
+enum Dither{
+    NoDither = SWR_DITHER_NONE,
+    Rectangular = SWR_DITHER_RECTANGULAR,
+    Triangular = SWR_DITHER_TRIANGULAR,
+    TriangularHighpass = SWR_DITHER_TRIANGULAR_HIGHPASS,
+    Lipshitz = SWR_DITHER_NS_LIPSHITZ,
+    FWeighted = SWR_DITHER_NS_F_WEIGHTED,
+    ModifiedEWeighted = SWR_DITHER_NS_MODIFIED_E_WEIGHTED,
+    ImprovedEWeighted = SWR_DITHER_NS_IMPROVED_E_WEIGHTED,
+    Shibata = SWR_DITHER_NS_SHIBATA,
+    LowShibata = SWR_DITHER_NS_LOW_SHIBATA,
+    HighShibata = SWR_DITHER_NS_HIGH_SHIBATA
+};
+
+/**
+ * @brief 重采样的实现，Polyphase只支持PolyphaseResampler里列出的采样率组合
+ */
+enum Backend{
+    Swresample = 0,
+    Polyphase
+};
+
+const char *name(Quality quality);
+const char *backendName(Backend backend);
+bool soxrAvailable();
+/**
+ * @brief 在swr_init之前设置，失败返回false
+ */
+bool apply(SwrContext *ctx, Quality quality);
+/**
+ * @brief 这个预设的相位表是否精确包含inRate到outRate的每个输出相位
+ * 精确时相位累加没有误差，从公共周期上的任意位置重新开始转换，输出和一次转换逐位相同；
+ * 线性插值、相位数不够和soxr时为false
+ */
+bool hasExactPhases(Quality quality, int inRate, int outRate);
+
+const char *ditherName(Dither dither);
+/**
+ * @brief scale为抖动幅度相对默认值的倍数，同样在swr_init之前设置
+ */
+bool applyDither(SwrContext *ctx, Dither dither, double scale);
+
+}
+
+#endif // RESAMPLEROPTIONS_H
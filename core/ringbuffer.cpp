@@ -0,0 +1,78 @@
+#include "ringbuffer.h"
+#include <string.h>
+#include <algorithm>
+
+RingBuffer::RingBuffer(int64_t capacity) :
+    mask(0),
+    writePos(0),
+    readPos(0)
+{
+    reset(capacity);
+}
+
+void RingBuffer::reset(int64_t capacity)
+{
+    uint64_t size = 1;
+    while((int64_t)size < capacity)
+        size <<= 1;
+    buffer.assign(capacity > 0 ? size : 0, 0);
+    mask = size - 1;
+    writePos.store(0);
+    readPos.store(0);
+}
+
+int64_t RingBuffer::write(const uint8_t *data, int64_t bytes)
+{
+    /*只有生产者改writePos，读自己的位置不需要同步；读对方的位置要acquire*/
+    uint64_t w = writePos.load(std::memory_order_relaxed);
+    uint64_t r = readPos.load(std::memory_order_acquire);
+    int64_t n = std::min<int64_t>(bytes, buffer.size() - (w - r));
+    if(n <= 0)
+        return 0;
+    uint64_t index = w & mask;
+    int64_t first = std::min<int64_t>(n, buffer.size() - index);
+    memcpy(buffer.data() + index, data, first);
+    memcpy(buffer.data(), data + first, n - first);
+    writePos.store(w + n, std::memory_order_release);
+    return n;
+}
+
+int64_t RingBuffer::fill(uint8_t value, int64_t bytes)
+{
+    uint64_t w = writePos.load(std::memory_order_relaxed);
+    uint64_t r = readPos.load(std::memory_order_acquire);
+    int64_t n = std::min<int64_t>(bytes, buffer.size() - (w - r));
+    if(n <= 0)
+        return 0;
+    uint64_t index = w & mask;
+    int64_t first = std::min<int64_t>(n, buffer.size() - index);
+    memset(buffer.data() + index, value, first);
+    memset(buffer.data(), value, n - first);
+    writePos.store(w + n, std::memory_order_release);
+    return n;
+}
+
+int64_t RingBuffer::writable() const
+{
+    return buffer.size() - (writePos.load(std::memory_order_relaxed) - readPos.load(std::memory_order_acquire));
+}
+
+int64_t RingBuffer::read(uint8_t *dst, int64_t bytes)
+{
+    uint64_t r = readPos.load(std::memory_order_relaxed);
+    uint64_t w = writePos.load(std::memory_order_acquire);
+    int64_t n = std::min<int64_t>(bytes, w - r);
+    if(n <= 0)
+        return 0;
+    uint64_t index = r & mask;
+    int64_t first = std::min<int64_t>(n, buffer.size() - index);
+    memcpy(dst, buffer.data() + index, first);
+    memcpy(dst + first, buffer.data(), n - first);
+    readPos.store(r + n, std::memory_order_release);
+    return n;
+}
+
+int64_t RingBuffer::readable() const
+{
+    return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,48 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+/**
+ * @brief 单生产者单消费者的无锁字节环形缓冲
+ * 音频回调线程写，写盘线程读，两边都不加锁也不分配内存。
+ * 读写位置是一直增长的64位计数，容量取2的幂，用掩码得到下标
+ */
+class RingBuffer
+{
+public:
+    explicit RingBuffer(int64_t capacity = 0);
+
+    /**
+     * @brief 重新分配，不能和读写同时调用
+     */
+    void reset(int64_t capacity);
+    int64_t capacity() const;
+
+    /**
+     * @brief 生产者调用，空间不够时只写入能放下的部分，返回写入的字节数
+     */
+    int64_t write(const uint8_t *data, int64_t bytes);
+    /**
+     * @brief 写入bytes个value，同样只写入能放下的部分
+     */
+    int64_t fill(uint8_t value, int64_t bytes);
+    int64_t writable() const;
+    /**
+     * @brief 消费者调用，返回读出的字节数
+     */
+    int64_t read(uint8_t *dst, int64_t bytes);
+    int64_t readable() const;
+
+private:
+    std::vector<uint8_t> buffer;
+    uint64_t mask;
+    /*分开放在不同的缓存行，避免两个线程互相使对方的缓存失效*/
+    alignas(64) std::atomic<uint64_t> writePos;
+    alignas(64) std::atomic<uint64_t> readPos;
+};
+
+inline int64_t RingBuffer::capacity() const                                     {   return buffer.size();}
+#endif // RINGBUFFER_H
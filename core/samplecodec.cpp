@@ -0,0 +1,333 @@
+#include "samplecodec.h"
+#include <string.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#define SAMPLECODEC_SSE2
+#endif
+#if defined(SAMPLECODEC_SSE2) && defined(__GNUC__)
+#define SAMPLECODEC_SSSE3 __attribute__((target("ssse3")))
+#elif defined(SAMPLECODEC_SSE2) && defined(_MSC_VER)
+#include <intrin.h>
+#define SAMPLECODEC_SSSE3
+#endif
+
+namespace {
+
+/*pshufb只在SSSE3以上才有，运行时检查一次，不要求整个工程加编译选项*/
+bool hasSsse3()
+{
+#if defined(SAMPLECODEC_SSSE3) && defined(__GNUC__)
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+#elif defined(SAMPLECODEC_SSSE3)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return false;
+#endif
+}
+
+inline uint32_t xorshift(uint32_t x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/*
+ * S32到24位：低8位加上0.5个量化级（以及抖动）后进位到高24位，
+ * 先移位再相加，避免满刻度附近溢出，最后限制在24位范围内
+ */
+inline int32_t quantize24(int32_t v, int32_t noise)
+{
+    int32_t q = (v >> 8) + (((v & 0xFF) + 128 + noise) >> 8);
+    return q > 0x7FFFFF ? 0x7FFFFF : (q < -0x800000 ? -0x800000 : q);
+}
+
+/*随机数的两个字节相减得到[-255,255]的三角分布，幅度为正负一个24位量化级*/
+inline int32_t tpdf(uint32_t r)
+{
+    return (int32_t)(r >> 24) - (int32_t)((r >> 16) & 0xFF);
+}
+
+/*G.711的解码公式，和ITU-T参考实现一致，只在建表时使用*/
+int16_t alawToLinear(uint8_t a)
+{
+    a ^= 0x55;
+    int t = (a & 0x0F) << 4;
+    int seg = (a & 0x70) >> 4;
+    if(seg == 0)
+        t += 8;
+    else
+        t = (t + 0x108) << (seg - 1);
+    return (int16_t)((a & 0x80) ? t : -t);
+}
+
+int16_t ulawToLinear(uint8_t u)
+{
+    u = ~u;
+    int t = (((u & 0x0F) << 3) + 0x84) << ((u & 0x70) >> 4);
+    return (int16_t)((u & 0x80) ? 0x84 - t : t - 0x84);
+}
+
+struct G711Tables{
+    int16_t alaw[256];
+    int16_t ulaw[256];
+    G711Tables()
+    {
+        for(int i = 0; i < 256; ++i){
+            alaw[i] = alawToLinear((uint8_t)i);
+            ulaw[i] = ulawToLinear((uint8_t)i);
+        }
+    }
+};
+
+const G711Tables g711Tables;
+
+/*查表的循环展开成4路，减少循环开销，表只有512字节一直在L1缓存中*/
+void decodeTable(const int16_t *table, const uint8_t *src, int64_t count, int16_t *dst)
+{
+    int64_t i = 0;
+    for(; i + 4 <= count; i += 4){
+        dst[i] = table[src[i]];
+        dst[i + 1] = table[src[i + 1]];
+        dst[i + 2] = table[src[i + 2]];
+        dst[i + 3] = table[src[i + 3]];
+    }
+    for(; i < count; ++i)
+        dst[i] = table[src[i]];
+}
+
+#ifdef SAMPLECODEC_SSSE3
+SAMPLECODEC_SSSE3 int64_t unpack24Ssse3(const uint8_t *src, int64_t count, int32_t *dst, bool bigEndian)
+{
+    /*每次读16字节取其中12字节的4个样本，放到每个32位的高3字节*/
+    const __m128i shuffle = bigEndian
+            ? _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9)
+            : _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    int64_t i = 0;
+    for(; i + 6 <= count; i += 4){
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 3));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(v, shuffle));
+    }
+    return i;
+}
+
+SAMPLECODEC_SSSE3 int64_t pack24Ssse3(const int32_t *src, int64_t count, uint8_t *dst,
+                                      bool dither, uint32_t *seed)
+{
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i lowMask = _mm_set1_epi32(0xFF);
+    const __m128i half = _mm_set1_epi32(128);
+    const __m128i maxv = _mm_set1_epi32(0x7FFFFF);
+    const __m128i minv = _mm_set1_epi32(-0x800000);
+    /*四路独立的xorshift，种子由标量状态展开*/
+    uint32_t s = *seed ? *seed : 0x9E3779B9u;
+    uint32_t lanes[4];
+    for(int k = 0; k < 4; ++k)
+        lanes[k] = s = xorshift(s);
+    __m128i state = _mm_loadu_si128((const __m128i *)lanes);
+    int64_t i = 0;
+    /*每次写16字节只用前12字节，多写的部分由下一次覆盖，所以末尾留出余量*/
+    for(; i + 6 <= count; i += 4){
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i noise = _mm_setzero_si128();
+        if(dither){
+            state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+            state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+            state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+            noise = _mm_sub_epi32(_mm_srli_epi32(state, 24),
+                                  _mm_and_si128(_mm_srli_epi32(state, 16), lowMask));
+        }
+        __m128i carry = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(v, lowMask), half), noise);
+        __m128i q = _mm_add_epi32(_mm_srai_epi32(v, 8), _mm_srai_epi32(carry, 8));
+        __m128i over = _mm_cmpgt_epi32(q, maxv);
+        q = _mm_or_si128(_mm_andnot_si128(over, q), _mm_and_si128(over, maxv));
+        __m128i under = _mm_cmplt_epi32(q, minv);
+        q = _mm_or_si128(_mm_andnot_si128(under, q), _mm_and_si128(under, minv));
+        _mm_storeu_si128((__m128i *)(dst + i * 3), _mm_shuffle_epi8(q, shuffle));
+    }
+    _mm_storeu_si128((__m128i *)lanes, state);
+    *seed = lanes[0] ^ lanes[1] ^ lanes[2] ^ lanes[3];
+    return i;
+}
+
+SAMPLECODEC_SSSE3 int64_t swapBytesSsse3(const uint8_t *src, int64_t count, int sampleSize, uint8_t *dst)
+{
+    __m128i shuffle;
+    switch(sampleSize){
+    case 2:
+        shuffle = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        break;
+    case 4:
+        shuffle = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        break;
+    case 8:
+        shuffle = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        break;
+    default:
+        return 0;
+    }
+    int64_t bytes = count * sampleSize;
+    int64_t i = 0;
+    for(; i + 16 <= bytes; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(v, shuffle));
+    }
+    return i / sampleSize;
+}
+#endif
+
+}
+
+int SampleCodec::codedBytes(Coding coding, AVSampleFormat format)
+{
+    switch(coding){
+    case Packed24:
+    case Packed24BE:
+        return 3;
+    case ALaw:
+    case MuLaw:
+    case Signed8:
+        return 1;
+    default:
+        return av_get_bytes_per_sample(format);
+    }
+}
+
+AVSampleFormat SampleCodec::decodedFormat(Coding coding, AVSampleFormat format)
+{
+    switch(coding){
+    case Packed24:
+    case Packed24BE:
+        return AV_SAMPLE_FMT_S32;
+    case ALaw:
+    case MuLaw:
+        return AV_SAMPLE_FMT_S16;
+    case Signed8:
+        return AV_SAMPLE_FMT_U8;
+    default:
+        return format;
+    }
+}
+
+bool SampleCodec::decode(Coding coding, AVSampleFormat format, const uint8_t *src, int64_t count, uint8_t *dst)
+{
+    switch(coding){
+    case Packed24:
+    case Packed24BE:
+        unpack24(src, count, reinterpret_cast<int32_t *>(dst), coding == Packed24BE);
+        return true;
+    case BigEndian:
+    {
+        int size = av_get_bytes_per_sample(format);
+        if(size == 1)
+            memcpy(dst, src, count);
+        else if(size == 2 || size == 4 || size == 8)
+            swapBytes(src, count, size, dst);
+        else
+            return false;
+        return true;
+    }
+    case ALaw:
+        decodeALaw(src, count, reinterpret_cast<int16_t *>(dst));
+        return true;
+    case MuLaw:
+        decodeMuLaw(src, count, reinterpret_cast<int16_t *>(dst));
+        return true;
+    case Signed8:
+        flipSign8(src, count, dst);
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool SampleCodec::encode(Coding coding, AVSampleFormat format, const uint8_t *src, int64_t count, uint8_t *dst,
+                         bool dither, uint32_t *seed)
+{
+    uint32_t state = 0;
+    switch(coding){
+    case BigEndian:
+    case Signed8:
+        /*字节交换和符号位翻转都是对称的*/
+        return decode(coding, format, src, count, dst);
+    case Packed24:
+        pack24(reinterpret_cast<const int32_t *>(src), count, dst, dither, seed ? seed : &state);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void SampleCodec::unpack24(const uint8_t *src, int64_t count, int32_t *dst, bool bigEndian)
+{
+    int64_t i = 0;
+#ifdef SAMPLECODEC_SSSE3
+    if(hasSsse3())
+        i = unpack24Ssse3(src, count, dst, bigEndian);
+#endif
+    const int lo = bigEndian ? 2 : 0;
+    const int hi = 2 - lo;
+    for(; i < count; ++i){
+        const uint8_t *p = src + i * 3;
+        dst[i] = (int32_t)((uint32_t)p[lo] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[hi] << 24);
+    }
+}
+
+void SampleCodec::pack24(const int32_t *src, int64_t count, uint8_t *dst, bool dither, uint32_t *seed)
+{
+    int64_t i = 0;
+#ifdef SAMPLECODEC_SSSE3
+    if(hasSsse3())
+        i = pack24Ssse3(src, count, dst, dither, seed);
+#endif
+    uint32_t s = *seed ? *seed : 0x9E3779B9u;
+    for(; i < count; ++i){
+        int32_t noise = 0;
+        if(dither){
+            s = xorshift(s);
+            noise = tpdf(s);
+        }
+        int32_t q = quantize24(src[i], noise);
+        uint8_t *p = dst + i * 3;
+        p[0] = q & 0xFF;
+        p[1] = (q >> 8) & 0xFF;
+        p[2] = (q >> 16) & 0xFF;
+    }
+    *seed = s;
+}
+
+void SampleCodec::swapBytes(const uint8_t *src, int64_t count, int sampleSize, uint8_t *dst)
+{
+    int64_t i = 0;
+#ifdef SAMPLECODEC_SSSE3
+    if(hasSsse3())
+        i = swapBytesSsse3(src, count, sampleSize, dst);
+#endif
+    for(; i < count; ++i){
+        const uint8_t *p = src + i * sampleSize;
+        uint8_t *q = dst + i * sampleSize;
+        for(int k = 0; k < sampleSize; ++k)
+            q[k] = p[sampleSize - 1 - k];
+    }
+}
+
+void SampleCodec::decodeALaw(const uint8_t *src, int64_t count, int16_t *dst)
+{
+    decodeTable(g711Tables.alaw, src, count, dst);
+}
+
+void SampleCodec::decodeMuLaw(const uint8_t *src, int64_t count, int16_t *dst)
+{
+    decodeTable(g711Tables.ulaw, src, count, dst);
+}
+
+void SampleCodec::flipSign8(const uint8_t *src, int64_t count, uint8_t *dst)
+{
+    for(int64_t i = 0; i < count; ++i)
+        dst[i] = src[i] ^ 0x80;
+}
@@ -0,0 +1,65 @@
+#ifndef SAMPLECODEC_H
+#define SAMPLECODEC_H
+
+#include <stdint.h>
+extern "C"{
+#include "libavutil/samplefmt.h"
+}
+
+/**
+ * @brief 文件中样本的存放方式和内部AVSampleFormat之间的转换
+ * 读入时先解码为内部格式，之后的重采样、分析都只处理AVSampleFormat；
+ * 写出时再编码回文件中的存放方式
+ */
+namespace SampleCodec {
+
+enum Coding{
+    Native = 0,     /*和AVSampleFormat一致，不需要转换*/
+    Packed24,       /*3字节小端有符号整数，内部为S32（高24位有效）*/
+    BigEndian,      /*大端存放的AVSampleFormat，按样本大小交换字节*/
+    Packed24BE,     /*3字节大端有符号整数，内部为S32*/
+    ALaw,           /*G.711 A律，每样本1字节，内部为S16*/
+    MuLaw,          /*G.711 μ律，每样本1字节，内部为S16*/
+    Signed8         /*有符号8位（AIFF、CAF），内部为U8*/
+};
+
+/**
+ * @brief 文件中每个样本占的字节数，Native时为format的字节数
+ */
+int codedBytes(Coding coding, AVSampleFormat format);
+/**
+ * @brief 解码后的内部格式
+ */
+AVSampleFormat decodedFormat(Coding coding, AVSampleFormat format);
+
+/**
+ * @brief 解码count个样本，dst需要count * av_get_bytes_per_sample(decodedFormat)字节
+ * 只有编码方式和format的组合没有意义时返回false
+ */
+bool decode(Coding coding, AVSampleFormat format, const uint8_t *src, int64_t count, uint8_t *dst);
+/**
+ * @brief 编码count个样本，dither为true时在量化前加三角分布（TPDF）抖动，
+ * 否则四舍五入，seed保存抖动的随机数状态，分块调用时传入同一个变量
+ */
+bool encode(Coding coding, AVSampleFormat format, const uint8_t *src, int64_t count, uint8_t *dst,
+            bool dither = false, uint32_t *seed = nullptr);
+
+void unpack24(const uint8_t *src, int64_t count, int32_t *dst, bool bigEndian = false);
+void pack24(const int32_t *src, int64_t count, uint8_t *dst, bool dither, uint32_t *seed);
+/**
+ * @brief 每个sampleSize字节的样本反转字节顺序，2、4、8字节有SIMD实现，其它大小逐字节处理
+ */
+void swapBytes(const uint8_t *src, int64_t count, int sampleSize, uint8_t *dst);
+/**
+ * @brief G.711解码，查256项的表
+ */
+void decodeALaw(const uint8_t *src, int64_t count, int16_t *dst);
+void decodeMuLaw(const uint8_t *src, int64_t count, int16_t *dst);
+/**
+ * @brief 有符号和无符号8位互相转换，翻转最高位
+ */
+void flipSign8(const uint8_t *src, int64_t count, uint8_t *dst);
+
+}
+
+#endif // SAMPLECODEC_H
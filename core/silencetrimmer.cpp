@@ -0,0 +1,141 @@
+#include "silencetrimmer.h"
+#include <math.h>
+#include <algorithm>
+
+SilenceTrimmer::SilenceTrimmer() :
+    nbChannels(1),
+    frameSize(2),
+    sampleRate(48000),
+    threshold(0.001f),
+    minDuration(0.5),
+    maxGap(0),
+    trimEdges(true)
+{
+    reset(nbChannels, AV_SAMPLE_FMT_S16, sampleRate);
+}
+
+void SilenceTrimmer::reset(int channels, AVSampleFormat format, int rate)
+{
+    nbChannels = std::max(channels, 1);
+    frameSize = av_get_bytes_per_sample(format) * nbChannels;
+    sampleRate = std::max(rate, 1);
+    minFrames = (int64_t)(minDuration * sampleRate);
+    gapLimit = maxGap > 0 ? (int64_t)(maxGap * sampleRate) : -1;
+    started = false;
+    runFrames = 0;
+    held.clear();
+    leading = trailing = gaps = 0;
+}
+
+void SilenceTrimmer::setThreshold(double dbfs)
+{
+    threshold = (float)pow(10.0, dbfs / 20);
+}
+
+void SilenceTrimmer::setMinDuration(double seconds)
+{
+    minDuration = std::max(seconds, 0.0);
+    minFrames = (int64_t)(minDuration * sampleRate);
+}
+
+void SilenceTrimmer::setTrimEdges(bool enable)
+{
+    trimEdges = enable;
+}
+
+void SilenceTrimmer::setMaxGap(double seconds)
+{
+    maxGap = seconds;
+    gapLimit = maxGap > 0 ? (int64_t)(maxGap * sampleRate) : -1;
+}
+
+void SilenceTrimmer::process(const uint8_t *data, const float *planar, int frames, const Sink &sink)
+{
+    if(frames <= 0)
+        return;
+    /*先求出每帧各声道绝对值的最大值，按声道顺序扫描，循环可以向量化*/
+    level.resize(frames);
+    silent.resize(frames);
+    for(int i = 0; i < frames; ++i)
+        level[i] = fabsf(planar[i]);
+    for(int c = 1; c < nbChannels; ++c){
+        const float *p = planar + (int64_t)c * frames;
+        for(int i = 0; i < frames; ++i)
+            level[i] = std::max(level[i], fabsf(p[i]));
+    }
+    for(int i = 0; i < frames; ++i)
+        silent[i] = level[i] < threshold;
+
+    int i = 0;
+    while(i < frames){
+        int j = i;
+        bool quiet = silent[i];
+        while(j < frames && silent[j] == quiet)
+            ++j;
+        const uint8_t *seg = data + (int64_t)i * frameSize;
+        if(quiet){
+            runFrames += j - i;
+            _hold(seg, j - i);
+        }
+        else{
+            _closeRun(!started && trimEdges, sink);
+            started = true;
+            sink(seg, (j - i) * frameSize);
+        }
+        i = j;
+    }
+}
+
+void SilenceTrimmer::finish(const Sink &sink)
+{
+    _closeRun(trimEdges, sink);
+}
+
+void SilenceTrimmer::_hold(const uint8_t *data, int frames)
+{
+    /*只保存以后可能写出的部分，超出的静音直接丢掉*/
+    int64_t limit = _holdLimit();
+    int64_t have = held.size() / frameSize;
+    int64_t n = limit < 0 ? frames : std::min<int64_t>(frames, std::max<int64_t>(limit - have, 0));
+    held.insert(held.end(), data, data + n * frameSize);
+}
+
+void SilenceTrimmer::_closeRun(bool trim, const Sink &sink)
+{
+    if(runFrames == 0)
+        return;
+    int64_t keep = runFrames;
+    if(runFrames >= minFrames){
+        if(trim)
+            keep = 0;
+        else if(gapLimit >= 0)
+            keep = std::min(runFrames, gapLimit);
+    }
+    keep = std::min<int64_t>(keep, held.size() / frameSize);
+    if(keep > 0)
+        sink(held.data(), (int)(keep * frameSize));
+
+    int64_t removed = runFrames - keep;
+    if(!started)
+        leading += removed;
+    else if(trim)
+        trailing += removed;
+    else
+        gaps += removed;
+    held.clear();
+    runFrames = 0;
+}
+
+int64_t SilenceTrimmer::_holdLimit() const
+{
+    /*
+     * 开头需要裁剪时，静音超过最短时长后一定会被全部去掉；
+     * 中间停顿压缩时最多保留max(最短时长,maxGap)；
+     * 不压缩时，只有到文件末尾才知道是不是结尾，需要全部保存
+     */
+    if(!started && trimEdges)
+        return minFrames;
+    if(gapLimit >= 0)
+        return std::max(minFrames, gapLimit);
+    return -1;
+}
@@ -0,0 +1,73 @@
+#ifndef SILENCETRIMMER_H
+#define SILENCETRIMMER_H
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+extern "C"{
+#include "libavutil/samplefmt.h"
+}
+
+/**
+ * @brief 流式静音检测与裁剪
+ * 所有声道的绝对值都低于门限的帧视为静音，连续静音达到最短时长才会处理：
+ * 去掉开头和结尾的静音，可选地把中间过长的停顿压缩到maxGap。
+ * 静音段先暂存，等到确定它是中间停顿还是结尾时再决定写出多少
+ */
+class SilenceTrimmer
+{
+public:
+    typedef std::function<void(const uint8_t *data,int bytes)> Sink;
+
+public:
+    SilenceTrimmer();
+
+    void reset(int channels, AVSampleFormat format, int rate);
+    void setThreshold(double dbfs);
+    void setMinDuration(double seconds);
+    void setTrimEdges(bool enable);
+    /**
+     * @brief 中间停顿保留的最长时间，<=0表示不压缩
+     */
+    void setMaxGap(double seconds);
+
+    /**
+     * @brief data为原始格式的交错数据，planar为同一块数据转成的按声道float
+     */
+    void process(const uint8_t *data, const float *planar, int frames, const Sink &sink);
+    void finish(const Sink &sink);
+
+    int64_t leadingFrames() const;
+    int64_t trailingFrames() const;
+    int64_t gapFrames() const;
+
+private:
+    void _hold(const uint8_t *data, int frames);
+    void _closeRun(bool trim, const Sink &sink);
+    int64_t _holdLimit() const;
+private:
+    int nbChannels;
+    int frameSize;
+    int sampleRate;
+    float threshold;
+    double minDuration;
+    double maxGap;
+    bool trimEdges;
+    int64_t minFrames;
+    int64_t gapLimit;
+
+    bool started;
+    int64_t runFrames;
+    std::vector<uint8_t> held;
+    std::vector<float> level;
+    std::vector<uint8_t> silent;
+
+    int64_t leading;
+    int64_t trailing;
+    int64_t gaps;
+};
+
+inline int64_t SilenceTrimmer::leadingFrames() const                            {   return leading;}
+inline int64_t SilenceTrimmer::trailingFrames() const                           {   return trailing;}
+inline int64_t SilenceTrimmer::gapFrames() const                                {   return gaps;}
+#endif // SILENCETRIMMER_H
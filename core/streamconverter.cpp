@@ -0,0 +1,207 @@
+#include "streamconverter.h"
+#include <string.h>
+#include <algorithm>
+
+namespace {
+
+/*一次交给swr_convert的最大帧数，避免很大的输入一次预留过多输出空间*/
+const int maxChunkFrames = 1 << 16;
+
+}
+
+int StreamConverter::Format::channels() const
+{
+    return av_get_channel_layout_nb_channels(layout);
+}
+
+int StreamConverter::Format::frameBytes() const
+{
+    int bytes = av_get_bytes_per_sample(format);
+    return av_sample_fmt_is_planar(format) ? bytes : bytes * channels();
+}
+
+StreamConverter::StreamConverter() :
+    ctx(nullptr),
+    reused(false),
+    readPos(0)
+{
+    key.quality = ResamplerOptions::Normal;
+    key.dither = ResamplerOptions::NoDither;
+    key.ditherScale = 1.0;
+    in = out = Format{AV_SAMPLE_FMT_NONE, 0, 0};
+}
+
+StreamConverter::~StreamConverter()
+{
+    close();
+}
+
+bool StreamConverter::open(const Format &in, const Format &out)
+{
+    close();
+    std::lock_guard<std::mutex> lock(mutex);
+    this->in = in;
+    this->out = out;
+    this->out.format = av_get_packed_sample_fmt(out.format);
+    key.inLayout = in.layout;
+    key.inRate = in.rate;
+    key.inFormat = in.format;
+    key.outLayout = out.layout;
+    key.outRate = out.rate;
+    key.outFormat = this->out.format;
+    ctx = SwrPool::instance().acquire(key, &reused);
+    return ctx != nullptr;
+}
+
+void StreamConverter::close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(ctx != nullptr)
+        SwrPool::instance().release(key, ctx);
+    ctx = nullptr;
+    partial.clear();
+    queue.clear();
+    readPos = 0;
+}
+
+bool StreamConverter::push(const uint8_t *data, int64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(ctx == nullptr || av_sample_fmt_is_planar(in.format))
+        return false;
+    int64_t frameBytes = in.frameBytes();
+    /*先把上次剩下的半帧补齐*/
+    if(!partial.empty()){
+        int64_t n = std::min<int64_t>(frameBytes - partial.size(), bytes);
+        partial.insert(partial.end(), data, data + n);
+        data += n;
+        bytes -= n;
+        if((int64_t)partial.size() < frameBytes)
+            return true;
+        const uint8_t *planes[1] = {partial.data()};
+        if(!_convert(planes, 1))
+            return false;
+        partial.clear();
+    }
+    int64_t frames = bytes / frameBytes;
+    while(frames > 0){
+        int n = (int)std::min<int64_t>(frames, maxChunkFrames);
+        const uint8_t *planes[1] = {data};
+        if(!_convert(planes, n))
+            return false;
+        data += n * frameBytes;
+        bytes -= n * frameBytes;
+        frames -= n;
+    }
+    partial.assign(data, data + bytes);
+    return true;
+}
+
+bool StreamConverter::push(const uint8_t *const *planes, int frames)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(ctx == nullptr || !av_sample_fmt_is_planar(in.format))
+        return false;
+    int channels = in.channels();
+    int sampleBytes = av_get_bytes_per_sample(in.format);
+    std::vector<const uint8_t *> chunk(planes, planes + channels);
+    for(int pos = 0; pos < frames; pos += maxChunkFrames){
+        int n = std::min(frames - pos, maxChunkFrames);
+        for(int c = 0; c < channels; ++c)
+            chunk[c] = planes[c] + (int64_t)pos * sampleBytes;
+        if(!_convert(chunk.data(), n))
+            return false;
+    }
+    return true;
+}
+
+bool StreamConverter::finish()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(ctx == nullptr)
+        return false;
+    /*不满一帧的字节不是完整的样本，丢弃*/
+    partial.clear();
+    int64_t before;
+    do{
+        before = queue.size();
+        if(!_convert(nullptr, 0))
+            return false;
+    }while((int64_t)queue.size() > before);
+    return true;
+}
+
+int64_t StreamConverter::delay()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return ctx != nullptr ? swr_get_delay(ctx, in.rate) : 0;
+}
+
+int64_t StreamConverter::available()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size() - readPos;
+}
+
+int64_t StreamConverter::pull(uint8_t *dst, int64_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t frameBytes = out.frameBytes();
+    int64_t n = std::min<int64_t>(capacity / frameBytes * frameBytes, queue.size() - readPos);
+    if(n > 0)
+        memcpy(dst, queue.data() + readPos, n);
+    readPos += n;
+    _compact();
+    return n;
+}
+
+const uint8_t *StreamConverter::peek(int64_t *bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    *bytes = queue.size() - readPos;
+    return queue.data() + readPos;
+}
+
+void StreamConverter::consume(int64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    readPos += std::min<int64_t>(bytes, queue.size() - readPos);
+    _compact();
+}
+
+void StreamConverter::setDither(const ResamplerOptions::Dither &method, const double &scale)
+{
+    key.dither = method;
+    key.ditherScale = scale;
+}
+
+bool StreamConverter::_convert(const uint8_t **planes, int frames)
+{
+    int outFrames = (int)av_rescale_rnd(swr_get_delay(ctx, in.rate) + frames, out.rate, in.rate, AV_ROUND_UP);
+    if(outFrames <= 0)
+        return true;
+    int64_t frameBytes = out.frameBytes();
+    int64_t tail = queue.size();
+    queue.resize(tail + outFrames * frameBytes);
+    uint8_t *dst[1] = {queue.data() + tail};
+    int ret = swr_convert(ctx, dst, outFrames, planes, frames);
+    if(ret < 0){
+        queue.resize(tail);
+        return false;
+    }
+    queue.resize(tail + ret * frameBytes);
+    return true;
+}
+
+void StreamConverter::_compact()
+{
+    /*全部取走时直接清空，否则已取走的部分超过一半再移到前面*/
+    if(readPos == (int64_t)queue.size()){
+        queue.clear();
+        readPos = 0;
+    }
+    else if(readPos > 65536 && readPos * 2 > (int64_t)queue.size()){
+        queue.erase(queue.begin(), queue.begin() + readPos);
+        readPos = 0;
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef STREAMCONVERTER_H
+#define STREAMCONVERTER_H
+
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+#include "swrpool.h"
+extern "C"{
+#include "libavutil/samplefmt.h"
+#include "libswresample/swresample.h"
+}
+
+/**
+ * @brief 内存中的流式转换，调用方推入任意长度的输入，取出转换后的交错数据
+ * 和Converter使用同一个SwrContext循环，context从SwrPool取得。
+ * 推入的数据直接交给swr_convert，只有上次剩下的不满一帧的字节需要拷贝；
+ * 输出写在内部队列的末尾，pull时拷出，peek/consume可以不拷贝直接读取。
+ * push和pull可以在不同线程调用
+ */
+class StreamConverter
+{
+public:
+    struct Format{
+        AVSampleFormat format;
+        int64_t layout;
+        int rate;
+
+        int channels() const;
+        /*交错格式一帧的字节数，平面格式为一个声道一个样本的字节数*/
+        int frameBytes() const;
+    };
+
+public:
+    StreamConverter();
+    ~StreamConverter();
+
+    /**
+     * @brief 输出总是交错格式，平面格式按对应的交错格式输出
+     */
+    bool open(const Format &in, const Format &out);
+    void close();
+    bool isOpen() const;
+    const Format &inputFormat() const;
+    const Format &outputFormat() const;
+
+    /**
+     * @brief 推入交错数据，bytes不必是整帧
+     */
+    bool push(const uint8_t *data, int64_t bytes);
+    /**
+     * @brief 推入平面数据，每个声道一个指针
+     */
+    bool push(const uint8_t *const *planes, int frames);
+    /**
+     * @brief 输入结束，取出重采样滤波器里剩下的数据，之后可以再次push开始新的一段
+     */
+    bool finish();
+    /**
+     * @brief 重采样器里缓存、还没有输出的输入帧数
+     */
+    int64_t delay();
+
+    /**
+     * @brief 可以取出的字节数，总是整帧
+     */
+    int64_t available();
+    /**
+     * @brief 最多取出capacity字节（按整帧截断），返回实际字节数
+     */
+    int64_t pull(uint8_t *dst, int64_t capacity);
+    /**
+     * @brief 不拷贝地读取队列中的数据，指针在下一次push、pull或consume之前有效
+     */
+    const uint8_t *peek(int64_t *bytes);
+    void consume(int64_t bytes);
+
+    /**
+     * @brief 以下设置在open之前调用，matrix格式同swr_set_matrix，为空时使用默认矩阵
+     */
+    void setQuality(const ResamplerOptions::Quality &quality);
+    void setDither(const ResamplerOptions::Dither &method, const double &scale);
+    void setMatrix(const std::vector<double> &matrix);
+    /**
+     * @brief open时是否复用了SwrPool中的滤波器
+     */
+    bool reusedFilter() const;
+
+private:
+    bool _convert(const uint8_t **planes, int frames);
+    void _compact();
+private:
+    std::mutex mutex;
+    SwrPool::Key key;
+    SwrContext *ctx;
+    Format in;
+    Format out;
+    bool reused;
+    /*上次推入时不满一帧的字节*/
+    std::vector<uint8_t> partial;
+    /*转换结果，从readPos开始是还没取走的数据*/
+    std::vector<uint8_t> queue;
+    int64_t readPos;
+};
+
+inline bool StreamConverter::isOpen() const                                     {   return ctx != nullptr;}
+inline const StreamConverter::Format &StreamConverter::inputFormat() const      {   return in;}
+inline const StreamConverter::Format &StreamConverter::outputFormat() const     {   return out;}
+inline void StreamConverter::setQuality(const ResamplerOptions::Quality &quality)   {   key.quality = quality;}
+inline void StreamConverter::setMatrix(const std::vector<double> &matrix)       {   key.matrix = matrix;}
+inline bool StreamConverter::reusedFilter() const                               {   return reused;}
+#endif // STREAMCONVERTER_H
@@ -0,0 +1,125 @@
+#include "swrpool.h"
+extern "C"{
+#include "libavutil/opt.h"
+}
+
+bool SwrPool::Key::operator==(const Key &other) const
+{
+    return inLayout == other.inLayout && outLayout == other.outLayout
+            && inRate == other.inRate && outRate == other.outRate
+            && inFormat == other.inFormat && outFormat == other.outFormat
+            && quality == other.quality && dither == other.dither
+            && ditherScale == other.ditherScale && matrix == other.matrix;
+}
+
+SwrPool &SwrPool::instance()
+{
+    static SwrPool pool;
+    return pool;
+}
+
+SwrPool::SwrPool(int capacity) :
+    maxIdle(capacity)
+{
+}
+
+SwrPool::~SwrPool()
+{
+    clear();
+}
+
+SwrContext *SwrPool::acquire(const Key &key, bool *reused)
+{
+    SwrContext *ctx = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for(auto it = idle.begin(); it != idle.end(); ++it){
+            if(it->first == key){
+                ctx = it->second;
+                idle.erase(it);
+                break;
+            }
+        }
+    }
+    if(reused)
+        *reused = ctx != nullptr;
+    if(ctx == nullptr)
+        return _create(key);
+
+    /*swr_close只清掉转换状态和缓冲，重采样器保留；矩阵要在swr_init之前重新设置*/
+    swr_close(ctx);
+    if((!key.matrix.empty() && swr_set_matrix(ctx, key.matrix.data(), av_get_channel_layout_nb_channels(key.inLayout)) < 0)
+            || swr_init(ctx) < 0){
+        swr_free(&ctx);
+        return nullptr;
+    }
+    return ctx;
+}
+
+void SwrPool::release(const Key &key, SwrContext *ctx)
+{
+    if(ctx == nullptr)
+        return;
+    std::lock_guard<std::mutex> lock(mutex);
+    idle.emplace_front(key, ctx);
+    _trim();
+}
+
+bool SwrPool::warm(const Key &key)
+{
+    auto ctx = acquire(key);
+    if(ctx == nullptr)
+        return false;
+    release(key, ctx);
+    return true;
+}
+
+void SwrPool::setCapacity(int capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    maxIdle = capacity < 0 ? 0 : capacity;
+    _trim();
+}
+
+void SwrPool::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for(auto &item : idle)
+        swr_free(&item.second);
+    idle.clear();
+}
+
+int SwrPool::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return (int)idle.size();
+}
+
+SwrContext *SwrPool::_create(const Key &key)
+{
+    auto ctx = swr_alloc();
+    if(ctx == nullptr)
+        return nullptr;
+    av_opt_set_int(ctx, "in_channel_layout", key.inLayout, 0);
+    av_opt_set_int(ctx, "in_sample_rate", key.inRate, 0);
+    av_opt_set_sample_fmt(ctx, "in_sample_fmt", key.inFormat, 0);
+    av_opt_set_int(ctx, "out_channel_layout", key.outLayout, 0);
+    av_opt_set_int(ctx, "out_sample_rate", key.outRate, 0);
+    av_opt_set_sample_fmt(ctx, "out_sample_fmt", key.outFormat, 0);
+    bool ok = ResamplerOptions::apply(ctx, key.quality)
+            && ResamplerOptions::applyDither(ctx, key.dither, key.ditherScale)
+            && (key.matrix.empty()
+                || swr_set_matrix(ctx, key.matrix.data(), av_get_channel_layout_nb_channels(key.inLayout)) >= 0)
+            && swr_init(ctx) >= 0;
+    if(!ok)
+        swr_free(&ctx);
+    return ctx;
+}
+
+void SwrPool::_trim()
+{
+    while((int)idle.size() > maxIdle){
+        swr_free(&idle.back().second);
+        idle.pop_back();
+    }
+}
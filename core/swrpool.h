@@ -0,0 +1,72 @@
+#ifndef SWRPOOL_H
+#define SWRPOOL_H
+
+#include <stdint.h>
+#include <list>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "resampleroptions.h"
+extern "C"{
+#include "libavutil/samplefmt.h"
+#include "libswresample/swresample.h"
+}
+
+/**
+ * @brief 已初始化SwrContext的缓存，所有线程共用
+ * swr_init在重采样参数（采样率、滤波器）不变时会保留原来的多相滤波器组，
+ * 所以同样参数的任务复用用过的context，只需swr_close清掉上次的延迟数据再swr_init，
+ * 短文件批量转换时不用每次重新计算滤波器
+ */
+class SwrPool
+{
+public:
+    struct Key{
+        int64_t inLayout;
+        int64_t outLayout;
+        int inRate;
+        int outRate;
+        AVSampleFormat inFormat;
+        AVSampleFormat outFormat;
+        ResamplerOptions::Quality quality;
+        ResamplerOptions::Dither dither;
+        double ditherScale;
+        /*自定义混音矩阵，为空时使用swresample默认的矩阵*/
+        std::vector<double> matrix;
+
+        bool operator==(const Key &other) const;
+    };
+
+public:
+    static SwrPool &instance();
+
+    explicit SwrPool(int capacity = 8);
+    ~SwrPool();
+
+    /**
+     * @brief 取得可以直接使用的context，reused返回是否复用了缓存中的滤波器，失败返回nullptr
+     */
+    SwrContext *acquire(const Key &key, bool *reused = nullptr);
+    /**
+     * @brief 用完后放回缓存，超过容量时释放最久没用的
+     */
+    void release(const Key &key, SwrContext *ctx);
+    /**
+     * @brief 预先为常用参数建立滤波器
+     */
+    bool warm(const Key &key);
+    void setCapacity(int capacity);
+    void clear();
+    int size();
+
+private:
+    static SwrContext *_create(const Key &key);
+    void _trim();
+private:
+    std::mutex mutex;
+    int maxIdle;
+    /*空闲的context，最近放回的在前面*/
+    std::list<std::pair<Key, SwrContext *>> idle;
+};
+
+#endif // SWRPOOL_H
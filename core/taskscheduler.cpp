@@ -0,0 +1,160 @@
+#include "taskscheduler.h"
+#include <algorithm>
+#include <iterator>
+
+TaskScheduler::TaskScheduler(int workers) :
+    queued(0),
+    unfinished(0),
+    stealCount(0),
+    stopping(false)
+{
+    if(workers <= 0)
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    for(int i = 0; i < workers; ++i)
+        queues.emplace_back(new Worker);
+    for(int i = 0; i < workers; ++i)
+        threads.emplace_back(&TaskScheduler::_run, this, i);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    stop();
+}
+
+bool TaskScheduler::submit(const Task &task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(stopping)
+            return false;
+        injected.push_back(task);
+        ++unfinished;
+        ++queued;
+    }
+    wake.notify_one();
+    return true;
+}
+
+bool TaskScheduler::spawn(int worker, const Task &task)
+{
+    if(worker < 0 || worker >= workers())
+        return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(stopping)
+            return false;
+        ++unfinished;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+        queues[worker]->tasks.push_back(task);
+    }
+    _added();
+    return true;
+}
+
+void TaskScheduler::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this](){ return unfinished == 0;});
+}
+
+void TaskScheduler::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(stopping && threads.empty())
+            return;
+        stopping = true;
+    }
+    wake.notify_all();
+    /*正在执行的任务结束后线程退出，这期间拆出的子任务也在下面一起通知*/
+    for(auto &thread : threads)
+        thread.join();
+    threads.clear();
+
+    std::deque<Task> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dropped.swap(injected);
+    }
+    for(auto &queue : queues){
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        std::move(queue->tasks.begin(), queue->tasks.end(), std::back_inserter(dropped));
+        queue->tasks.clear();
+    }
+    queued = 0;
+    /*在锁外通知，任务里可以安全地做文件操作*/
+    for(auto &task : dropped)
+        task(-1);
+    std::lock_guard<std::mutex> lock(mutex);
+    unfinished -= dropped.size();
+    idle.notify_all();
+}
+
+bool TaskScheduler::_take(int worker, Task *task)
+{
+    /*自己队列的末尾是最近拆出的任务*/
+    {
+        Worker &own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty()){
+            *task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --queued;
+            return true;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!injected.empty()){
+            *task = std::move(injected.front());
+            injected.pop_front();
+            --queued;
+            return true;
+        }
+    }
+    /*从其它队列的开头窃取，和队列主人取的一端相反，很少争同一个任务*/
+    int count = workers();
+    for(int i = 1; i < count; ++i){
+        Worker &victim = *queues[(worker + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty()){
+            *task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --queued;
+            ++stealCount;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::_added()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++queued;
+    }
+    wake.notify_one();
+}
+
+void TaskScheduler::_run(int worker)
+{
+    for(;;){
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this](){ return stopping || queued > 0;});
+            if(stopping)
+                return;
+        }
+        Task task;
+        if(!_take(worker, &task))
+            continue;
+        task(worker);
+        /*计数在锁里减到0，wait不会错过通知*/
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--unfinished == 0)
+            idle.notify_all();
+    }
+}
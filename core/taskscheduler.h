@@ -0,0 +1,82 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 工作窃取的任务调度，用于大小悬殊的批量转换
+ * 外部提交的任务进公共队列，按提交顺序取；任务执行中用spawn拆出的子任务放进本线程自己的队列。
+ * 工作线程先取自己队列的末尾（刚拆出的），再取公共队列，都没有时从其它线程队列的开头窃取，
+ * 一个大文件拆成的各段因此会分散到所有空闲的线程上。
+ * 和JobQueue一样，任务收到执行它的工作线程序号，stop时还没开始的任务以-1调用一次
+ */
+class TaskScheduler
+{
+public:
+    typedef std::function<void(int worker)> Task;
+
+public:
+    /**
+     * @brief workers为0时取硬件线程数
+     */
+    explicit TaskScheduler(int workers = 0);
+    ~TaskScheduler();
+
+    /**
+     * @brief 放进公共队列，停止后返回false
+     */
+    bool submit(const Task &task);
+    /**
+     * @brief 只在worker线程执行的任务里调用，放进这个线程自己的队列末尾
+     */
+    bool spawn(int worker, const Task &task);
+    /**
+     * @brief 等待提交和拆出的任务全部完成
+     */
+    void wait();
+    /**
+     * @brief 不再接受任务，通知还没开始的任务，等待正在执行的任务结束
+     */
+    void stop();
+
+    int workers() const;
+    /**
+     * @brief 从其它线程队列窃取的次数
+     */
+    int64_t steals() const;
+
+private:
+    struct Worker{
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool _take(int worker, Task *task);
+    void _added();
+    void _run(int worker);
+private:
+    std::vector<std::unique_ptr<Worker>> queues;
+    std::vector<std::thread> threads;
+    /*保护公共队列、stopping和等待；queued和unfinished只在这个锁里增加，等待的线程不会错过通知*/
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<Task> injected;
+    /*所有队列里的任务数，和还没执行完的任务数*/
+    std::atomic<int64_t> queued;
+    std::atomic<int64_t> unfinished;
+    std::atomic<int64_t> stealCount;
+    bool stopping;
+};
+
+inline int TaskScheduler::workers() const                                       {   return (int)queues.size();}
+inline int64_t TaskScheduler::steals() const                                    {   return stealCount;}
+#endif // TASKSCHEDULER_H
@@ -0,0 +1,272 @@
+#include "waveformoverview.h"
+#include "audiokernels.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+namespace {
+const char peaksMagic[8] = {'P', 'C', 'M', 'P', 'E', 'A', 'K', 'S'};
+const uint32_t peaksVersion = 1;
+
+template<typename T>
+bool writeValue(FILE *fp, const T &value)
+{
+    return fwrite(&value, sizeof(T), 1, fp) == 1;
+}
+
+template<typename T>
+bool readValue(FILE *fp, T &value)
+{
+    return fread(&value, sizeof(T), 1, fp) == 1;
+}
+}
+
+WaveformOverview::WaveformOverview(int channels, int rate, int baseBlock)
+{
+    reset(channels, rate, baseBlock);
+}
+
+void WaveformOverview::reset(int channels, int rate, int baseBlock)
+{
+    nbChannels = std::max(channels, 1);
+    sampleRate = rate;
+    baseFrames = std::max(baseBlock, 1);
+    totalFrames = 0;
+    finished = false;
+    pyramid.clear();
+    pendingFrames = 0;
+    pendingMin.assign(nbChannels, 0);
+    pendingMax.assign(nbChannels, 0);
+    pendingSq.assign(nbChannels, 0);
+}
+
+void WaveformOverview::addBlock(const float *planar, int frames)
+{
+    if(finished || frames <= 0)
+        return;
+    int offset = 0;
+    while(offset < frames){
+        int n = (int)std::min<int64_t>(frames - offset, baseFrames - pendingFrames);
+        for(int c = 0; c < nbChannels; ++c){
+            float mn, mx;
+            double sq;
+            AudioKernels::minMaxSumSq(planar + (int64_t)c * frames + offset, n, &mn, &mx, &sq);
+            if(pendingFrames == 0){
+                pendingMin[c] = mn;
+                pendingMax[c] = mx;
+                pendingSq[c] = sq;
+            }
+            else{
+                pendingMin[c] = std::min(pendingMin[c], mn);
+                pendingMax[c] = std::max(pendingMax[c], mx);
+                pendingSq[c] += sq;
+            }
+        }
+        pendingFrames += n;
+        totalFrames += n;
+        offset += n;
+        if(pendingFrames == baseFrames){
+            std::vector<float> sq(pendingSq.begin(), pendingSq.end());
+            _pushBin(0, pendingMin.data(), pendingMax.data(), sq.data());
+            pendingFrames = 0;
+        }
+    }
+}
+
+void WaveformOverview::finish()
+{
+    if(finished)
+        return;
+    if(pendingFrames > 0){
+        std::vector<float> sq(pendingSq.begin(), pendingSq.end());
+        _pushBin(0, pendingMin.data(), pendingMax.data(), sq.data());
+        pendingFrames = 0;
+    }
+    /*每层没有配对的尾部bin向上合并，保证最顶层只有一个bin覆盖整个文件*/
+    for(int level = 0; level < levels(); ++level){
+        int64_t count = pyramid[level].count;
+        if(count <= 1)
+            break;
+        int64_t covered = level + 1 < levels() ? pyramid[level + 1].count * 2 : 0;
+        if(count > covered)
+            _mergeTail(level, covered, count - covered);
+    }
+    finished = true;
+}
+
+int64_t WaveformOverview::binFrames(int level) const
+{
+    return (int64_t)baseFrames << level;
+}
+
+int WaveformOverview::levelForZoom(double framesPerPixel) const
+{
+    int level = 0;
+    while(level + 1 < levels() && binFrames(level + 1) <= framesPerPixel)
+        ++level;
+    return level;
+}
+
+std::vector<WaveformOverview::Bin> WaveformOverview::query(int channel, int64_t startFrame,
+                                                           int64_t endFrame, int pixels) const
+{
+    std::vector<Bin> result(std::max(pixels, 0), Bin{0, 0, 0});
+    if(pixels <= 0 || pyramid.empty() || channel < 0 || channel >= nbChannels)
+        return result;
+    startFrame = std::max<int64_t>(startFrame, 0);
+    endFrame = std::min(endFrame, totalFrames);
+    if(endFrame <= startFrame)
+        return result;
+
+    double fpp = (double)(endFrame - startFrame) / pixels;
+    int level = levelForZoom(fpp);
+    const Level &l = pyramid[level];
+    for(int p = 0; p < pixels; ++p){
+        int64_t a = startFrame + (int64_t)(p * fpp);
+        int64_t b = std::max(startFrame + (int64_t)((p + 1) * fpp), a + 1);
+        int64_t first = a / l.binFrames;
+        int64_t last = std::min((b - 1) / l.binFrames, l.count - 1);
+        if(first > last)
+            continue;
+        float mn = l.min[first * nbChannels + channel];
+        float mx = l.max[first * nbChannels + channel];
+        double sq = 0;
+        int64_t n = 0;
+        for(int64_t i = first; i <= last; ++i){
+            mn = std::min(mn, l.min[i * nbChannels + channel]);
+            mx = std::max(mx, l.max[i * nbChannels + channel]);
+            sq += l.sumSq[i * nbChannels + channel];
+            n += _binLength(level, i);
+        }
+        result[p].min = mn;
+        result[p].max = mx;
+        result[p].rms = n > 0 ? (float)sqrt(sq / n) : 0.0f;
+    }
+    return result;
+}
+
+bool WaveformOverview::save(const std::string &path, int64_t sourceSize, uint32_t sourceTag) const
+{
+    if(!finished)
+        return false;
+    FILE *fp = fopen(path.c_str(), "wb");
+    if(fp == nullptr)
+        return false;
+    bool ok = fwrite(peaksMagic, sizeof(peaksMagic), 1, fp) == 1
+            && writeValue(fp, peaksVersion)
+            && writeValue<uint32_t>(fp, nbChannels)
+            && writeValue<uint32_t>(fp, sampleRate)
+            && writeValue<uint32_t>(fp, baseFrames)
+            && writeValue(fp, totalFrames)
+            && writeValue(fp, sourceSize)
+            && writeValue(fp, sourceTag)
+            && writeValue<uint32_t>(fp, levels());
+    for(int i = 0; ok && i < levels(); ++i){
+        const Level &l = pyramid[i];
+        size_t n = (size_t)l.count * nbChannels;
+        ok = writeValue(fp, l.count)
+                && fwrite(l.min.data(), sizeof(float), n, fp) == n
+                && fwrite(l.max.data(), sizeof(float), n, fp) == n
+                && fwrite(l.sumSq.data(), sizeof(float), n, fp) == n;
+    }
+    ok = fclose(fp) == 0 && ok;
+    if(!ok)
+        remove(path.c_str());
+    return ok;
+}
+
+bool WaveformOverview::load(const std::string &path, int64_t sourceSize, uint32_t sourceTag)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    if(fp == nullptr)
+        return false;
+    char magic[8];
+    uint32_t version, channels, rate, base, tag, nbLevels;
+    int64_t frames, size;
+    bool ok = fread(magic, sizeof(magic), 1, fp) == 1
+            && memcmp(magic, peaksMagic, sizeof(magic)) == 0
+            && readValue(fp, version) && version == peaksVersion
+            && readValue(fp, channels) && channels > 0 && channels <= 64
+            && readValue(fp, rate)
+            && readValue(fp, base) && base > 0
+            && readValue(fp, frames) && frames >= 0
+            && readValue(fp, size) && size == sourceSize
+            && readValue(fp, tag) && tag == sourceTag
+            && readValue(fp, nbLevels) && nbLevels <= 63;
+    if(ok){
+        reset(channels, rate, base);
+        totalFrames = frames;
+        pyramid.resize(nbLevels);
+    }
+    for(uint32_t i = 0; ok && i < nbLevels; ++i){
+        Level &l = pyramid[i];
+        l.binFrames = binFrames(i);
+        ok = readValue(fp, l.count) && l.count >= 0
+                && l.count <= (frames + l.binFrames - 1) / l.binFrames;
+        if(!ok)
+            break;
+        size_t n = (size_t)l.count * nbChannels;
+        l.min.resize(n);
+        l.max.resize(n);
+        l.sumSq.resize(n);
+        ok = fread(l.min.data(), sizeof(float), n, fp) == n
+                && fread(l.max.data(), sizeof(float), n, fp) == n
+                && fread(l.sumSq.data(), sizeof(float), n, fp) == n;
+    }
+    fclose(fp);
+    if(!ok){
+        reset(nbChannels, sampleRate, baseFrames);
+        return false;
+    }
+    finished = true;
+    return true;
+}
+
+void WaveformOverview::_pushBin(int level, const float *min, const float *max, const float *sumSq)
+{
+    _reserveLevel(level);
+    Level &l = pyramid[level];
+    l.min.insert(l.min.end(), min, min + nbChannels);
+    l.max.insert(l.max.end(), max, max + nbChannels);
+    l.sumSq.insert(l.sumSq.end(), sumSq, sumSq + nbChannels);
+    ++l.count;
+    /*凑齐一对就立即合并到上一层，整个金字塔在一次读取中建立完成*/
+    if(!finished && l.count % 2 == 0)
+        _mergeTail(level, l.count - 2, 2);
+}
+
+void WaveformOverview::_mergeTail(int level, int64_t first, int64_t n)
+{
+    std::vector<float> mn(nbChannels), mx(nbChannels), sq(nbChannels);
+    {
+        const Level &l = pyramid[level];
+        for(int c = 0; c < nbChannels; ++c){
+            mn[c] = l.min[first * nbChannels + c];
+            mx[c] = l.max[first * nbChannels + c];
+            sq[c] = 0;
+            for(int64_t i = first; i < first + n; ++i){
+                mn[c] = std::min(mn[c], l.min[i * nbChannels + c]);
+                mx[c] = std::max(mx[c], l.max[i * nbChannels + c]);
+                sq[c] += l.sumSq[i * nbChannels + c];
+            }
+        }
+    }
+    _pushBin(level + 1, mn.data(), mx.data(), sq.data());
+}
+
+int64_t WaveformOverview::_binLength(int level, int64_t bin) const
+{
+    int64_t len = binFrames(level);
+    return std::min(len, totalFrames - bin * len);
+}
+
+void WaveformOverview::_reserveLevel(int level)
+{
+    while(levels() <= level){
+        Level l;
+        l.binFrames = binFrames(levels());
+        l.count = 0;
+        pyramid.push_back(l);
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef WAVEFORMOVERVIEW_H
+#define WAVEFORMOVERVIEW_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 多分辨率波形概览（min/max/RMS金字塔）
+ * 第0层每个bin覆盖baseBlock帧，之后每层合并上一层相邻的两个bin，
+ * 数据在转换时一边读取一边累加，结束后可以保存为旁路文件（*.peaks），
+ * 界面按任意缩放比例取数据时只需O(像素数)的开销，不用再读音频
+ */
+class WaveformOverview
+{
+public:
+    struct Bin{
+        float min;
+        float max;
+        float rms;
+    };
+
+public:
+    explicit WaveformOverview(int channels = 1, int rate = 48000, int baseBlock = 256);
+
+    void reset(int channels, int rate, int baseBlock = 256);
+    /**
+     * @brief 追加一块按声道分开的float数据，每个声道frames个样本
+     */
+    void addBlock(const float *planar, int frames);
+    /**
+     * @brief 把未满的bin和各层奇数尾部合并上去，之后才可以查询或保存
+     */
+    void finish();
+
+    int channels() const;
+    int rate() const;
+    int levels() const;
+    int64_t frames() const;
+    int64_t binFrames(int level) const;
+    bool isFinished() const;
+    /**
+     * @brief 选择bin宽度不超过framesPerPixel的最粗一层
+     */
+    int levelForZoom(double framesPerPixel) const;
+    /**
+     * @brief 将[startFrame,endFrame)映射到pixels个像素，每个像素一个Bin
+     */
+    std::vector<Bin> query(int channel, int64_t startFrame, int64_t endFrame, int pixels) const;
+
+    /**
+     * @brief 旁路文件读写，sourceSize和sourceTag用来判断缓存是否还对应源文件
+     */
+    bool save(const std::string &path, int64_t sourceSize, uint32_t sourceTag) const;
+    bool load(const std::string &path, int64_t sourceSize, uint32_t sourceTag);
+
+private:
+    struct Level{
+        int64_t binFrames;
+        /*按bin存放，下标为 bin * channels + channel*/
+        std::vector<float> min;
+        std::vector<float> max;
+        std::vector<float> sumSq;
+        int64_t count;
+    };
+
+    void _pushBin(int level, const float *min, const float *max, const float *sumSq);
+    void _mergeTail(int level, int64_t first, int64_t n);
+    int64_t _binLength(int level, int64_t bin) const;
+    void _reserveLevel(int level);
+private:
+    int nbChannels;
+    int sampleRate;
+    int baseFrames;
+    int64_t totalFrames;
+    bool finished;
+    std::vector<Level> pyramid;
+    /*第0层正在累加的bin*/
+    int64_t pendingFrames;
+    std::vector<float> pendingMin;
+    std::vector<float> pendingMax;
+    std::vector<double> pendingSq;
+};
+
+inline int WaveformOverview::channels() const                                   {   return nbChannels;}
+inline int WaveformOverview::rate() const                                       {   return sampleRate;}
+inline int WaveformOverview::levels() const                                     {   return (int)pyramid.size();}
+inline int64_t WaveformOverview::frames() const                                 {   return totalFrames;}
+inline bool WaveformOverview::isFinished() const                                {   return finished;}
+#endif // WAVEFORMOVERVIEW_H
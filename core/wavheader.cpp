@@ -0,0 +1,200 @@
+#include "wavheader.h"
+#include <string.h>
+extern "C"{
+#include "libavutil/channel_layout.h"
+}
+
+namespace {
+
+/*WAVE_FORMAT_EXTENSIBLE的SubFormat GUID，前两个字节为格式标签*/
+const uint8_t subFormatGuid[16] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+    0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+};
+
+/*WAV的SPEAKER_*位定义和AV_CH_*的前18位一致*/
+const uint64_t speakerMaskBits = 0x3FFFF;
+
+void put16(std::vector<uint8_t> &out, uint16_t v)
+{
+    out.push_back(v & 0xFF);
+    out.push_back(v >> 8);
+}
+
+void put32(std::vector<uint8_t> &out, uint32_t v)
+{
+    for(int i = 0; i < 4; ++i)
+        out.push_back((v >> (8 * i)) & 0xFF);
+}
+
+void put64(std::vector<uint8_t> &out, uint64_t v)
+{
+    put32(out, (uint32_t)v);
+    put32(out, (uint32_t)(v >> 32));
+}
+
+void putTag(std::vector<uint8_t> &out, const char *tag)
+{
+    out.insert(out.end(), tag, tag + 4);
+}
+
+}
+
+WavFormat WavFormat::fromSampleFormat(AVSampleFormat format, uint64_t layout, int rate)
+{
+    WavFormat f;
+    f.layout = layout;
+    f.channels = av_get_channel_layout_nb_channels(layout);
+    f.sampleRate = rate;
+    f.bitsPerSample = av_get_bytes_per_sample(format) * 8;
+    f.validBits = f.bitsPerSample;
+    auto packed = av_get_packed_sample_fmt(format);
+    f.isFloat = packed == AV_SAMPLE_FMT_FLT || packed == AV_SAMPLE_FMT_DBL;
+    return f;
+}
+
+int WavFormat::blockAlign() const
+{
+    return channels * bitsPerSample / 8;
+}
+
+bool WavFormat::needExtensible() const
+{
+    if(channels > 2 || (bitsPerSample > 16 && !isFloat) || validBits != bitsPerSample)
+        return true;
+    uint64_t standard = av_get_default_channel_layout(channels);
+    return layout != 0 && layout != (uint64_t)standard;
+}
+
+uint32_t WavFormat::channelMask() const
+{
+    /*超出WAV定义范围的声道位置无法表示，写0表示不指定*/
+    if(layout & ~speakerMaskBits)
+        return 0;
+    return (uint32_t)layout;
+}
+
+std::vector<uint8_t> WavHeader::build(const WavFormat &format, uint32_t dataSize)
+{
+    /*非PCM格式需要fact块记录总帧数*/
+    bool hasFact = formatTag(format) != PCM;
+    uint32_t pad = dataSize & 1;
+    auto fmt = fmtChunk(format);
+
+    std::vector<uint8_t> out;
+    out.reserve(80);
+    putTag(out, "RIFF");
+    put32(out, 0);
+    putTag(out, "WAVE");
+
+    putTag(out, "fmt ");
+    put32(out, fmt.size());
+    out.insert(out.end(), fmt.begin(), fmt.end());
+
+    if(hasFact){
+        putTag(out, "fact");
+        put32(out, 4);
+        put32(out, format.blockAlign() > 0 ? dataSize / format.blockAlign() : 0);
+    }
+
+    putTag(out, "data");
+    put32(out, dataSize);
+
+    /*RIFF块长度不含开头的8个字节*/
+    uint64_t riffSize = (uint64_t)out.size() - 8 + dataSize + pad;
+    uint32_t size = riffSize > 0xFFFFFFFFULL ? 0xFFFFFFFFU : (uint32_t)riffSize;
+    memcpy(out.data() + 4, &size, 4);
+    return out;
+}
+
+std::vector<uint8_t> WavHeader::buildStreaming(const WavFormat &format)
+{
+    /*data块总在最后，长度是最后4个字节；fact块的帧数无法预知，保留0*/
+    auto out = build(format, 0);
+    uint32_t unknown = 0xFFFFFFFFU;
+    memcpy(out.data() + 4, &unknown, 4);
+    memcpy(out.data() + out.size() - 4, &unknown, 4);
+    return out;
+}
+
+std::vector<uint8_t> WavHeader::buildRf64(const WavFormat &format, uint64_t dataSize)
+{
+    /*ds64块：RIFF长度、data长度、总帧数各8字节，加4字节的表项数*/
+    const uint32_t ds64Size = 28;
+    uint64_t pad = dataSize & 1;
+    auto base = build(format, 0);
+    uint64_t riffSize = base.size() + 8 + ds64Size - 8 + dataSize + pad;
+    bool large = riffSize > 0xFFFFFFFFULL;
+    if(!large)
+        base = build(format, (uint32_t)dataSize);
+
+    std::vector<uint8_t> out(base.begin(), base.begin() + 12);
+    if(large){
+        memcpy(out.data(), "RF64", 4);
+        putTag(out, "ds64");
+        put32(out, ds64Size);
+        put64(out, riffSize);
+        put64(out, dataSize);
+        put64(out, format.blockAlign() > 0 ? dataSize / format.blockAlign() : 0);
+        put32(out, 0);
+    }
+    else{
+        putTag(out, "JUNK");
+        put32(out, ds64Size);
+        out.resize(out.size() + ds64Size, 0);
+    }
+    out.insert(out.end(), base.begin() + 12, base.end());
+
+    /*超过4GB时32位的长度都写0xFFFFFFFF，以ds64里的为准*/
+    uint32_t size = large ? 0xFFFFFFFFU : (uint32_t)riffSize;
+    memcpy(out.data() + 4, &size, 4);
+    if(large){
+        uint32_t unknown = 0xFFFFFFFFU;
+        memcpy(out.data() + out.size() - 4, &unknown, 4);
+        for(size_t pos = 12; pos + 12 <= out.size(); ){
+            uint32_t chunk;
+            memcpy(&chunk, out.data() + pos + 4, 4);
+            if(memcmp(out.data() + pos, "fact", 4) == 0){
+                memcpy(out.data() + pos + 8, &unknown, 4);
+                break;
+            }
+            pos += 8 + chunk;
+        }
+    }
+    return out;
+}
+
+std::vector<uint8_t> WavHeader::fmtChunk(const WavFormat &format)
+{
+    bool extensible = format.needExtensible();
+    uint16_t tag = formatTag(format);
+    uint32_t fmtSize = extensible ? 40 : (format.isFloat ? 18 : 16);
+
+    std::vector<uint8_t> out;
+    out.reserve(fmtSize);
+    put16(out, extensible ? (uint16_t)Extensible : tag);
+    put16(out, format.channels);
+    put32(out, format.sampleRate);
+    put32(out, format.sampleRate * format.blockAlign());
+    put16(out, format.blockAlign());
+    put16(out, format.bitsPerSample);
+    if(fmtSize > 16)
+        put16(out, extensible ? 22 : 0);
+    if(extensible){
+        put16(out, format.validBits);
+        put32(out, format.channelMask());
+        put16(out, tag);
+        out.insert(out.end(), subFormatGuid + 2, subFormatGuid + 16);
+    }
+    return out;
+}
+
+uint16_t WavHeader::formatTag(const WavFormat &format)
+{
+    return format.isFloat ? IEEEFloat : PCM;
+}
+
+bool WavHeader::isBaseSubFormat(const uint8_t *guid)
+{
+    return memcmp(guid + 2, subFormatGuid + 2, 14) == 0;
+}
@@ -0,0 +1,70 @@
+#ifndef WAVHEADER_H
+#define WAVHEADER_H
+
+#include <stdint.h>
+#include <vector>
+extern "C"{
+#include "libavutil/samplefmt.h"
+}
+
+/**
+ * @brief WAV文件头的参数
+ * 由输出的采样格式、声道布局和采样率得到，决定格式标签和是否使用WAVE_FORMAT_EXTENSIBLE
+ */
+struct WavFormat{
+    int channels;
+    uint64_t layout;
+    int sampleRate;
+    /*每个样本在文件中占的位数，以及其中有效的位数*/
+    int bitsPerSample;
+    int validBits;
+    bool isFloat;
+
+    static WavFormat fromSampleFormat(AVSampleFormat format, uint64_t layout, int rate);
+    int blockAlign() const;
+    /**
+     * @brief 超过两个声道、超过16位或者声道位置不是默认布局时需要EXTENSIBLE
+     */
+    bool needExtensible() const;
+    uint32_t channelMask() const;
+};
+
+namespace WavHeader {
+
+enum FormatTag{
+    PCM = 0x0001,
+    IEEEFloat = 0x0003,
+    Extensible = 0xFFFE
+};
+
+/**
+ * @brief 生成完整的文件头，紧接着就是data块的数据
+ * 浮点格式会附带fact块；dataSize为奇数时按RIFF要求计入结尾的填充字节
+ */
+std::vector<uint8_t> build(const WavFormat &format, uint32_t dataSize);
+/**
+ * @brief 长度未知时的文件头，用于写到管道
+ * RIFF和data块长度写0xFFFFFFFF，读取方按读到文件结尾处理
+ */
+std::vector<uint8_t> buildStreaming(const WavFormat &format);
+/**
+ * @brief RF64（EBU Tech 3306）文件头，长度不随dataSize变化
+ * 不超过4GB时是普通WAV，在fmt前留一个JUNK块；超过时JUNK改为ds64块存放64位长度，RIFF改为RF64
+ */
+std::vector<uint8_t> buildRf64(const WavFormat &format, uint64_t dataSize);
+/**
+ * @brief fmt块的内容（不含块标识和长度），W64等使用相同格式描述的封装共用
+ */
+std::vector<uint8_t> fmtChunk(const WavFormat &format);
+/**
+ * @brief 格式标签，EXTENSIBLE时为SubFormat中的标签
+ */
+uint16_t formatTag(const WavFormat &format);
+/**
+ * @brief SubFormat除前两个字节的标签外是否为KSDATAFORMAT_SUBTYPE_*的公共部分，不是时标签没有意义
+ */
+bool isBaseSubFormat(const uint8_t *guid);
+
+}
+
+#endif // WAVHEADER_H
@@ -0,0 +1,435 @@
+#include "mainwindow.h"
+#include "ui_mainwindow.h"
+#include <QFileDialog>
+#include <QUrl>
+#include <QTime>
+
+MainWindow::MainWindow(QWidget *parent) :
+    QMainWindow(parent),
+    ui(new Ui::MainWindow)
+{
+    ui->setupUi(this);
+    initLayoutBox(ui->srcLayoutBox);
+    initLayoutBox(ui->dstLayoutBox);
+
+    /*转换参数按值随信号传到工作线程*/
+    qRegisterMetaType<ConversionConfig>("ConversionConfig");
+    connect(&pcmAudio,&PCMAudio::debugMsg,this,&MainWindow::rcvDebug);
+    connect(&pcmAudio,&PCMAudio::progress,this,&MainWindow::updateProgress);
+    connect(&pcmAudio,&PCMAudio::finish,this,&MainWindow::resampleResult);
+    connect(&pcmAudio,&PCMAudio::cancelled,this,&MainWindow::resampleCancelled);
+    connect(this,&MainWindow::startChange,&pcmAudio,&PCMAudio::startChange);
+    /*转换期间工作线程不处理事件，停止要直接调用*/
+    connect(this,&MainWindow::stopChange,&pcmAudio,&PCMAudio::stopChange,Qt::DirectConnection);
+    pcmAudio.moveToThread(&thread);
+    thread.start();
+}
+
+MainWindow::~MainWindow()
+{
+    if(thread.isRunning()){
+        thread.exit();
+        thread.wait(5 * 1000);
+    }
+    delete ui;
+}
+
+int MainWindow::getSrcSampleRate()
+{
+    if(ui->srcRate48000->isChecked())
+        return 48000;
+    else if(ui->srcRate44100->isChecked())
+        return 44100;
+    else if(ui->srcRate22050->isChecked())
+        return 22050;
+    else
+        return 48000;
+}
+
+int MainWindow::getDstSampleRate()
+{
+    if(ui->dstRate48000->isChecked())
+        return 48000;
+    else if(ui->dstRate44100->isChecked())
+        return 44100;
+    else if(ui->dstRate22050->isChecked())
+        return 22050;
+    else
+        return 48000;
+}
+
+AVSampleFormat MainWindow::getSrcFormat()
+{
+    if(ui->srcDouble->isChecked()){
+        return AV_SAMPLE_FMT_DBL;
+    }
+    else if(ui->srcFloat->isChecked())
+        return AV_SAMPLE_FMT_FLT;
+    else if(ui->srcInt32->isChecked() || ui->srcInt24->isChecked())
+        return AV_SAMPLE_FMT_S32;
+    else if(ui->srcInt16->isChecked() || ui->srcALaw->isChecked() || ui->srcMuLaw->isChecked())
+        return AV_SAMPLE_FMT_S16;
+    else if(ui->srcUint8->isChecked())
+        return AV_SAMPLE_FMT_U8;
+    else
+        return AV_SAMPLE_FMT_S16;
+}
+
+AVSampleFormat MainWindow::getDstFormat()
+{
+    if(ui->dstDouble->isChecked()){
+        return AV_SAMPLE_FMT_DBL;
+    }
+    else if(ui->dstFloat->isChecked())
+        return AV_SAMPLE_FMT_FLT;
+    else if(ui->dstInt32->isChecked() || ui->dstInt24->isChecked())
+        return AV_SAMPLE_FMT_S32;
+    else if(ui->dstInt16->isChecked())
+        return AV_SAMPLE_FMT_S16;
+    else if(ui->dstUint8->isChecked())
+        return AV_SAMPLE_FMT_U8;
+    else
+        return AV_SAMPLE_FMT_S16;
+}
+
+SampleCodec::Coding MainWindow::getSrcCoding()
+{
+    bool bigEndian = ui->srcBigEndianCheckBox->isChecked();
+    if(ui->srcALaw->isChecked())
+        return SampleCodec::ALaw;
+    else if(ui->srcMuLaw->isChecked())
+        return SampleCodec::MuLaw;
+    else if(ui->srcInt24->isChecked())
+        return bigEndian ? SampleCodec::Packed24BE : SampleCodec::Packed24;
+    else
+        return bigEndian ? SampleCodec::BigEndian : SampleCodec::Native;
+}
+
+SampleCodec::Coding MainWindow::getDstCoding()
+{
+    return ui->dstInt24->isChecked() ? SampleCodec::Packed24 : SampleCodec::Native;
+}
+
+ResamplerOptions::Dither MainWindow::getDither()
+{
+    /*和ditherBox的顺序一致*/
+    static const ResamplerOptions::Dither methods[] = {
+        ResamplerOptions::NoDither,
+        ResamplerOptions::Rectangular,
+        ResamplerOptions::Triangular,
+        ResamplerOptions::TriangularHighpass,
+        ResamplerOptions::Lipshitz,
+        ResamplerOptions::FWeighted,
+        ResamplerOptions::ModifiedEWeighted,
+        ResamplerOptions::ImprovedEWeighted,
+        ResamplerOptions::Shibata,
+        ResamplerOptions::LowShibata,
+        ResamplerOptions::HighShibata
+    };
+    int index = ui->ditherBox->currentIndex();
+    if(index < 0 || index >= (int)(sizeof(methods) / sizeof(methods[0])))
+        return ResamplerOptions::NoDither;
+    return methods[index];
+}
+
+int MainWindow::getSrcChannels()
+{
+    return av_get_channel_layout_nb_channels(getSrcLayout());
+}
+
+int MainWindow::getDstChannels()
+{
+    return av_get_channel_layout_nb_channels(getDstLayout());
+}
+
+int64_t MainWindow::getSrcLayout()
+{
+    return ui->srcLayoutBox->currentData().toLongLong();
+}
+
+int64_t MainWindow::getDstLayout()
+{
+    return ui->dstLayoutBox->currentData().toLongLong();
+}
+
+void MainWindow::setSrcFormat(AVSampleFormat format)
+{
+    switch(format){
+    case AV_SAMPLE_FMT_DBL:
+        ui->srcDouble->setChecked(true);
+        break;
+    case AV_SAMPLE_FMT_FLT:
+        ui->srcFloat->setChecked(true);
+        break;
+    case AV_SAMPLE_FMT_S32:
+        ui->srcInt32->setChecked(true);
+        break;
+    case AV_SAMPLE_FMT_U8:
+        ui->srcUint8->setChecked(true);
+        break;
+    case AV_SAMPLE_FMT_S16:
+    default:
+        ui->srcInt16->setChecked(true);
+    }
+}
+
+void MainWindow::setSrcChannels(int channels)
+{
+    auto index = ui->srcLayoutBox->findData((qlonglong)av_get_default_channel_layout(channels));
+    if(index >= 0)
+        ui->srcLayoutBox->setCurrentIndex(index);
+}
+
+PCMAudio::FileType MainWindow::getDstType()
+{
+    if(ui->pcmTypeButton->isChecked())
+        return PCMAudio::PCM;
+    else if(ui->wavTypeButton->isChecked())
+        return PCMAudio::WAV;
+    else if(ui->aiffTypeButton->isChecked())
+        return PCMAudio::AIFF;
+    else if(ui->aifcTypeButton->isChecked())
+        return PCMAudio::AIFC;
+    else if(ui->cafTypeButton->isChecked())
+        return PCMAudio::CAF;
+    else if(ui->w64TypeButton->isChecked())
+        return PCMAudio::W64;
+    else
+        return PCMAudio::OTHER;
+}
+
+bool MainWindow::getConfig(ConversionConfig *config)
+{
+    config->srcFormat = getSrcFormat();
+    config->srcRate = getSrcSampleRate();
+    config->srcLayout = getSrcLayout();
+    config->srcCoding = getSrcCoding();
+    config->dstFormat = getDstFormat();
+    config->dstRate = getDstSampleRate();
+    config->dstLayout = getDstLayout();
+    config->dstCoding = getDstCoding();
+    config->container = PCMAudio::containerType(getDstType());
+    config->quality = (ResamplerOptions::Quality)ui->resampleQualityBox->currentIndex();
+    config->backend = ui->polyphaseCheckBox->isChecked() ? ResamplerOptions::Polyphase
+                                                         : ResamplerOptions::Swresample;
+    auto dither = getDither();
+    config->dither = dither != ResamplerOptions::NoDither;
+    config->ditherMethod = dither;
+    config->ditherScale = ui->ditherScaleBox->value();
+    config->measureLoudness = ui->measureLoudnessCheckBox->isChecked();
+    config->normalize = ui->normalizeCheckBox->isChecked();
+    config->targetLoudness = ui->targetLoudnessBox->value();
+    config->trimSilence = ui->trimSilenceCheckBox->isChecked();
+    config->silenceThreshold = ui->silenceThresholdBox->value();
+    config->silenceMinDuration = ui->silenceMinBox->value();
+    config->silenceMaxGap = ui->silenceGapBox->value();
+    /*勾选时每60秒提交一次断点，停止后可以续转*/
+    config->checkpointInterval = ui->resumeCheckBox->isChecked() ? 60 : 0;
+    return config->setChannelMap(ui->channelMapEdit->text().toStdString());
+}
+
+void MainWindow::on_pathSelectButton_clicked(bool)
+{
+    QUrl url = QFileDialog::getOpenFileUrl(this,"select audio file");
+    ui->srcPathLineEdit->setText(url.toString(QUrl::PreferLocalFile));
+    pcmAudio.setFilePath(url);
+
+    ui->playButton->setEnabled(true);
+    ui->testButton->setEnabled(false);
+    ui->playButton->setText("play");
+    auto type = pcmAudio.getType();
+    switch(type){
+    case PCMAudio::Error:
+        ui->playButton->setEnabled(false);
+        break;
+    case PCMAudio::WAV:
+    case PCMAudio::AIFF:
+    case PCMAudio::AIFC:
+    case PCMAudio::CAF:
+    case PCMAudio::W64:
+    {
+        /*格式来自文件头，界面只做显示*/
+        ui->inputGroup->setEnabled(false);
+        AVSampleFormat format;
+        SampleCodec::Coding coding;
+        auto &info = pcmAudio.getSrcInfo();
+        if(info.toSampleFormat(&format,&coding))
+            setSrcFormat(format);
+        auto index = ui->srcLayoutBox->findData((qlonglong)info.layout);
+        if(index >= 0)
+            ui->srcLayoutBox->setCurrentIndex(index);
+        break;
+    }
+    case PCMAudio::PCM:
+        ui->inputGroup->setEnabled(true);
+        detectSrcFormat();
+        break;
+    case PCMAudio::OTHER:
+        break;
+    }
+}
+
+void MainWindow::on_playButton_clicked(bool)
+{
+    if(ui->playButton->text() == "play"){
+        ui->playButton->setText("stop");
+        ui->startButton->setEnabled(false);
+        ui->pathSelectButton->setEnabled(false);
+        pcmAudio.playMusic(true,getSrcSampleRate(),getSrcFormat(),getSrcCoding(),getSrcChannels());
+    }
+    else{
+        ui->playButton->setText("play");
+        ui->startButton->setEnabled(true);
+        ui->pathSelectButton->setEnabled(true);
+        pcmAudio.stopMusic();
+    }
+}
+
+void MainWindow::on_testButton_clicked(bool)
+{
+    if(ui->testButton->text() == "test"){
+        ui->testButton->setText("stop");
+        ui->startButton->setEnabled(false);
+        ui->playButton->setEnabled(false);
+        ui->pathSelectButton->setEnabled(false);
+        pcmAudio.playMusic(false,getDstSampleRate(),getDstFormat(),SampleCodec::Native,getDstChannels());
+    }
+    else{
+        ui->testButton->setText("test");
+        ui->startButton->setEnabled(true);
+        ui->playButton->setEnabled(true);
+        ui->pathSelectButton->setEnabled(true);
+        pcmAudio.stopMusic();
+    }
+}
+
+void MainWindow::on_startButton_clicked(bool)
+{
+    if(ui->startButton->text() == "start"){
+        ConversionConfig config;
+        if(!getConfig(&config)){
+            rcvDebug("channel map format error");
+            return;
+        }
+        ui->startButton->setText("stop");
+        setChanging(true);
+        pcmAudio.prepareChange();
+        emit startChange(pcmAudio.getFilePath(),config);
+    }
+    else{
+        /*等工作线程返回cancelled之后才能再次开始*/
+        ui->startButton->setText("start");
+        ui->startButton->setEnabled(false);
+        emit stopChange();
+    }
+
+}
+
+void MainWindow::on_recordButton_clicked(bool)
+{
+    if(ui->recordButton->text() == "record"){
+        if(!pcmAudio.startRecord({getSrcFormat(),getSrcLayout(),getSrcSampleRate()},
+                                 {getDstFormat(),getDstLayout(),getDstSampleRate()},
+                                 getDstCoding(),PCMAudio::containerType(getDstType()),
+                                 (ResamplerOptions::Quality)ui->resampleQualityBox->currentIndex()))
+            return;
+        ui->recordButton->setText("stop");
+        ui->startButton->setEnabled(false);
+        ui->playButton->setEnabled(false);
+        ui->pathSelectButton->setEnabled(false);
+    }
+    else{
+        ui->recordButton->setText("record");
+        ui->startButton->setEnabled(true);
+        ui->pathSelectButton->setEnabled(true);
+        pcmAudio.stopRecord();
+    }
+}
+
+void MainWindow::setChanging(bool changing)
+{
+    /*转换期间不能换文件、播放或录音，停止后等工作线程返回才恢复*/
+    ui->pathSelectButton->setEnabled(!changing);
+    bool playable = !pcmAudio.getFilePath().isEmpty() && pcmAudio.getType() != PCMAudio::Error;
+    ui->playButton->setEnabled(!changing && playable);
+    ui->testButton->setEnabled(false);
+    ui->recordButton->setEnabled(!changing);
+    if(!changing)
+        ui->startButton->setEnabled(true);
+}
+
+void MainWindow::initLayoutBox(QComboBox *box)
+{
+    /*ffmpeg内置的标准布局*/
+    uint64_t layout;
+    const char *name;
+    for(unsigned i = 0;av_get_standard_channel_layout(i,&layout,&name) == 0;++i){
+        box->addItem(QString("%1 (%2 ch)").arg(name).arg(av_get_channel_layout_nb_channels(layout)),
+                     (qlonglong)layout);
+    }
+    /*一到三阶Ambisonics的声道没有对应的扬声器位置，按顺序占用前N个位置，跳过LFE以免被特殊处理*/
+    for(int channels : {4,9,16}){
+        uint64_t discrete = 0;
+        for(int bit = 0,n = 0;n < channels;++bit){
+            if((1ULL << bit) == AV_CH_LOW_FREQUENCY)
+                continue;
+            discrete |= 1ULL << bit;
+            ++n;
+        }
+        box->addItem(QString("discrete (%1 ch)").arg(channels),(qlonglong)discrete);
+    }
+    box->setCurrentIndex(box->findData((qlonglong)AV_CH_LAYOUT_STEREO));
+}
+
+void MainWindow::detectSrcFormat()
+{
+    auto guesses = pcmAudio.detectFormat();
+    if(guesses.empty() || guesses.front().score <= 0){
+        rcvDebug("无法判断PCM格式，请手动选择");
+        return;
+    }
+    QString msg("format guess:");
+    for(size_t i = 0;i < guesses.size() && i < 3;++i)
+        msg += "\n  " + QString::fromStdString(FormatDetector::describe(guesses[i]));
+    rcvDebug(msg);
+
+    auto best = guesses.front();
+    ui->srcBigEndianCheckBox->setChecked(best.bigEndian);
+    setSrcFormat(best.format);
+    setSrcChannels(best.channels);
+}
+
+void MainWindow::rcvDebug(const QString &msg)
+{
+    QString str("[%1]%2");
+    ui->debugText->append(str.arg(QTime::currentTime().toString()).arg(msg));
+}
+
+void MainWindow::updateProgress(int finish, int total)
+{
+    if(ui->progressBar->maximum() != total)
+        ui->progressBar->setMaximum(total);
+    ui->progressBar->setValue(finish);
+}
+
+void MainWindow::resampleResult(bool result)
+{
+    ui->startButton->setText("start");
+    setChanging(false);
+    if(result){
+        rcvDebug("转换成功，可以点击ｔｅｓｔ按钮来试听");
+        ui->testButton->setEnabled(true);
+    }
+    else
+        rcvDebug("转换失败");
+}
+
+void MainWindow::resampleCancelled()
+{
+    ui->startButton->setText("start");
+    setChanging(false);
+    if(ui->resumeCheckBox->isChecked())
+        rcvDebug("已取消，再次开始同样的转换时从断点继续");
+    else
+        rcvDebug("已取消");
+}
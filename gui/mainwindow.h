@@ -3,6 +3,7 @@
 
 #include <QMainWindow>
 #include <QFile>
+#include <QComboBox>
 #include "pcmaudio.h"
 
 namespace Ui {
@@ -21,22 +22,39 @@ public:
     int getDstSampleRate();
     AVSampleFormat getSrcFormat();
     AVSampleFormat getDstFormat();
+    SampleCodec::Coding getSrcCoding();
+    SampleCodec::Coding getDstCoding();
+    ResamplerOptions::Dither getDither();
     int getSrcChannels();
     int getDstChannels();
+    int64_t getSrcLayout();
+    int64_t getDstLayout();
+    void setSrcFormat(AVSampleFormat format);
+    void setSrcChannels(int channels);
 
     PCMAudio::FileType getDstType();
+    /**
+     * @brief 按界面上的设置生成一次转换的参数，声道映射格式错误时返回false
+     */
+    bool getConfig(ConversionConfig *config);
 signals:
-    void startChange();
+    void startChange(const QUrl &url,const ConversionConfig &config);
     void stopChange();
 public slots:
     void on_pathSelectButton_clicked(bool);
     void on_playButton_clicked(bool);
     void on_testButton_clicked(bool);
     void on_startButton_clicked(bool);
+    void on_recordButton_clicked(bool);
 
     void rcvDebug(const QString &msg);
     void updateProgress(int finish,int total);
     void resampleResult(bool result);
+    void resampleCancelled();
+private:
+    void setChanging(bool changing);
+    void initLayoutBox(QComboBox *box);
+    void detectSrcFormat();
 private:
     Ui::MainWindow *ui;
 
@@ -0,0 +1,325 @@
+﻿#include "pcmaudio.h"
+#include <QAudioFormat>
+#include <QFile>
+#include <QDebug>
+#include <QDateTime>
+
+PCMAudio::PCMAudio(QObject *parent) :
+    QObject(parent),
+    srcType(OTHER),
+    output(nullptr),
+    recordDevice(&recorder),
+    input(nullptr),
+    stopRequested(false)
+{
+    /*回调在转换所在的线程里调用，信号按队列发到界面线程*/
+    Converter::Callbacks callbacks;
+    callbacks.message = [this](const std::string &msg){ emit debugMsg(QString::fromStdString(msg));};
+    callbacks.progress = [this](int64_t done,int64_t total){ emit progress((int)done,(int)total);};
+    callbacks.overviewReady = [this](){ emit overviewReady();};
+    converter.setCallbacks(callbacks);
+    Converter::Callbacks previewCallbacks;
+    previewCallbacks.message = callbacks.message;
+    preview.setCallbacks(previewCallbacks);
+    srcBuffer.setBuffer(&srcData);
+    srcBuffer.open(QIODevice::ReadOnly);
+    srcBuffer.seek(0);
+    dstBuffer.setBuffer(&dstData);
+    dstBuffer.open(QIODevice::ReadOnly);
+    dstBuffer.seek(0);
+}
+
+void PCMAudio::setFilePath(const QUrl &url)
+{
+    if(url.isEmpty()){
+        emit debugMsg("path is empty");
+        return;
+    }
+
+    QString msg("path:%1\nfileName:%2");
+    srcUrl = url;
+    msg = msg.arg(srcUrl.toString(QUrl::PreferLocalFile)).arg(srcUrl.fileName());
+    emit debugMsg(msg);
+    _setType();
+}
+
+std::vector<FormatDetector::Guess> PCMAudio::detectFormat()
+{
+    /*在文件中均匀取8块，每块16KB，大文件也只读很少的数据*/
+    const int blocks = 8;
+    const int blockSize = 16384;
+    FormatDetector detector;
+    QFile file(srcUrl.toString(QUrl::PreferLocalFile));
+    if(!file.open(QFile::ReadOnly))
+        return std::vector<FormatDetector::Guess>();
+    qint64 step = file.size() / blocks;
+    for(int i = 0;i < blocks;++i){
+        qint64 offset = step * i;
+        offset -= offset % 16;
+        if(!file.seek(offset))
+            break;
+        QByteArray ba = file.read(blockSize);
+        detector.addBlock((const uint8_t *)ba.constData(),ba.size());
+        if(step < blockSize)
+            break;
+    }
+    return detector.rank();
+}
+
+AudioContainer::Type PCMAudio::containerType(const FileType &type)
+{
+    switch(type){
+    case PCM:
+        return AudioContainer::Raw;
+    case AIFF:
+        return AudioContainer::AIFF;
+    case AIFC:
+        return AudioContainer::AIFC;
+    case CAF:
+        return AudioContainer::CAF;
+    case W64:
+        return AudioContainer::W64;
+    case WAV:
+    default:
+        return AudioContainer::WAV;
+    }
+}
+
+void PCMAudio::playMusic(bool isSrc,int rate,AVSampleFormat format,SampleCodec::Coding coding,int channels)
+{
+    /*封装格式的源按文件头播放，裸PCM按界面上的格式解码*/
+    if(isSrc){
+        if(srcType == PCM){
+            auto config = preview.getConfig();
+            config.srcFormat = format;
+            config.srcCoding = coding;
+            preview.setConfig(config);
+        }
+        preview.load();
+        _setSrcPlayData();
+        if(srcType != PCM){
+            rate = preview.sourceRate();
+            format = preview.sourceFormat();
+            channels = preview.sourceChannels();
+        }
+    }
+    auto f = makePlayFormat(rate,format,channels);
+    stopMusic();
+    output = new QAudioOutput(f);
+    if(isSrc){
+        srcBuffer.seek(0);
+        output->start(&srcBuffer);
+    }
+    else{
+        dstBuffer.seek(0);
+        output->start(&dstBuffer);
+    }
+}
+
+void PCMAudio::stopMusic()
+{
+    if(output != nullptr){
+        output->stop();
+        delete output;
+        output = nullptr;
+    }
+}
+
+QAudioFormat PCMAudio::makePlayFormat(int rate, AVSampleFormat format, int channels)
+{
+    QAudioFormat f;
+    f.setChannelCount(channels);
+    f.setSampleRate(rate);
+    switch(format){
+    case AV_SAMPLE_FMT_U8:
+        f.setSampleType(QAudioFormat::UnSignedInt);
+        f.setSampleSize(8);
+        break;
+    case AV_SAMPLE_FMT_S16:
+        f.setSampleType(QAudioFormat::SignedInt);
+        f.setSampleSize(16);
+        break;
+    case AV_SAMPLE_FMT_S32:
+        f.setSampleType(QAudioFormat::SignedInt);
+        f.setSampleSize(32);
+        break;
+    case AV_SAMPLE_FMT_DBL:
+        emit debugMsg("现在无法播放double类型音频，默认转为float");
+        f.setSampleSize(64);
+        f.setSampleType(QAudioFormat::Float);
+        break;
+    case AV_SAMPLE_FMT_FLT:
+        f.setSampleType(QAudioFormat::Float);
+        f.setSampleSize(32);
+        break;
+    default:
+        f.setSampleType(QAudioFormat::SignedInt);
+        f.setSampleSize(16);
+    }
+    f.setCodec("audio/pcm");
+    f.setByteOrder(QAudioFormat::LittleEndian);
+    return f;
+}
+
+bool PCMAudio::startRecord(const StreamConverter::Format &capture, const StreamConverter::Format &output,
+                           SampleCodec::Coding coding, AudioContainer::Type container, ResamplerOptions::Quality quality)
+{
+    stopRecord();
+    auto f = makePlayFormat(capture.rate,capture.format,capture.channels());
+    auto device = QAudioDeviceInfo::defaultInputDevice();
+    if(!device.isFormatSupported(f)){
+        emit debugMsg(QString("%1 does not support the capture format").arg(device.deviceName()));
+        return false;
+    }
+
+    if(container == AudioContainer::WAV)
+        container = AudioContainer::RF64;
+    recorder.setInputFormat(capture);
+    recorder.setOutputFormat(output,coding);
+    recorder.setContainer(container);
+    recorder.setQuality(quality);
+    auto name = QString("record") + QDateTime::currentDateTime().toString("_yyyy_MM_dd_hh-mm-ss")
+            + "." + AudioContainer::extension(container);
+    if(!recorder.start(QFile::encodeName(name).toStdString())){
+        emit debugMsg("record start error");
+        return false;
+    }
+    recordDevice.open(QIODevice::WriteOnly);
+    input = new QAudioInput(device,f);
+    input->start(&recordDevice);
+    emit debugMsg("record to " + name);
+    return true;
+}
+
+void PCMAudio::stopRecord()
+{
+    if(input == nullptr)
+        return;
+    /*先停止采集，Recorder再把缓冲里剩下的写完*/
+    input->stop();
+    delete input;
+    input = nullptr;
+    recordDevice.close();
+    auto stats = recorder.stats();
+    bool ok = recorder.stop();
+    auto &capture = recorder.inputFormat();
+    double bytesPerSecond = (double)capture.rate * capture.frameBytes();
+    emit debugMsg(QString("record %1, captured %2 s, %3 overruns (%4 ms dropped), max buffer %5 ms")
+                  .arg(ok ? "finished" : "write error")
+                  .arg(stats.capturedBytes / bytesPerSecond,0,'f',1)
+                  .arg(stats.overruns)
+                  .arg(stats.droppedBytes * 1000 / bytesPerSecond,0,'f',0)
+                  .arg(stats.maxFill * 1000 / bytesPerSecond,0,'f',0));
+}
+
+void PCMAudio::startChange(const QUrl &url, const ConversionConfig &config)
+{
+    /*这个任务自己的一份参数，界面线程之后的修改不影响正在进行的转换*/
+    auto job = config;
+    job.overviewPath = QFile::encodeName(_overviewPath(url)).toStdString();
+    /*断点放在源文件旁边，停止后再次开始同样的转换时从断点继续；不续转时删除上次留下的断点*/
+    auto checkpointPath = QFile::encodeName(url.toLocalFile() + ".resume").toStdString();
+    if(job.checkpointInterval > 0)
+        job.checkpointPath = checkpointPath;
+    else{
+        Checkpoint stale;
+        stale.setPath(checkpointPath);
+        stale.remove();
+    }
+    converter.setConfig(job);
+    if(!converter.open(QFile::encodeName(url.toLocalFile()).toStdString())){
+        emit finish(false);
+        return;
+    }
+    /*排队期间已经停止时run直接返回Cancelled*/
+    if(stopRequested)
+        converter.stop();
+    auto status = converter.run();
+    bool f = status == Converter::Finished;
+    _setDstPlayData();
+    if(status != Converter::Failed && !converter.report().empty())
+        emit analysisReport(QString::fromStdString(converter.report()));
+    if(status == Converter::Cancelled){
+        emit cancelled();
+        return;
+    }
+    /*成功或者失败都将发送该信号*/
+    emit finish(f);
+    if(f){
+        emit debugMsg("Ready to write to file");
+        auto list = url.fileName().split(".");
+        auto name = list.first() + QDateTime::currentDateTime().toString("_yyyy_MM_dd_hh-mm-ss");
+        converter.save(QFile::encodeName(name).toStdString());
+    }
+}
+
+void PCMAudio::stopChange()
+{
+    stopRequested = true;
+    converter.stop();
+}
+
+bool PCMAudio::loadOverview()
+{
+    if(srcUrl.isEmpty())
+        return false;
+    auto config = preview.getConfig();
+    config.overviewPath = QFile::encodeName(_overviewPath(srcUrl)).toStdString();
+    preview.setConfig(config);
+    return preview.loadOverview();
+}
+
+void PCMAudio::_setType()
+{
+    QFile file(srcUrl.toString(QUrl::PreferLocalFile));
+    if(!file.open(QFile::ReadOnly)){
+        emit debugMsg("file open error");
+        srcType = Error;
+        return;
+    }
+    file.close();
+
+    bool ok = preview.open(QFile::encodeName(file.fileName()).toStdString());
+    switch(preview.sourceInfo().container){
+    case AudioContainer::WAV:
+    case AudioContainer::RF64:
+        srcType = WAV;
+        break;
+    case AudioContainer::AIFF:
+        srcType = AIFF;
+        break;
+    case AudioContainer::AIFC:
+        srcType = AIFC;
+        break;
+    case AudioContainer::CAF:
+        srcType = CAF;
+        break;
+    case AudioContainer::W64:
+        srcType = W64;
+        break;
+    case AudioContainer::Raw:
+    default:
+        srcType = PCM;
+        break;
+    }
+    if(!ok)
+        srcType = Error;
+}
+
+/*fromRawData不复制数据，preview里的数据在下次读入前、converter里的在下次转换前不会变*/
+void PCMAudio::_setSrcPlayData()
+{
+    auto &src = preview.sourceData();
+    srcData = QByteArray::fromRawData((const char *)src.data(),(int)src.size());
+}
+
+void PCMAudio::_setDstPlayData()
+{
+    auto &dst = converter.outputData();
+    dstData = QByteArray::fromRawData((const char *)dst.data(),(int)dst.size());
+}
+
+QString PCMAudio::_overviewPath(const QUrl &url) const
+{
+    return url.toString(QUrl::PreferLocalFile) + ".peaks";
+}
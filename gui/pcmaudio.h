@@ -0,0 +1,132 @@
+#ifndef PCMAUDIO_H
+#define PCMAUDIO_H
+
+#include <QObject>
+#include <QThread>
+#include <QUrl>
+#include <QAudioOutput>
+#include <QAudioInput>
+#include <QBuffer>
+#include <QFile>
+#include <QVector>
+#include <atomic>
+#include "converter.h"
+#include "formatdetector.h"
+#include "recorder.h"
+#include "recorddevice.h"
+extern "C"{
+#include "libavutil/channel_layout.h"
+#include "libavutil/samplefmt.h"
+}
+
+/**
+ * @brief 界面用的转换对象
+ * 转换本身由core里的Converter完成，这里负责播放、文件选择和把回调转成信号。
+ * 转换在工作线程里用converter，界面线程的文件探测、播放和概览用preview，两者不共用
+ */
+class PCMAudio : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief The FileType enum
+     * PCM以外的类型读入时从文件头取得格式，忽略界面上的源参数
+     */
+    enum FileType{
+        Error = 0,
+        PCM = 0x01,
+        WAV,
+        AIFF,
+        AIFC,
+        CAF,
+        W64,
+        OTHER
+    };
+
+public:
+    explicit PCMAudio(QObject *parent = nullptr);
+
+    /**
+     * @brief 输出类型对应的封装格式，OTHER按WAV处理
+     */
+    static AudioContainer::Type containerType(const FileType &type);
+    PCMAudio::FileType getType();
+    const AudioReader::Info & getSrcInfo() const;
+    std::vector<FormatDetector::Guess> detectFormat();
+
+    void setFilePath(const QUrl &url);
+    const QUrl &getFilePath() const;
+    /**
+     * @brief 裸PCM的源按format和coding读入播放，封装格式按文件头
+     */
+    void playMusic(bool isSrc,int rate,AVSampleFormat format,SampleCodec::Coding coding,int channels);
+    const QByteArray & getFilePCMData();
+    void stopMusic();
+
+    QAudioFormat makePlayFormat(int rate,AVSampleFormat format,int channels);
+
+    /**
+     * @brief 从默认输入设备录音，按capture的格式采集，转换为output的格式写文件
+     * 输出类型为WAV时写RF64，超过4GB也能继续录
+     */
+    bool startRecord(const StreamConverter::Format &capture,const StreamConverter::Format &output,
+                     SampleCodec::Coding coding,AudioContainer::Type container,ResamplerOptions::Quality quality);
+    void stopRecord();
+
+    bool loadOverview();
+    const WaveformOverview & getOverview() const;
+
+    /**
+     * @brief 在界面线程发出startChange之前调用，撤销上一次的stopChange
+     */
+    void prepareChange();
+signals:
+    void debugMsg(const QString &msg);
+    void progress(int finish,int total);
+    void finish(bool result);
+    /*转换被停止，结果不完整，没有保存*/
+    void cancelled();
+    void overviewReady();
+    void analysisReport(const QString &report);
+public slots:
+    /**
+     * @brief 在工作线程里转换url指向的文件，config按值随任务传入，转换期间不会改变
+     */
+    void startChange(const QUrl &url,const ConversionConfig &config);
+    /**
+     * @brief 可以在任何线程直接调用，startChange还在排队时也有效
+     */
+    void stopChange();
+private:
+    void _setType();
+    void _setSrcPlayData();
+    void _setDstPlayData();
+    QString _overviewPath(const QUrl &url) const;
+private:
+    QUrl srcUrl;
+    PCMAudio::FileType srcType;
+    /*只在工作线程的startChange里使用，其它线程只能调用stop*/
+    Converter converter;
+    /*界面线程里读文件头、读入播放的源数据和波形概览*/
+    Converter preview;
+    QAudioOutput *output;
+    Recorder recorder;
+    RecordDevice recordDevice;
+    QAudioInput *input;
+    /*播放用，直接引用preview和converter里的数据，不复制*/
+    QByteArray srcData;
+    QBuffer srcBuffer;
+    QByteArray dstData;
+    QBuffer dstBuffer;
+    /*converter.stop在setConfig时被撤销，排队期间的停止记在这里*/
+    std::atomic<bool> stopRequested;
+};
+
+inline const QUrl &PCMAudio::getFilePath() const                                {   return srcUrl;}
+inline PCMAudio::FileType PCMAudio::getType()                                   {   return srcType;}
+inline const AudioReader::Info &PCMAudio::getSrcInfo() const                    {   return preview.sourceInfo();}
+inline const WaveformOverview &PCMAudio::getOverview() const                    {   return preview.getOverview();}
+inline void PCMAudio::prepareChange()                                           {   stopRequested = false;}
+
+Q_DECLARE_METATYPE(ConversionConfig)
+#endif // PCMAUDIO_H
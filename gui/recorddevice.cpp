@@ -0,0 +1,19 @@
+#include "recorddevice.h"
+
+RecordDevice::RecordDevice(Recorder *recorder, QObject *parent) :
+    QIODevice(parent),
+    recorder(recorder)
+{
+}
+
+qint64 RecordDevice::readData(char *, qint64)
+{
+    return -1;
+}
+
+qint64 RecordDevice::writeData(const char *data, qint64 maxSize)
+{
+    /*缓冲满时Recorder自己计数并补静音，这里总是报告全部写入，QAudioInput不会重发*/
+    recorder->push((const uint8_t *)data,maxSize);
+    return maxSize;
+}
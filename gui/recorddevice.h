@@ -0,0 +1,24 @@
+#ifndef RECORDDEVICE_H
+#define RECORDDEVICE_H
+
+#include <QIODevice>
+#include "recorder.h"
+
+/**
+ * @brief QAudioInput推送模式的目标设备
+ * writeData在采集数据到达时调用，直接交给Recorder::push，不做其它处理
+ */
+class RecordDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    explicit RecordDevice(Recorder *recorder, QObject *parent = nullptr);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+private:
+    Recorder *recorder;
+};
+
+#endif // RECORDDEVICE_H
@@ -0,0 +1,15 @@
+#-------------------------------------------------
+#
+# 核对转换引擎的测试程序，make check运行
+#
+#-------------------------------------------------
+
+TARGET = polyphasetest
+TEMPLATE = app
+CONFIG += console c++11 testcase
+CONFIG -= app_bundle qt
+
+SOURCES += \
+        polyphasetest.cpp
+
+include(../core/core.pri)